@@ -0,0 +1,21 @@
+#ifndef FRAMESTAMP_H
+#define FRAMESTAMP_H
+
+#include <cstdint>
+#include <chrono>
+
+
+// Acquisition metadata of a frame: DAQ sequence number & monotonic arrival time
+// (steady_clock, the same clock as the pullback motor move timestamps)
+struct FrameStamp
+{
+	uint32_t sequence = 0;
+	int64_t timestamp_us = 0;
+
+	static inline int64_t now_us()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+};
+
+#endif // FRAMESTAMP_H
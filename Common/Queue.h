@@ -31,6 +31,17 @@ public:
 		queue_.pop();
 	}
 
+	bool try_pop(T& item) // non-blocking, false when empty
+	{
+		std::unique_lock<std::mutex> mlock(mutex_);
+		if (queue_.empty())
+			return false;
+
+		item = queue_.front();
+		queue_.pop();
+		return true;
+	}
+
 	void push(const T& item) // 
 	{
 		std::unique_lock<std::mutex> mlock(mutex_);
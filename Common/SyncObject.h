@@ -4,14 +4,19 @@
 #include <iostream>
 #include <queue>
 #include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+#include <thread>
 
 #include <Common/Queue.h>
+#include <Common/FrameStamp.h>
 
 template <typename T>
 class SyncObject
 {
 public:
-    SyncObject() : n_exec(0) {}
+    SyncObject() : n_exec(0), n_dropped(0), n_buffer(0) {}
 	~SyncObject() { deallocate_queue_buffer(); }
 
 public:
@@ -26,6 +31,21 @@ public:
         }
     }
 
+	// n_blocks blocks of n_per_block buffers laid back to back: a block taken in queue order is filled by a single read
+	void allocate_queue_buffer(int width, int height, int n_blocks, int n_per_block)
+	{
+		n_buffer = n_blocks * n_per_block;
+		size_t size = (size_t)width * height;
+		for (int i = 0; i < n_blocks; i++)
+		{
+			T* block = new T[size * n_per_block];
+			memset(block, 0, size * n_per_block * sizeof(T));
+			blocks.push_back(block);
+			for (int j = 0; j < n_per_block; j++)
+				queue_buffer.push(block + size * j);
+		}
+	}
+
 	void deallocate_queue_buffer()
 	{
 		for (int i = 0; i < n_buffer; i++)		
@@ -35,10 +55,91 @@ public:
 				/* Ȯ ʿ !!! */
 				T* buffer = queue_buffer.front();
 				queue_buffer.pop();
-				if (buffer) delete[] buffer;
+				if (buffer && blocks.empty()) delete[] buffer;
 				/************************************************/
 			}
 		}
+
+		for (auto block : blocks)
+			delete[] block;
+		blocks.clear();
+
+		std::unique_lock<std::mutex> lock(mtx_stamp);
+		stamps.clear();
+	}
+
+	// Free buffer or, when the consumer lags behind, the oldest one still waiting in the sync queue (drop-oldest)
+	T* acquire_or_drop_oldest()
+	{
+		{
+			std::unique_lock<std::mutex> lock(mtx);
+			if (!queue_buffer.empty())
+			{
+				T* buffer = queue_buffer.front();
+				queue_buffer.pop();
+				return buffer;
+			}
+		}
+
+		T* buffer = nullptr;
+		if (Queue_sync.try_pop(buffer))
+		{
+			if (buffer != nullptr)
+				n_dropped++;
+			else
+				Queue_sync.push(nullptr); // never swallow the end marker
+		}
+		return buffer;
+	}
+
+	// n free buffers in queue order, waiting for the consumer to return them
+	void acquire_block(std::vector<T*>& block, int n)
+	{
+		block.clear();
+		while ((int)block.size() < n)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mtx);
+				while (!queue_buffer.empty() && ((int)block.size() < n))
+				{
+					block.push_back(queue_buffer.front());
+					queue_buffer.pop();
+				}
+			}
+			if ((int)block.size() < n)
+				std::this_thread::yield();
+		}
+	}
+
+	// Contiguous runs of a block (buffers of size elements), each one filled by a single request: 
+	// the whole block when its buffers came back in queue order
+	template <typename Func>
+	static void for_each_run(const std::vector<T*>& block, size_t size, Func func)
+	{
+		for (int i = 0; i < (int)block.size(); )
+		{
+			int n = 1;
+			while ((i + n < (int)block.size()) && (block.at(i + n) == block.at(i) + size * n))
+				n++;
+			func(block.at(i), n);
+			i += n;
+		}
+	}
+
+	inline int get_buffer_count() const { return n_buffer; }
+
+	// Acquisition metadata travels with the buffer it was stamped on
+	void set_stamp(const T* buffer, const FrameStamp& stamp)
+	{
+		std::unique_lock<std::mutex> lock(mtx_stamp);
+		stamps[buffer] = stamp;
+	}
+
+	FrameStamp get_stamp(const T* buffer)
+	{
+		std::unique_lock<std::mutex> lock(mtx_stamp);
+		auto it = stamps.find(buffer);
+		return (it != stamps.end()) ? it->second : FrameStamp();
 	}
 
 	size_t get_sync_queue_size()
@@ -51,9 +152,13 @@ public:
     std::mutex mtx; // Mutex for buffering operation
     Queue<T*> Queue_sync; // Synchronization objects for threading operations
 	int n_exec;
+	std::atomic<int> n_dropped; // frames overwritten by the drop-oldest policy
 
 private:
 	int n_buffer;
+	std::vector<T*> blocks;
+	std::mutex mtx_stamp;
+	std::unordered_map<const T*, FrameStamp> stamps;
 };
 
 #endif // SYNCOBJECT_H
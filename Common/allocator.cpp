@@ -0,0 +1,257 @@
+#include "allocator.h"
+
+#include <atomic>
+#include <mutex>
+#include <map>
+#include <vector>
+#include <new>
+#include <cstdlib>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <malloc.h>
+#elif defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+
+namespace np {
+
+namespace memory {
+
+	struct block
+	{
+		void* ptr;
+		size_t size; // size class
+		bool huge;
+	};
+
+	struct state
+	{
+		state() : peak(0), budget(0), pooled(0), huge_pages(false)
+		{
+			for (int i = 0; i < NP_MEMORY_SUBSYSTEMS; i++)
+				live[i] = 0;
+		}
+
+		std::atomic<int64_t> live[NP_MEMORY_SUBSYSTEMS];
+		std::atomic<int64_t> peak;
+		std::atomic<int64_t> budget;
+		std::atomic<int64_t> pooled;
+		std::atomic<bool> huge_pages;
+
+		// Free blocks by size class
+		std::mutex mtx;
+		std::map<size_t, std::vector<block>> pool;
+	};
+
+	static state& get_state()
+	{
+		static state s;
+		return s;
+	}
+
+	static thread_local int current_subsystem = 0;
+
+
+	int subsystem()
+	{
+		return current_subsystem;
+	}
+
+	void set_subsystem(int tag)
+	{
+		current_subsystem = ((tag >= 0) && (tag < NP_MEMORY_SUBSYSTEMS)) ? tag : 0;
+	}
+
+	int64_t live_bytes(int tag)
+	{
+		return ((tag >= 0) && (tag < NP_MEMORY_SUBSYSTEMS)) ? get_state().live[tag].load() : 0;
+	}
+
+	int64_t live_bytes()
+	{
+		int64_t total = 0;
+		for (int i = 0; i < NP_MEMORY_SUBSYSTEMS; i++)
+			total += get_state().live[i].load();
+		return total;
+	}
+
+	int64_t peak_bytes()
+	{
+		return get_state().peak.load();
+	}
+
+	int64_t pooled_bytes()
+	{
+		return get_state().pooled.load();
+	}
+
+	void set_budget(int64_t bytes)
+	{
+		get_state().budget = (bytes > 0) ? bytes : 0;
+	}
+
+	int64_t budget()
+	{
+		return get_state().budget.load();
+	}
+
+	bool over_budget(int64_t extra)
+	{
+		int64_t limit = get_state().budget.load();
+		return (limit > 0) && (live_bytes() + pooled_bytes() + extra > limit);
+	}
+
+	void set_huge_pages(bool enable)
+	{
+		get_state().huge_pages = enable;
+	}
+
+
+	static size_t size_class(size_t size, bool huge)
+	{
+		size_t align = NP_MEMORY_ALIGNMENT;
+		if (size <= NP_MEMORY_POOL_MIN_SIZE)
+			return (size + align - 1) / align * align + (size == 0 ? align : 0);
+
+		// 4 classes per power of two: 25% slack at most
+		size_t p = 1;
+		while ((p << 1) < size) p <<= 1;
+		size_t step = p >> 2;
+		size_t bytes = (size + step - 1) / step * step;
+
+		if (huge && (bytes >= NP_MEMORY_HUGE_PAGE_SIZE))
+			bytes = (bytes + NP_MEMORY_HUGE_PAGE_SIZE - 1) / NP_MEMORY_HUGE_PAGE_SIZE * NP_MEMORY_HUGE_PAGE_SIZE;
+
+		return bytes;
+	}
+
+	static void* system_allocate(size_t bytes, bool& huge)
+	{
+#ifdef _WIN32
+		if (huge)
+		{
+			// Fails without the 'Lock pages in memory' privilege: regular pages from then on
+			SIZE_T large_page = GetLargePageMinimum();
+			if (large_page && (bytes % large_page == 0))
+			{
+				void* ptr = VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+				if (ptr) return ptr;
+			}
+			get_state().huge_pages = false;
+			huge = false;
+		}
+		return _aligned_malloc(bytes, NP_MEMORY_ALIGNMENT);
+#else
+		void* ptr = nullptr;
+		if (posix_memalign(&ptr, huge ? NP_MEMORY_HUGE_PAGE_SIZE : NP_MEMORY_ALIGNMENT, bytes) != 0)
+			return nullptr;
+#ifdef __linux__
+		if (huge)
+			madvise(ptr, bytes, MADV_HUGEPAGE);
+#endif
+		huge = false; // released with free() all the same
+		return ptr;
+#endif
+	}
+
+	static void system_free(const block& b)
+	{
+#ifdef _WIN32
+		if (b.huge)
+			VirtualFree(b.ptr, 0, MEM_RELEASE);
+		else
+			_aligned_free(b.ptr);
+#else
+		free(b.ptr);
+#endif
+	}
+
+	void trim()
+	{
+		std::vector<block> blocks;
+		{
+			state& s = get_state();
+			std::unique_lock<std::mutex> lock(s.mtx);
+			for (auto& free_list : s.pool)
+				blocks.insert(blocks.end(), free_list.second.begin(), free_list.second.end());
+			s.pool.clear();
+			s.pooled = 0;
+		}
+
+		for (auto& b : blocks)
+			system_free(b);
+	}
+
+	static void release(const block& b, int tag)
+	{
+		state& s = get_state();
+		s.live[tag] -= (int64_t)b.size;
+
+		// Large blocks are kept for the next array of the same class unless the pool is full or the budget is spent
+		if ((b.size > NP_MEMORY_POOL_MIN_SIZE) && !over_budget(b.size))
+		{
+			std::unique_lock<std::mutex> lock(s.mtx);
+			if (s.pooled + (int64_t)b.size <= NP_MEMORY_POOL_CAPACITY)
+			{
+				s.pool[b.size].push_back(b);
+				s.pooled += (int64_t)b.size;
+				return;
+			}
+		}
+
+		system_free(b);
+	}
+
+	std::shared_ptr<void> allocate(size_t size)
+	{
+		state& s = get_state();
+
+		block b;
+		b.huge = s.huge_pages.load() && (size >= NP_MEMORY_HUGE_PAGE_SIZE);
+		b.size = size_class(size, b.huge);
+		b.ptr = nullptr;
+
+		// Reuse a pooled block of the same class
+		if (b.size > NP_MEMORY_POOL_MIN_SIZE)
+		{
+			std::unique_lock<std::mutex> lock(s.mtx);
+			auto it = s.pool.find(b.size);
+			if ((it != s.pool.end()) && !it->second.empty())
+			{
+				b = it->second.back();
+				it->second.pop_back();
+				s.pooled -= (int64_t)b.size;
+			}
+		}
+
+		if (!b.ptr)
+		{
+			// Evict the pooled blocks before going over the budget or running out of memory
+			if (over_budget(b.size))
+				trim();
+
+			b.ptr = system_allocate(b.size, b.huge);
+			if (!b.ptr)
+			{
+				trim();
+				b.ptr = system_allocate(b.size, b.huge);
+				if (!b.ptr)
+					throw std::bad_alloc();
+			}
+		}
+
+		int tag = current_subsystem;
+		s.live[tag] += (int64_t)b.size;
+
+		int64_t total = live_bytes();
+		int64_t peak = s.peak.load();
+		while ((total > peak) && !s.peak.compare_exchange_weak(peak, total));
+
+		return std::shared_ptr<void>(b.ptr, [b, tag](void*) { release(b, tag); });
+	}
+
+} // namespace memory
+
+} // namespace np
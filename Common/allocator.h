@@ -2,19 +2,61 @@
 #define NUMCPP_ALLOCATOR_H_
 
 #include <memory>
+#include <cstdint>
+#include <cstddef>
+
+#define NP_MEMORY_ALIGNMENT			64 // cache line (and AVX-512 vector) alignment of every array
+#define NP_MEMORY_POOL_MIN_SIZE		65536 // smaller blocks go straight to the heap
+#define NP_MEMORY_POOL_CAPACITY		536870912 // 512 MB of free blocks kept for reuse at most
+#define NP_MEMORY_HUGE_PAGE_SIZE	2097152 // 2 MB
+#define NP_MEMORY_SUBSYSTEMS		8
 
 namespace np {
 
+namespace memory {
+
+	// Subsystem the allocations of the calling thread are accounted to (0 by default)
+	int subsystem();
+	void set_subsystem(int tag);
+
+	class subsystem_scope
+	{
+	public:
+		explicit subsystem_scope(int tag) : _prev(subsystem()) { set_subsystem(tag); }
+		~subsystem_scope() { set_subsystem(_prev); }
+
+	private:
+		int _prev;
+	};
+
+	// Live bytes of the arrays allocated by a subsystem, or by all of them
+	int64_t live_bytes(int tag);
+	int64_t live_bytes();
+	int64_t peak_bytes();
+	// Free blocks held by the pool for reuse
+	int64_t pooled_bytes();
+
+	// Budget on the live & pooled bytes (0: unlimited); the pool is emptied first when an allocation goes over it
+	void set_budget(int64_t bytes);
+	int64_t budget();
+	bool over_budget(int64_t extra = 0);
+
+	// Large blocks on huge pages (large page privilege required on Windows, transparent huge pages on Linux)
+	void set_huge_pages(bool enable);
+
+	// Return the pooled blocks to the system
+	void trim();
+
+	// Block of at least size bytes aligned on NP_MEMORY_ALIGNMENT, pooled by size class (4 classes per power of two)
+	std::shared_ptr<void> allocate(size_t size);
+
+} // namespace memory
+
 struct heap_allocator
 {
 	static std::shared_ptr<void> allocate(int size)
 	{
-		return std::shared_ptr<void>(new char[size], free);
-	}
-
-	static void free(void *ptr)
-	{
-		delete[] ptr;
+		return memory::allocate((size_t)size);
 	}
 };
 
@@ -5,6 +5,7 @@
 #include "array_functions.h"
 
 #include <iostream>
+#include <cstring>
 #include <array>
 #include <complex>
 
@@ -256,6 +257,18 @@ namespace np {
 			return _stride[dim];
 		}
 
+		// Bytes between two rows (IPP step)
+		int step() const
+		{
+			static_assert(Dim >= 2, "Array dimension bounds error");
+			return _stride[1] * sizeof(value_type);
+		}
+
+		bool contiguous() const
+		{
+			return _stride == make_stride(_size);
+		}
+
 		value_type *raw_ptr()
 		{
 			return _origin;
@@ -326,6 +339,40 @@ namespace np {
 			array = Array<T, 2>(size0, size1);
 	}
 
+	// Rows (size0) padded to start on NP_MEMORY_ALIGNMENT: stride(1) is rounded up, so the array is no longer
+	// contiguous (use step() for IPP and np::copy instead of a whole-array memcpy)
+	template <typename T>
+	inline Array<T, 2> padded(int size0, int size1)
+	{
+		static_assert(NP_MEMORY_ALIGNMENT % sizeof(T) == 0, "Element size has to divide the alignment");
+		const int n_align = NP_MEMORY_ALIGNMENT / sizeof(T);
+		int pitch = (size0 + n_align - 1) / n_align * n_align;
+
+		Array<T, 2> result;
+
+		result._length = size0 * size1;
+		result._size = make_array(size0, size1);
+		result._stride = make_array(1, pitch);
+		result._address = heap_allocator::allocate(pitch * size1 * sizeof(T));
+		result._origin = reinterpret_cast<T *>(result._address.get());
+
+		return result;
+	}
+
+	// Element copy between arrays of the same size, row by row when either one is padded
+	template <typename T>
+	inline void copy(Array<T, 2> &dst, const Array<T, 2> &src)
+	{
+		if (dst.contiguous() && src.contiguous())
+		{
+			memcpy(dst.raw_ptr(), src.raw_ptr(), sizeof(T) * src.length());
+			return;
+		}
+
+		for (int i = 0; i < src.size(1); i++)
+			memcpy(&dst(0, i), &src(0, i), sizeof(T) * src.size(0));
+	}
+
 	template <typename T>
 	inline Array<T, 1> slice(const Array<T> &array, const Range &range)
 	{
@@ -30,8 +30,8 @@ public:
 		{
 			// Generate Cicularize Map
 			diameter = radius;
-			x_map = np::Array<float, 2>(diameter, diameter);
-			y_map = np::Array<float, 2>(diameter, diameter);
+			x_map = np::padded<float>(diameter, diameter);
+			y_map = np::padded<float>(diameter, diameter);
 			
 			Ipp32f* horizontal_line = ippsMalloc_32f(diameter);
 			Ipp32f* vertical_line = ippsMalloc_32f(diameter);
@@ -40,8 +40,8 @@ public:
 			for (int i = 0; i < diameter; i++)
 			{
 				ippsSet_32f((float)(2 * i - radius), vertical_line, diameter);
-				memcpy(x_map.raw_ptr() + i * diameter, horizontal_line, sizeof(float) * diameter);
-				memcpy(y_map.raw_ptr() + i * diameter, vertical_line, sizeof(float) * diameter);
+				memcpy(&x_map(0, i), horizontal_line, sizeof(float) * diameter);
+				memcpy(&y_map(0, i), vertical_line, sizeof(float) * diameter);
 			}
 			ippFree(horizontal_line);
 			ippFree(vertical_line);
@@ -50,8 +50,8 @@ public:
 		{
 			// Generate Cicularize Map
 			diameter = 2 * radius;
-			x_map = np::Array<float, 2>(diameter, diameter);
-			y_map = np::Array<float, 2>(diameter, diameter);
+			x_map = np::padded<float>(diameter, diameter);
+			y_map = np::padded<float>(diameter, diameter);
 
 			Ipp32f* horizontal_line = ippsMalloc_32f(diameter);
 			Ipp32f* vertical_line = ippsMalloc_32f(diameter);
@@ -60,24 +60,33 @@ public:
 			for (int i = 0; i < diameter; i++)
 			{
 				ippsSet_32f((float)(i - radius), vertical_line, diameter);
-				memcpy(x_map.raw_ptr() + i * diameter, horizontal_line, sizeof(float) * diameter);
-				memcpy(y_map.raw_ptr() + i * diameter, vertical_line, sizeof(float) * diameter);
+				memcpy(&x_map(0, i), horizontal_line, sizeof(float) * diameter);
+				memcpy(&y_map(0, i), vertical_line, sizeof(float) * diameter);
 			}
 			ippFree(horizontal_line);
 			ippFree(vertical_line);
 		}
 
+		// Maps with rows on cache lines (aligned map loads in the remap); the padding goes through the vector ops unread
+		int n_map = x_map.stride(1) * diameter;
+		int n_pad = x_map.stride(1) - diameter;
+		for (int i = 0; (n_pad > 0) && (i < diameter); i++)
+		{
+			ippsZero_32f(&x_map(diameter, i), n_pad);
+			ippsZero_32f(&y_map(diameter, i), n_pad);
+		}
+
 		// Rho : Interpolation Map
-		rho = np::Array<float, 2>(diameter, diameter);
-		ippsMagnitude_32f(x_map, y_map, rho, diameter * diameter);
-		ippsMulC_32f_I(((Ipp32f)radius - 1.0f) / radius, rho, diameter * diameter);
+		rho = np::padded<float>(diameter, diameter);
+		ippsMagnitude_32f(x_map, y_map, rho, n_map);
+		ippsMulC_32f_I(((Ipp32f)radius - 1.0f) / radius, rho, n_map);
 
 		// Theta : Interpolation Map
-		theta = np::Array<float, 2>(diameter, diameter);
-		ippsPhase_32f(x_map, y_map, theta, diameter * diameter);
+		theta = np::padded<float>(diameter, diameter);
+		ippsPhase_32f(x_map, y_map, theta, n_map);
 		//ippsMulC_32f_I(1.0f, theta, diameter * diameter);
-		ippsAddC_32f_I((Ipp32f)IPP_PI, theta, diameter * diameter);
-		ippsMulC_32f_I(((Ipp32f)alines - 1.0f) / (Ipp32f)IPP_2PI, theta, diameter * diameter);
+		ippsAddC_32f_I((Ipp32f)IPP_PI, theta, n_map);
+		ippsMulC_32f_I(((Ipp32f)alines - 1.0f) / (Ipp32f)IPP_2PI, theta, n_map);
     }
 
 	~circularize()
@@ -92,7 +101,7 @@ public:
 		IppiSize dstRoiSize = { diameter, diameter };
 
 		ippiRemap_32f_C1R(&rect_im(offset, 0), srcSize, sizeof(Ipp32f) * rect_im.size(0), srcRoi,
-			rho, sizeof(Ipp32f) * dstRoiSize.width, theta, sizeof(Ipp32f) * dstRoiSize.width,
+			rho, rho.step(), theta, theta.step(),
 			circ_im.raw_ptr(), sizeof(Ipp32f) * dstRoiSize.width, dstRoiSize, IPPI_INTER_NN);
     }
 
@@ -106,11 +115,11 @@ public:
 
 			if (rgb)
 				ippiRemap_8u_C3R(&rect_im(0, offset), srcSize, sizeof(Ipp8u) * rect_im.size(0), srcRoi,
-					theta, sizeof(Ipp32f) * dstRoiSize.width, rho, sizeof(Ipp32f) * dstRoiSize.width,
+					theta, theta.step(), rho, rho.step(),
 					circ_im, sizeof(Ipp8u) * 3 * dstRoiSize.width, dstRoiSize, IPPI_INTER_NN);
 			else
 				ippiRemap_8u_C1R(&rect_im(0, offset), srcSize, sizeof(Ipp8u) * rect_im.size(0), srcRoi,
-					theta, sizeof(Ipp32f) * dstRoiSize.width, rho, sizeof(Ipp32f) * dstRoiSize.width,
+					theta, theta.step(), rho, rho.step(),
 					circ_im, sizeof(Ipp8u) * dstRoiSize.width, dstRoiSize, IPPI_INTER_NN);
 		}
 		else
@@ -121,11 +130,11 @@ public:
 
 			if (rgb)
 				ippiRemap_8u_C3R(&rect_im(offset, 0), srcSize, sizeof(Ipp8u) * rect_im.size(0), srcRoi,
-					rho, sizeof(Ipp32f) * dstRoiSize.width, theta, sizeof(Ipp32f) * dstRoiSize.width,
+					rho, rho.step(), theta, theta.step(),
 					circ_im, sizeof(Ipp8u) * 3 * dstRoiSize.width, dstRoiSize, IPPI_INTER_NN);
 			else
 				ippiRemap_8u_C1R(&rect_im(offset, 0), srcSize, sizeof(Ipp8u) * rect_im.size(0), srcRoi,
-					rho, sizeof(Ipp32f) * dstRoiSize.width, theta, sizeof(Ipp32f) * dstRoiSize.width,
+					rho, rho.step(), theta, theta.step(),
 					circ_im, sizeof(Ipp8u) * dstRoiSize.width, dstRoiSize, IPPI_INTER_NN);
 		}
 	}
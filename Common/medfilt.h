@@ -5,6 +5,11 @@
 #include <ippi.h>
 #include <ippcore.h>
 
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+
+#define MEDFILT_BLOCK_ROWS 64
+
 class medfilt
 {
 public:
@@ -12,19 +17,33 @@ public:
 	{
 	};
 
-	medfilt(int _width, int _height, int _kernelx, int _kernely) :
-		width(_width), height(_height), kernelx(_kernelx), kernely(_kernely)
+	// circular: the x axis wraps around (angular axis of FLIm maps), the y axis is replicated at the borders
+	medfilt(int _width, int _height, int _kernelx, int _kernely, bool _circular = false) :
+		width(_width), height(_height), kernelx(_kernelx), kernely(_kernely), circular(_circular)
 	{
 		RoiSize = { width, height };
 		MaskSize = { kernelx, kernely };
 
-		ippiFilterMedianBorderGetBufferSize(RoiSize, MaskSize, ipp8u, 1, &BufferSize);
-		MemBuffer8u = np::Array<uint8_t>(BufferSize);
-		DstBuffer8u = np::Array<Ipp8u, 2>(width, height);
+		if (!circular)
+		{
+			ippiFilterMedianBorderGetBufferSize(RoiSize, MaskSize, ipp8u, 1, &BufferSize);
+			MemBuffer8u = np::Array<uint8_t>(BufferSize);
+			DstBuffer8u = np::Array<Ipp8u, 2>(width, height);
+
+			ippiFilterMedianBorderGetBufferSize(RoiSize, MaskSize, ipp32f, 1, &BufferSize);
+			MemBuffer32f = np::Array<uint8_t>(BufferSize);
+			DstBuffer32f = np::Array<Ipp32f, 2>(width, height);
+		}
+		else
+		{
+			// Source copy padded by the kernel half-width only: the filter reads from it and writes back to the map
+			halfx = kernelx / 2;
+			halfy = kernely / 2;
+			PadBuffer32f = np::Array<Ipp32f, 2>(width + 2 * halfx, height + 2 * halfy);
 
-		ippiFilterMedianBorderGetBufferSize(RoiSize, MaskSize, ipp32f, 1, &BufferSize);
-		MemBuffer32f = np::Array<uint8_t>(BufferSize);
-		DstBuffer32f = np::Array<Ipp32f, 2>(width, height);
+			IppiSize BlockSize = { width, MEDFILT_BLOCK_ROWS < height ? MEDFILT_BLOCK_ROWS : height };
+			ippiFilterMedianBorderGetBufferSize(BlockSize, MaskSize, ipp32f, 1, &BufferSize);
+		}
 	};
 
 	~medfilt()
@@ -39,18 +58,65 @@ public:
 
 	void operator() (Ipp32f* pSrcDst)
 	{
+		if (circular)
+		{
+			filterCircular(pSrcDst);
+			return;
+		}
+
 		ippiFilterMedianBorder_32f_C1R(pSrcDst, sizeof(Ipp32f) * RoiSize.width, DstBuffer32f, sizeof(Ipp32f) * RoiSize.width, RoiSize, MaskSize, ippBorderRepl, 0, MemBuffer32f);
 		memcpy(pSrcDst, DstBuffer32f, sizeof(Ipp32f) * width * height);
 	};
 
+private:
+	void filterCircular(Ipp32f* pSrcDst)
+	{
+		int pad_width = PadBuffer32f.size(0);
+		int pad_stride = sizeof(Ipp32f) * pad_width;
+
+		// Ping: wrapped & replicated copy of the map
+		tbb::parallel_for(tbb::blocked_range<int>(0, height + 2 * halfy),
+			[&](const tbb::blocked_range<int>& r) {
+			for (int i = r.begin(); i != r.end(); ++i)
+			{
+				int src_row = i - halfy;
+				src_row = (src_row < 0) ? 0 : ((src_row >= height) ? height - 1 : src_row);
+
+				const Ipp32f* pSrc = pSrcDst + (size_t)src_row * width;
+				Ipp32f* pPad = &PadBuffer32f(0, i);
+				memcpy(pPad, pSrc + width - halfx, sizeof(Ipp32f) * halfx);
+				memcpy(pPad + halfx, pSrc, sizeof(Ipp32f) * width);
+				memcpy(pPad + halfx + width, pSrc, sizeof(Ipp32f) * halfx);
+			}
+		});
+
+		// Pong: median of each block of frames straight back into the map
+		int n_blocks = (height + MEDFILT_BLOCK_ROWS - 1) / MEDFILT_BLOCK_ROWS;
+		tbb::parallel_for(tbb::blocked_range<int>(0, n_blocks),
+			[&](const tbb::blocked_range<int>& r) {
+			np::Array<uint8_t> buffer(BufferSize);
+			for (int b = r.begin(); b != r.end(); ++b)
+			{
+				int row0 = b * MEDFILT_BLOCK_ROWS;
+				int rows = (row0 + MEDFILT_BLOCK_ROWS < height) ? MEDFILT_BLOCK_ROWS : height - row0;
+
+				ippiFilterMedianBorder_32f_C1R(&PadBuffer32f(halfx, row0 + halfy), pad_stride,
+					pSrcDst + (size_t)row0 * width, sizeof(Ipp32f) * width, { width, rows }, MaskSize, ippBorderInMem, 0, buffer);
+			}
+		});
+	};
+
 private:
 	int width, height, kernelx, kernely;
+	bool circular = false;
+	int halfx = 0, halfy = 0;
 	IppiSize RoiSize, MaskSize;
 	Ipp32s BufferSize;
 	np::Array<uint8_t> MemBuffer8u;
 	np::Array<uint8_t> MemBuffer32f;
 	np::Array<Ipp8u, 2> DstBuffer8u;
 	np::Array<Ipp32f, 2> DstBuffer32f;
+	np::Array<Ipp32f, 2> PadBuffer32f;
 };
 
 #endif
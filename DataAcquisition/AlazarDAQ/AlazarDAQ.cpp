@@ -601,6 +601,8 @@ void AlazarDAQ::run()
                 // The buffer is full and has been removed from the list
                 // of buffers available for the board        
                 buffersCompletedUpdate++;
+				current_stamp.sequence = buffersCompleted;
+				current_stamp.timestamp_us = FrameStamp::now_us();
                 bytesTransferred += bytesPerBuffer;
                 bytesTransferredPerUpdate += bytesPerBuffer;
 
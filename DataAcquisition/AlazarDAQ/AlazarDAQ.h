@@ -8,6 +8,7 @@
 
 #include <Common/array.h>
 #include <Common/callback.h>
+#include <Common/FrameStamp.h>
 
 #include <iostream>
 #include <array>
@@ -75,6 +76,7 @@ public:
     bool UseFFTModule;
 	double frameRate;
 	bool _running;
+	FrameStamp current_stamp; // acquisition metadata of the buffer inside DidAcquireData
 	
 	// On-FPGA FFT processing
 	np::Array<float> window;
@@ -2,6 +2,11 @@
 #include "AxsunCapture.h"
 
 #include <windows.h>
+#include <timeapi.h>
+
+#include <chrono>
+
+#pragma comment(lib, "winmm.lib")
 
 using namespace std;
 
@@ -12,7 +17,10 @@ AxsunCapture::AxsunCapture() :
     capture_running(false),    
     image_width(1024),
     image_height(1024),
+	ring_size(AXSUN_RING_SIZE),
     returned_image(0),
+	dropped_packets(0),
+	dropped_images(0),
 	frameRate(0.0)
 {
 }
@@ -140,6 +148,7 @@ void AxsunCapture::captureRun()
 	uint32_t imaging;
     uint32_t last_packet, last_frame, last_image = 0, last_image0 = -1;
 	uint32_t frames_since_sync;
+	uint32_t last_image_number = 0;
 
 	image_info_t info{};
 	request_prefs_t prefs{};
@@ -148,13 +157,22 @@ void AxsunCapture::captureRun()
 	// Request & display images
 	uint32_t loop_counter = 0; 
 
-	image_data_out = np::Uint8Array2(image_height, 4 * image_width); // 4 frame buffers
+	if (ring_size < 2) ring_size = 2;
+	image_data_out = np::Uint8Array2(image_height, ring_size * image_width); // ring_size frame sections
+	uint32_t section_size = (uint32_t)image_height * image_width;
 	uint8_t *cur_section = nullptr;
+	dropped_images = 0;
 	
 	uint32_t dwTickStart = 0, dwTickLastUpdate;
 
 	uint64_t bytesAcquired = 0, bytesAcquiredUpdate = 0;
 	uint32_t frameIndex = 0, frameIndexUpdate = 0;
+	uint32_t droppedImagesUpdate = 0;
+
+	// Adaptive wait: sleep most of the measured frame period, then poll at a fraction of it
+	std::chrono::steady_clock::time_point last_arrival = std::chrono::steady_clock::now();
+	double frame_period_us = 0.0;
+	timeBeginPeriod(1);
 	
 	capture_running = true;
     while (capture_running)
@@ -163,15 +181,33 @@ void AxsunCapture::captureRun()
         retval = axGetStatus(session, &imaging, &last_packet, &last_frame, &last_image, &dropped_packets, &frames_since_sync);
         if (retval != AxErr::NO_AxERROR)
         {
+			timeEndPeriod(1);
             dumpCaptureError(retval, pPreamble);
             return;
         }
 		
 		// only new image allowed
         if (last_image == last_image0)
+		{
+			double wait_us = MIN_POLL_WAIT_US;
+			if (frame_period_us > 0)
+			{
+				double elapsed_us = (double)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - last_arrival).count();
+				double remaining_us = 0.9 * frame_period_us - elapsed_us;
+				wait_us = (remaining_us > 0) ? remaining_us : frame_period_us / 8;
+			}
+			wait_us = (wait_us < MIN_POLL_WAIT_US) ? MIN_POLL_WAIT_US : ((wait_us > MAX_POLL_WAIT_US) ? MAX_POLL_WAIT_US : wait_us);
+			std::this_thread::sleep_for(std::chrono::microseconds((int)wait_us));
             continue;
+		}
 		last_image0 = last_image;
 
+		// Frame period (exponential moving average of the arrival intervals)
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		double interval_us = (double)std::chrono::duration_cast<std::chrono::microseconds>(now - last_arrival).count();
+		frame_period_us = (frame_period_us > 0) ? 0.9 * frame_period_us + 0.1 * interval_us : interval_us;
+		last_arrival = now;
+
 		// get information about an image to be retreived from the main image buffer.
         if (imaging)
         {
@@ -189,14 +225,29 @@ void AxsunCapture::captureRun()
 				///	continue;
 				///}
 
+				// Images the loop did not get to in time
+				if (last_image_number && (info.image_number > last_image_number + 1))
+				{
+					dropped_images += info.image_number - last_image_number - 1;
+					droppedImagesUpdate += info.image_number - last_image_number - 1;
+				}
+				last_image_number = info.image_number;
+
                 // Determine where new data transfer data will go.
-                cur_section = &image_data_out(0, image_width * (loop_counter % 4));
+                cur_section = &image_data_out(0, image_width * (loop_counter % ring_size));
 
                 // if no errors, configure the request preferences and then request the image for display
-                retval = axRequestImage(session, info.image_number, prefs, 2 * image_width * image_height, cur_section, &info);
-//                if (retval == AxErr::NO_AxERROR)
+                retval = axRequestImage(session, info.image_number, prefs, section_size, cur_section, &info);
+                if (retval != AxErr::NO_AxERROR)
+				{
+					dropped_images++;
+					droppedImagesUpdate++;
+				}
+				else
                 {
                     np::Uint8Array2 frame(cur_section, info.height, image_width);
+					current_stamp.sequence = info.image_number;
+					current_stamp.timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(now.time_since_epoch()).count();
                     DidAcquireData(frameIndex++, frame);
                     frameIndexUpdate++;
 
@@ -232,19 +283,24 @@ void AxsunCapture::captureRun()
                             sprintf(msg, "imaging: %d, width: %d, last_packet: %d, last_frame: %d, last_image: %d, dropped_packets: %d, frame_since_sync: %d",
                                 imaging, info.width, last_packet, last_frame, last_image, dropped_packets, frames_since_sync);
                             SendStatusMessage(msg, false);
+							if (droppedImagesUpdate)
+							{
+								sprintf(msg, "[Axsun Catpure] %d images dropped since the last update (%d in total)", droppedImagesUpdate, dropped_images);
+								SendStatusMessage(msg, false);
+							}
                         }
 
                         // Reset
                         frameIndexUpdate = 0;
                         bytesAcquiredUpdate = 0;
+						droppedImagesUpdate = 0;
                     }
                 }
             }
         }
 
-		// loop timer for approximately 50 fps update rate
-		std::this_thread::sleep_for(0ms);
 	}
+	timeEndPeriod(1);
 
 	retval = axStopSession(session);
 	if (retval != AxErr::NO_AxERROR)
@@ -3,6 +3,7 @@
 
 #include <Common/array.h>
 #include <Common/callback.h>
+#include <Common/FrameStamp.h>
 
 #include <iostream>
 #include <thread>
@@ -13,6 +14,9 @@
 // Capture
 #define ENABLE_OPENGL_WINDOW false
 #define PACKET_CAPACITY      2000
+#define AXSUN_RING_SIZE      8 // image sections handed to the consumers
+#define MIN_POLL_WAIT_US     200
+#define MAX_POLL_WAIT_US     5000
 
 
 class AxsunCapture
@@ -52,9 +56,12 @@ public:
 	bool _dirty;
 	bool capture_running;
     int image_width, image_height;
+	int ring_size;
 	uint32_t returned_image;
 	np::Uint8Array2 image_data_out;
     uint32_t dropped_packets;
+	uint32_t dropped_images; // skipped by the capture loop or failed to be requested
+	FrameStamp current_stamp; // acquisition metadata of the image inside DidAcquireData
 	double frameRate;
 
 	// callbacks
@@ -0,0 +1,629 @@
+#include "BatchProcessing.h"
+
+#include <Havana3/QViewTab.h>
+#include <Havana3/Dialog/ViewOptionTab.h>
+
+#include <DataAcquisition/DataProcessing.h>
+#include <DataAcquisition/FLImProcess/FLImProcess.h>
+#include <DataAcquisition/OCTProcess/OCTProcess.h>
+#include <DataAcquisition/FlimMapCache.h>
+
+#include <Common/medfilt.h>
+#include <Common/lumen_detection.h>
+#include <Common/random_forest.h>
+#include <Common/support_vector_machine.h>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QTextStream>
+
+#include <ipps.h>
+#include <ippi.h>
+
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+
+#include <atomic>
+#include <chrono>
+
+
+BatchProcessing::BatchProcessing(Configuration* pConfig) :
+	m_pConfig(pConfig), m_nThreads(BATCH_THREAD_BUDGET), m_nMemoryBudget((qint64)BATCH_MEMORY_BUDGET * 1048576),
+	m_bForce(false), m_nMemoryInUse(0), m_pForest(nullptr), m_pSVM(nullptr)
+{
+}
+
+BatchProcessing::~BatchProcessing()
+{
+	if (m_pForest) delete m_pForest;
+	if (m_pSVM) delete m_pSVM;
+}
+
+
+bool BatchProcessing::run(const QStringList& inputs)
+{
+	QStringList records = getRecordList(inputs);
+	if (records.isEmpty())
+	{
+		sendMessage("No record to process.", true);
+		return false;
+	}
+
+	int n_threads = (m_nThreads > 0) ? m_nThreads : (int)std::thread::hardware_concurrency();
+	if (n_threads < 1) n_threads = 1;
+	int n_workers = qMin(qMin(BATCH_MAX_RECORDS, n_threads), records.size());
+
+	sendMessage(QString("Batch reprocessing of %1 records... (threads: %2, records in flight: %3, memory budget: %4 MB)")
+		.arg(records.size()).arg(n_threads).arg(n_workers).arg(m_nMemoryBudget / 1048576));
+
+	// Every record in flight runs its parallel kernels in the same arena, so the thread budget holds globally
+	tbb::task_arena arena(n_threads);
+
+	std::chrono::system_clock::time_point start = std::chrono::system_clock::now();
+	std::atomic<int> next_record(0), n_failed(0);
+
+	std::vector<std::thread> workers;
+	for (int w = 0; w < n_workers; w++)
+	{
+		workers.push_back(std::thread([&]() {
+			np::memory::subsystem_scope mem_scope(_MEM_BATCH_);
+			int i;
+			while ((i = next_record++) < records.size())
+			{
+				qint64 memory = 0;
+				{
+					BatchRecord record;
+					if (!openRecord(records.at(i), record))
+					{
+						n_failed++;
+						continue;
+					}
+
+					// Waits until the record fits in the memory budget
+					memory = record.memory;
+					reserveMemory(memory);
+
+					bool success = false;
+					arena.execute([&]() { success = processRecord(record); });
+					if (!success)
+						n_failed++;
+
+					delete record.pConfig;
+				}
+
+				// The buffers of the record are gone
+				releaseMemory(memory);
+			}
+		}));
+	}
+	for (auto& worker : workers)
+		worker.join();
+
+	std::chrono::duration<double> elapsed = std::chrono::system_clock::now() - start;
+	sendMessage(QString("Finished batch reprocessing: %1 succeeded, %2 failed (elapsed time: %3 sec, peak array memory: %4 MB)")
+		.arg(records.size() - n_failed).arg((int)n_failed).arg(elapsed.count(), 0, 'f', 2).arg(np::memory::peak_bytes() >> 20), n_failed > 0);
+
+	return n_failed == 0;
+}
+
+
+QStringList BatchProcessing::getRecordList(const QStringList& inputs)
+{
+	QStringList records;
+	for (const QString& input : inputs)
+	{
+		QFileInfo info(input);
+		if (info.isDir())
+			records << QDir(info.absoluteFilePath()).filePath("pullback.data");
+		else if (info.fileName() == "pullback.data")
+			records << info.absoluteFilePath();
+		else
+		{
+			// List file: one record per line, # for comments
+			QFile file(input);
+			if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+				continue;
+
+			QStringList lines;
+			QTextStream stream(&file);
+			while (!stream.atEnd())
+			{
+				QString line = stream.readLine().trimmed();
+				if (!line.isEmpty() && !line.startsWith('#'))
+					lines << line;
+			}
+			file.close();
+
+			records << getRecordList(lines);
+		}
+	}
+	records.removeDuplicates();
+
+	return records;
+}
+
+bool BatchProcessing::openRecord(const QString& fileName, BatchRecord& record)
+{
+	QFileInfo info(fileName);
+	if (!info.exists())
+	{
+		sendMessage(QString("Invalid record: %1").arg(fileName), true);
+		return false;
+	}
+
+	record.fileName = fileName;
+	record.fileTitle = fileName.left(fileName.lastIndexOf('.'));
+	record.pConfig = new Configuration;
+
+	Configuration* pConfig = record.pConfig;
+	pConfig->getConfigFile(record.fileTitle + ".ini");
+
+	// Same frame count as the review (DataProcessing::startProcessing)
+#ifndef NEXT_GEN_SYSTEM
+	record.frameSize = sizeof(uint8_t) * (pConfig->axsunPipelineMode == 0 ? 1 : 4) * (qint64)pConfig->octFrameSize
+		+ sizeof(uint16_t) * (qint64)pConfig->flimFrameSize;
+#else
+	record.frameSize = sizeof(float) * (qint64)pConfig->octFrameSize + sizeof(uint16_t) * (qint64)pConfig->flimFrameSize;
+#endif
+	pConfig->frames = (record.frameSize > 0) ? (int)(info.size() / record.frameSize) : 0;
+	if (pConfig->frames < 2)
+	{
+		sendMessage(QString("Invalid record (no frame): %1").arg(fileName), true);
+		delete record.pConfig;
+		record.pConfig = nullptr;
+		return false;
+	}
+
+	// FLIm maps, synchronized copies, ratio & proportion, features, composition probability, and the OCT images
+	qint64 flim_map = sizeof(float) * (qint64)pConfig->flimAlines * pConfig->frames;
+	record.memory = flim_map * (14 + 6 + 6 + ML_N_FEATURES + 2 * ML_N_CATS)
+		+ sizeof(uint8_t) * (qint64)pConfig->octRadius * pConfig->octAlines * pConfig->frames + 2 * record.frameSize;
+
+	return true;
+}
+
+bool BatchProcessing::processRecord(BatchRecord& record)
+{
+	std::chrono::system_clock::time_point start = std::chrono::system_clock::now();
+
+	Configuration* pConfig = record.pConfig;
+	QString folder = QFileInfo(record.fileName).absolutePath();
+	QString vib_corr_path = QDir(folder).filePath("vib_corr.idx");
+	QString lumen_contour_path = QDir(folder).filePath("lumen_contour.map");
+	QString gw_path = QDir(folder).filePath("gw_pos.csv");
+
+	sendMessage(QString("Start record reprocessing: %1 (Total nFrame: %2)").arg(folder).arg(pConfig->frames));
+
+	// Buffers (as QViewTab::setBuffers) ////////////////////////////////////////////////////////////
+	for (int i = 0; i < 4; i++)
+	{
+		record.pulsepowerMap.push_back(np::FloatArray2(pConfig->flimAlines, pConfig->frames));
+		record.meandelayMap.push_back(np::FloatArray2(pConfig->flimAlines, pConfig->frames));
+	}
+	for (int i = 0; i < 3; i++)
+	{
+		record.intensityMap.push_back(np::FloatArray2(pConfig->flimAlines, pConfig->frames));
+		record.lifetimeMap.push_back(np::FloatArray2(pConfig->flimAlines, pConfig->frames));
+	}
+
+	std::vector<np::FloatArray2*> maps;
+	for (auto& map : record.pulsepowerMap) maps.push_back(&map);
+	for (auto& map : record.intensityMap) maps.push_back(&map);
+	for (auto& map : record.meandelayMap) maps.push_back(&map);
+	for (auto& map : record.lifetimeMap) maps.push_back(&map);
+
+	// What is already there ////////////////////////////////////////////////////////////////////////
+	FlimMapCache flim_map_cache(record.fileTitle + ".flim_cache", record.fileTitle + ".compo_cache");
+	{
+		QFile file(record.fileName);
+		if (!file.open(QFile::ReadOnly))
+		{
+			sendMessage(QString("Cannot open the record: %1").arg(record.fileName), true);
+			return false;
+		}
+		flim_map_cache.setKey(&file, pConfig, record.fileTitle + ".flim_mask");
+		file.close();
+	}
+	bool flim_cached = !m_bForce && flim_map_cache.read(maps);
+	bool vib_corr_exists = !m_bForce && QFileInfo::exists(vib_corr_path);
+	bool lumen_contour_exists = !m_bForce && QFileInfo::exists(lumen_contour_path);
+#ifndef NEXT_GEN_SYSTEM
+	bool need_oct = !vib_corr_exists || !lumen_contour_exists;
+#else
+	bool need_oct = false; // the vibration correction & lumen detection work on 8-bit OCT images only
+#endif
+
+	// FLIm maps & OCT images ///////////////////////////////////////////////////////////////////////
+	if (!flim_cached || need_oct)
+	{
+		if (!loadingRawData(record, !flim_cached, need_oct))
+			return false;
+
+		if (!flim_cached)
+		{
+			medfilt medfilt_intensity(pConfig->flimAlines, pConfig->frames, 5, 3, true);
+			medfilt medfilt_lifetime(pConfig->flimAlines, pConfig->frames, 7, 5, true);
+			DataProcessing::filterFlimMaps(record.intensityMap, record.lifetimeMap, &medfilt_intensity, &medfilt_lifetime);
+
+			if (!flim_map_cache.write(maps))
+				sendMessage(QString("Failed to write the FLIm map cache: %1").arg(flim_map_cache.getPath()), true);
+		}
+	}
+
+	// Vibration correction & lumen contour /////////////////////////////////////////////////////////
+	record.vibCorrIdx = np::Uint16Array(pConfig->frames);
+	memset(record.vibCorrIdx, 0, sizeof(uint16_t) * record.vibCorrIdx.length());
+#ifndef NEXT_GEN_SYSTEM
+	if (need_oct || (vib_corr_exists && m_pConfig->autoVibCorrectionMode))
+		vibrationCorrection(record, vib_corr_path, vib_corr_exists);
+
+	if (!lumen_contour_exists)
+	{
+		if (!lumenContourDetection(record, lumen_contour_path, gw_path))
+			sendMessage(QString("Failed to write the lumen contour: %1").arg(lumen_contour_path), true);
+	}
+
+	{ std::vector<np::Uint8Array2> clear_vector;
+	clear_vector.swap(record.vectorOctImage); }
+#endif
+
+	// Plaque composition ///////////////////////////////////////////////////////////////////////////
+	bool success = compositionPrediction(record, &flim_map_cache);
+
+	std::chrono::duration<double> elapsed = std::chrono::system_clock::now() - start;
+	sendMessage(QString("Finished record reprocessing: %1 (FLIm maps: %2, elapsed time: %3 sec)")
+		.arg(folder).arg(flim_cached ? "cached" : "processed").arg(elapsed.count(), 0, 'f', 2));
+
+	return success;
+}
+
+
+bool BatchProcessing::loadingRawData(BatchRecord& record, bool flim, bool oct)
+{
+	Configuration* pConfig = record.pConfig;
+
+	QFile file(record.fileName);
+	if (!file.open(QFile::ReadOnly))
+	{
+		sendMessage(QString("Cannot open the record: %1").arg(record.fileName), true);
+		return false;
+	}
+
+	// Same FLIm & OCT processing as the review (DataProcessing::deinterleaving, flimProcessing)
+	FLImProcess* pFLIm = nullptr;
+	if (flim)
+	{
+		pFLIm = new FLImProcess;
+		pFLIm->setParameters(pConfig);
+		pFLIm->_resize(np::Uint16Array2(pConfig->flimScans, pConfig->flimAlines), pFLIm->_params);
+		pFLIm->loadMaskData(record.fileTitle + ".flim_mask");
+	}
+
+	OCTProcess* pOCT = nullptr;
+#ifndef NEXT_GEN_SYSTEM
+	if (oct)
+	{
+		if (pConfig->axsunPipelineMode == 1)
+		{
+			pOCT = new OCTProcess(pConfig->octScans * 2, pConfig->octAlines);
+			pOCT->changeDiscomValue(pConfig->axsunDispComp_a2);
+		}
+
+		for (int i = 0; i < pConfig->frames; i++)
+		{
+			np::Uint8Array2 buffer(pConfig->octRadius, pConfig->octAlines);
+			memset(buffer, 0, sizeof(uint8_t) * buffer.length());
+			record.vectorOctImage.push_back(buffer);
+		}
+	}
+#endif
+
+	np::Uint8Array frame_data((int)record.frameSize);
+	np::Uint16Array2 pulse((uint16_t*)frame_data.raw_ptr(), pConfig->flimScans, pConfig->flimAlines);
+
+	np::Array<float, 2> itn(pConfig->flimAlines, 4); // temp intensity
+	np::Array<float, 2> md(pConfig->flimAlines, 4); // temp mean delay
+	np::Array<float, 2> ltm(pConfig->flimAlines, 3); // temp lifetime
+
+	int frameCount = 0;
+	for (; frameCount < pConfig->frames; frameCount++)
+	{
+		if (file.read(reinterpret_cast<char*>(frame_data.raw_ptr()), record.frameSize) != record.frameSize)
+			break;
+
+		// FLIm
+		if (pFLIm)
+		{
+			(*pFLIm)(itn, md, ltm, pulse);
+
+			// Intensity compensation
+			for (int i = 0; i < 3; i++)
+				ippsDivC_32f_I(pConfig->flimIntensityComp[i], &itn(0, i + 1), pConfig->flimAlines);
+
+			for (int i = 0; i < 4; i++)
+			{
+				memcpy(&record.pulsepowerMap.at(i)(0, frameCount), &pFLIm->_resize.pulse_power(0, i), sizeof(float) * pConfig->flimAlines);
+				memcpy(&record.meandelayMap.at(i)(0, frameCount), &md(0, i), sizeof(float) * pConfig->flimAlines);
+			}
+			for (int i = 0; i < 3; i++)
+			{
+				memcpy(&record.intensityMap.at(i)(0, frameCount), &itn(0, i + 1), sizeof(float) * pConfig->flimAlines);
+				memcpy(&record.lifetimeMap.at(i)(0, frameCount), &ltm(0, i), sizeof(float) * pConfig->flimAlines);
+			}
+		}
+
+		// OCT
+#ifndef NEXT_GEN_SYSTEM
+		if (oct)
+		{
+			uint8_t* frame_ptr = frame_data.raw_ptr() + sizeof(uint16_t) * pConfig->flimFrameSize;
+
+			np::Uint8Array2 oct_data(pConfig->octScans, pConfig->octAlines);
+			if (pConfig->axsunPipelineMode == 0)
+				memcpy(oct_data, frame_ptr, sizeof(uint8_t) * pConfig->octFrameSize);
+			else
+				(*pOCT)(oct_data.raw_ptr(), (int16_t*)frame_ptr, pConfig->axsunDbRange.min, pConfig->axsunDbRange.max);
+
+			IppiSize roi_oct = { pConfig->octScans, pConfig->octAlines };
+			if (pConfig->verticalMirroring)
+				ippiMirror_8u_C1IR(oct_data, roi_oct.width, roi_oct, ippAxsVertical);
+
+			ippiCopy_8u_C1R(oct_data + pConfig->innerOffsetLength, roi_oct.width,
+				record.vectorOctImage.at(frameCount).raw_ptr(), roi_oct.width,
+				{ roi_oct.width - pConfig->innerOffsetLength, roi_oct.height });
+		}
+#endif
+	}
+	file.close();
+
+	if (pFLIm) delete pFLIm;
+	if (pOCT) delete pOCT;
+
+	if (frameCount != pConfig->frames)
+	{
+		sendMessage(QString("Truncated record (%1 of %2 frames): %3").arg(frameCount).arg(pConfig->frames).arg(record.fileName), true);
+		return false;
+	}
+
+	return true;
+}
+
+void BatchProcessing::vibrationCorrection(BatchRecord& record, const QString& vib_corr_path, bool exists)
+{
+	// Same correction as QViewTab::vibrationCorrection: the index chains from frame to frame, so it runs in order
+	if (!exists)
+	{
+		for (int i = 0; i < (int)record.vectorOctImage.size() - 1; i++)
+		{
+			int cidx = QViewTab::findVibCorrIdx(record.vectorOctImage.at(i), record.vectorOctImage.at(i + 1), 16);
+			QViewTab::circShift(record.vectorOctImage.at(i + 1), cidx);
+			record.vibCorrIdx(i + 1) = cidx;
+		}
+
+		QFile file(vib_corr_path);
+		if (file.open(QIODevice::WriteOnly))
+		{
+			file.write(reinterpret_cast<const char*>(record.vibCorrIdx.raw_ptr()), sizeof(uint16_t) * record.vibCorrIdx.length());
+			file.close();
+		}
+		else
+			sendMessage(QString("Failed to write the vibration correction: %1").arg(vib_corr_path), true);
+	}
+	else
+	{
+		QFile file(vib_corr_path);
+		if (file.open(QIODevice::ReadOnly))
+		{
+			file.read(reinterpret_cast<char*>(record.vibCorrIdx.raw_ptr()), sizeof(uint16_t) * record.vibCorrIdx.length());
+			file.close();
+		}
+
+		for (int i = 1; i < (int)record.vectorOctImage.size(); i++)
+			QViewTab::circShift(record.vectorOctImage.at(i), record.vibCorrIdx(i));
+	}
+}
+
+bool BatchProcessing::lumenContourDetection(BatchRecord& record, const QString& lumen_contour_path, const QString& gw_path)
+{
+	Configuration* pConfig = record.pConfig;
+	if ((int)record.vectorOctImage.size() != pConfig->frames)
+		return false;
+
+	// Same detection as QViewTab::lumenContourDetection (the images are vibration corrected, the contour is not)
+	np::FloatArray2 contour_map(pConfig->octAlines, pConfig->frames);
+	std::vector<std::vector<int>> gw_poss(pConfig->frames);
+
+	tbb::parallel_for(tbb::blocked_range<int>(0, pConfig->frames),
+		[&](const tbb::blocked_range<int>& r) {
+		LumenDetection lumen_detection(int(OUTER_SHEATH_POSITION / PIXEL_RESOLUTION_SAMSUNG), pConfig->innerOffsetLength, false);
+		np::Uint8Array2 oct_image(pConfig->octRadius, pConfig->octAlines);
+
+		for (int i = r.begin(); i != r.end(); ++i)
+		{
+			np::FloatArray contour(&contour_map(0, i), contour_map.size(0));
+
+			memset(oct_image, 0, sizeof(uint8_t) * oct_image.length());
+			QViewTab::scaleOctImage(pConfig, record.vectorOctImage.at(i), oct_image, pConfig->reflectionRemoval);
+			lumen_detection(oct_image, contour);
+			std::rotate(&contour(0), &contour(contour.length() - record.vibCorrIdx(i)), &contour(contour.length()));
+
+			for (int j = 0; j < (int)lumen_detection.gw_peaks_exp.size(); j++)
+			{
+				int gp = lumen_detection.gw_peaks_exp.at(j) - pConfig->octAlines / 2;
+				gp += record.vibCorrIdx(i);
+				if (gp > pConfig->octAlines)
+					gp -= pConfig->octAlines;
+				gw_poss.at(i).push_back(gp);
+			}
+		}
+	});
+
+	// Compensating circ offset
+	ippsAddC_32f_I(-pConfig->circOffset, contour_map.raw_ptr(), contour_map.length());
+
+	// Guide-wire positions in frame order
+	QFile gw_file(gw_path);
+	if (gw_file.open(QFile::WriteOnly))
+	{
+		QTextStream stream(&gw_file);
+		for (int i = 0; i < pConfig->frames; i++)
+		{
+			stream << i + 1 << "\t";
+			for (int gp : gw_poss.at(i))
+				stream << gp << "\t";
+			stream << "\n";
+		}
+		gw_file.close();
+	}
+
+	// The contour last: its presence is what the review checks
+	QFile file(lumen_contour_path);
+	if (!file.open(QIODevice::WriteOnly))
+		return false;
+	file.write(reinterpret_cast<const char*>(contour_map.raw_ptr()), sizeof(float) * contour_map.length());
+	file.close();
+
+	return true;
+}
+
+bool BatchProcessing::compositionPrediction(BatchRecord& record, FlimMapCache* pFlimMapCache)
+{
+	Configuration* pConfig = record.pConfig;
+
+	// The state the review opens in: prediction mode & auto vibration correction of this workstation
+	int ml_mode = (m_pConfig->mlPredictionMode == _RF_COMPO_) ? _RF_COMPO_ : _SVM_SOFTMAX_;
+	bool vib_corrected = m_pConfig->autoVibCorrectionMode;
+	int32_t tag = FlimMapCache::compositionTag(ml_mode, vib_corrected, pConfig->flimDelaySync);
+
+	std::vector<np::FloatArray2> prob_maps;
+	std::vector<np::FloatArray2*> maps;
+	for (int i = 0; i < ((ml_mode == _RF_COMPO_) ? 1 : 2); i++)
+		prob_maps.push_back(np::FloatArray2(ML_N_CATS * pConfig->flimAlines, pConfig->frames));
+	for (auto& map : prob_maps) maps.push_back(&map);
+
+	// Predicted ahead by the same model (fingerprinted by its files, so a model update is predicted again)
+	if (!m_bForce && pFlimMapCache->readComposition(maps, tag, FlimMapCache::modelFingerprint(ml_mode == _RF_COMPO_)))
+		return true;
+
+	// FLIm maps as the review corrects them (QViewTab::vibrationCorrection)
+	if (vib_corrected)
+	{
+		for (int ch = 0; ch < 3; ch++)
+		{
+			np::FloatArray2 sync_intensity(record.intensityMap.at(ch).size(0), record.intensityMap.at(ch).size(1));
+			np::FloatArray2 sync_lifetime(record.lifetimeMap.at(ch).size(0), record.lifetimeMap.at(ch).size(1));
+			memset(sync_intensity, 0, sizeof(float) * sync_intensity.length());
+			memset(sync_lifetime, 0, sizeof(float) * sync_lifetime.length());
+			QViewTab::makeDelay(record.intensityMap.at(ch), sync_intensity, pConfig->flimDelaySync);
+			QViewTab::makeDelay(record.lifetimeMap.at(ch), sync_lifetime, pConfig->flimDelaySync);
+
+			tbb::parallel_for(tbb::blocked_range<int>(1, pConfig->frames),
+				[&](const tbb::blocked_range<int>& r) {
+				for (int i = r.begin(); i != r.end(); ++i)
+				{
+					QViewTab::shiftFlimLine(sync_intensity, record.intensityMap.at(ch), i, record.vibCorrIdx(i));
+					QViewTab::shiftFlimLine(sync_lifetime, record.lifetimeMap.at(ch), i, record.vibCorrIdx(i));
+				}
+			});
+		}
+	}
+
+	// Features
+	std::vector<np::FloatArray2> ratio, proportion;
+	for (int i = 0; i < 3; i++)
+	{
+		ratio.push_back(np::FloatArray2(pConfig->flimAlines, pConfig->frames));
+		proportion.push_back(np::FloatArray2(pConfig->flimAlines, pConfig->frames));
+	}
+	np::FloatArray2 features(ML_N_FEATURES, pConfig->flimAlines * pConfig->frames);
+	DataProcessing::calculateFlimFeatures(record.intensityMap, record.lifetimeMap, ratio, proportion, features);
+
+	// Prediction
+	{
+		std::unique_lock<std::mutex> lock(mtx_model);
+		if (ml_mode == _RF_COMPO_)
+		{
+			if (!m_pForest)
+			{
+				m_pForest = new RandomForest();
+				m_pForest->createForest(RF_N_TREES, ML_N_FEATURES, ML_N_CATS, CLASSIFICATION);
+				if (!m_pForest->load(RF_COMPO_MODEL_NAME))
+				{
+					if (m_pForest->train(ML_COMPO_DATASET_NAME))
+						m_pForest->save(RF_COMPO_MODEL_NAME);
+					else
+					{
+						delete m_pForest;
+						m_pForest = nullptr;
+					}
+				}
+			}
+			if (!m_pForest)
+			{
+				sendMessage("No random forest model: the composition maps are not predicted.", true);
+				return false;
+			}
+			m_pForest->predict(features, prob_maps.at(0));
+		}
+		else
+		{
+			if (!m_pSVM)
+			{
+				m_pSVM = new SupportVectorMachine();
+				m_pSVM->createMachine(ML_N_FEATURES, ML_N_CATS);
+				if (!m_pSVM->load(SVM_COMPO_MODEL_NAME))
+				{
+					if (m_pSVM->train(ML_COMPO_DATASET_NAME))
+						m_pSVM->save(SVM_COMPO_MODEL_NAME);
+					else
+					{
+						delete m_pSVM;
+						m_pSVM = nullptr;
+					}
+				}
+			}
+			if (!m_pSVM)
+			{
+				sendMessage("No support vector machine model: the composition maps are not predicted.", true);
+				return false;
+			}
+			m_pSVM->predict(features, prob_maps.at(0), prob_maps.at(1));
+		}
+	}
+
+	if (!pFlimMapCache->writeComposition(maps, tag, FlimMapCache::modelFingerprint(ml_mode == _RF_COMPO_)))
+	{
+		sendMessage(QString("Failed to write the composition map cache: %1").arg(record.fileTitle + ".compo_cache"), true);
+		return false;
+	}
+
+	return true;
+}
+
+
+void BatchProcessing::reserveMemory(qint64 bytes)
+{
+	// A record larger than the whole budget still runs, but alone
+	std::unique_lock<std::mutex> lock(mtx_memory);
+	cv_memory.wait(lock, [&]() { return (m_nMemoryInUse == 0) || (m_nMemoryInUse + bytes <= m_nMemoryBudget); });
+	m_nMemoryInUse += bytes;
+}
+
+void BatchProcessing::releaseMemory(qint64 bytes)
+{
+	{
+		std::unique_lock<std::mutex> lock(mtx_memory);
+		m_nMemoryInUse -= bytes;
+	}
+	cv_memory.notify_all();
+}
+
+
+void BatchProcessing::sendMessage(const QString& msg, bool is_error)
+{
+	// Records report from their own threads
+	std::unique_lock<std::mutex> lock(mtx_message);
+	QByteArray msg8 = msg.toUtf8();
+	SendStatusMessage(msg8.constData(), is_error);
+}
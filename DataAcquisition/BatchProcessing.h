@@ -0,0 +1,97 @@
+#ifndef BATCHPROCESSING_H
+#define BATCHPROCESSING_H
+
+#include <QString>
+#include <QStringList>
+
+#include <Havana3/Configuration.h>
+
+#include <Common/array.h>
+#include <Common/callback.h>
+
+#include <tbb/task_arena.h>
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+
+class Configuration;
+class FlimMapCache;
+class RandomForest;
+class SupportVectorMachine;
+
+// Review outputs of a record: everything the result tab would otherwise compute on opening
+struct BatchRecord
+{
+	QString fileName; // pullback.data
+	QString fileTitle;
+	Configuration* pConfig = nullptr;
+	qint64 frameSize = 0; // bytes
+	qint64 memory = 0; // bytes reserved while in flight
+
+	std::vector<np::FloatArray2> pulsepowerMap; // (256 x N) x 4
+	std::vector<np::FloatArray2> intensityMap; // (256 x N) x 3
+	std::vector<np::FloatArray2> meandelayMap; // (256 x N) x 4
+	std::vector<np::FloatArray2> lifetimeMap; // (256 x N) x 3
+	std::vector<np::Uint8Array2> vectorOctImage;
+	np::Uint16Array vibCorrIdx;
+};
+
+class BatchProcessing
+{
+// Constructer & Destructer /////////////////////////////
+public:
+	explicit BatchProcessing(Configuration* pConfig);
+	virtual ~BatchProcessing();
+
+// Methods //////////////////////////////////////////////
+public:
+	inline void setThreadBudget(int n_threads) { m_nThreads = n_threads; }
+	inline void setMemoryBudget(qint64 bytes) { m_nMemoryBudget = bytes; }
+	inline void setForce(bool force) { m_bForce = force; } // recompute & overwrite the outputs already there
+
+	// Record folders, pullback.data files or text files listing one of them per line; false if any record failed
+	bool run(const QStringList& inputs);
+
+private:
+	static QStringList getRecordList(const QStringList& inputs);
+	bool openRecord(const QString& fileName, BatchRecord& record);
+	bool processRecord(BatchRecord& record);
+
+	bool loadingRawData(BatchRecord& record, bool flim, bool oct);
+	void vibrationCorrection(BatchRecord& record, const QString& vib_corr_path, bool exists);
+	bool lumenContourDetection(BatchRecord& record, const QString& lumen_contour_path, const QString& gw_path);
+	bool compositionPrediction(BatchRecord& record, FlimMapCache* pFlimMapCache);
+
+	void reserveMemory(qint64 bytes);
+	void releaseMemory(qint64 bytes);
+
+	void sendMessage(const QString& msg, bool is_error = false);
+
+// Variables ////////////////////////////////////////////
+private:
+	Configuration* m_pConfig;
+	int m_nThreads;
+	qint64 m_nMemoryBudget;
+	bool m_bForce;
+
+	// Memory of the records in flight
+	std::mutex mtx_memory;
+	std::condition_variable cv_memory;
+	qint64 m_nMemoryInUse;
+
+	// Composition models (loaded once, predictions are serialized: each one already runs on the whole arena)
+	std::mutex mtx_model;
+	RandomForest* m_pForest;
+	SupportVectorMachine* m_pSVM;
+
+	std::mutex mtx_message;
+
+public:
+	callback2<const char*, bool> SendStatusMessage;
+};
+
+#endif // BATCHPROCESSING_H
@@ -114,6 +114,7 @@ bool DataAcquisition::InitializeAcquistion()
 #ifdef AXSUN_ENABLE
 	m_pAxsunCapture->image_height = (m_pConfig->axsunPipelineMode == 0) ? m_pConfig->octScans : 4 * m_pConfig->octScans;
 	m_pAxsunCapture->image_width = m_pConfig->octAlines;
+	m_pAxsunCapture->ring_size = (m_pConfig->axsunRingSize > 0) ? m_pConfig->axsunRingSize : AXSUN_RING_SIZE;
 #endif
 #ifndef MAC_OS
     m_pDaq->nScans = m_pConfig->flimScans;
@@ -192,6 +193,9 @@ bool DataAcquisition::StartAcquisition()
     // Parameter settings for DAQ
 #ifndef MAC_OS
     m_pDaq->DcOffset = m_pConfig->px14DcOffset;
+	if (m_pConfig->px14RingFrames > 0) m_pDaq->nRingFrames = m_pConfig->px14RingFrames;
+	if (m_pConfig->px14ChunksPerFrame > 0) m_pDaq->nChunksPerFrame = m_pConfig->px14ChunksPerFrame;
+	if (m_pConfig->px14FramesPerCallback > 0) m_pDaq->nFramesPerCallback = m_pConfig->px14FramesPerCallback;
 #endif
 
     // Start acquisition
@@ -252,6 +256,33 @@ void DataAcquisition::StopAcquisition()
 }
 
 
+FrameStamp DataAcquisition::getFlimFrameStamp() const
+{
+#ifndef NEXT_GEN_SYSTEM
+#ifndef MAC_OS
+	return m_pDaq->current_stamp;
+#else
+	return FrameStamp();
+#endif
+#else
+	return m_pDaqFlim->current_stamp;
+#endif
+}
+
+FrameStamp DataAcquisition::getOctFrameStamp() const
+{
+#ifndef NEXT_GEN_SYSTEM
+#ifdef AXSUN_ENABLE
+	return m_pAxsunCapture->current_stamp;
+#else
+	return FrameStamp();
+#endif
+#else
+	return m_pDaqOct->current_stamp;
+#endif
+}
+
+
 void DataAcquisition::GetBootTimeBufCfg(int idx, int& buffer_size)
 {
 #ifndef NEXT_GEN_SYSTEM
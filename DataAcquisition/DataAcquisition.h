@@ -5,6 +5,7 @@
 
 #include <Common/array.h>
 #include <Common/callback.h>
+#include <Common/FrameStamp.h>
 
 
 class Configuration;
@@ -35,6 +36,10 @@ public:
 	inline bool getAcquisitionState() { return m_bAcquisitionState; }
 	inline bool getPauseState() { return m_bIsPaused; }
 
+	// Valid inside the acquired data callbacks
+	FrameStamp getFlimFrameStamp() const;
+	FrameStamp getOctFrameStamp() const;
+
 public:
     bool InitializeAcquistion();
     bool StartAcquisition();
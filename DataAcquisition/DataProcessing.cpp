@@ -7,16 +7,19 @@
 
 #include <DataAcquisition/FLImProcess/FLImProcess.h>
 #include <DataAcquisition/OCTProcess/OCTProcess.h>
+#include <DataAcquisition/FlimMapCache.h>
 
 #include <ippcore.h>
 #include <ippvm.h>
 
+#include <QTextStream>
+
 #include <iostream>
 #include <thread>
 
 
 DataProcessing::DataProcessing(QWidget *parent)
-    : m_pConfigTemp(nullptr), m_pFLIm(nullptr), m_pOCT(nullptr)
+    : m_pConfigTemp(nullptr), m_pFLIm(nullptr), m_pOCT(nullptr), m_pFlimMapCache(nullptr), m_bFlimMapCached(false), m_nReadAheadFrames(1), m_nRequestedFrame(-1)
 {
 	// Set main window objects    
     m_pResultTab = dynamic_cast<QResultTab*>(parent);
@@ -47,6 +50,7 @@ DataProcessing::~DataProcessing()
 		delete m_pConfigTemp;
 	}
 	if (m_pFLIm) delete m_pFLIm;
+	if (m_pFlimMapCache) delete m_pFlimMapCache;
 }
 
 
@@ -57,10 +61,11 @@ void DataProcessing::startProcessing(QString fileName, int frame)
 	{
 		std::thread t1([&, fileName, frame]() {
 
+			np::memory::subsystem_scope mem_scope(_MEM_REVIEW_);
 			std::chrono::system_clock::time_point start = std::chrono::system_clock::now();
 
 			QFile file(fileName);
-			if (false == file.open(QFile::ReadOnly))
+			if (false == file.open(QFile::ReadOnly | QFile::Unbuffered)) // the loader reads whole blocks straight into the frame buffers
 			{
 				SendStatusMessage("Invalid file path! Cannot review the data.", true);
 				emit abortedProcessing();
@@ -104,12 +109,11 @@ void DataProcessing::startProcessing(QString fileName, int frame)
 				// Set Buffers & Objects ////////////////////////////////////////////////////////////////////
 				m_pResultTab->getViewTab()->setBuffers(m_pConfigTemp);
 				m_pResultTab->getViewTab()->setObjects(m_pConfigTemp);
-#ifndef NEXT_GEN_SYSTEM
-				m_syncDeinterleaving.allocate_queue_buffer(m_pConfigTemp->flimScans + m_pConfigTemp->octScans * (m_pConfigTemp->axsunPipelineMode == 0 ? 1 : 4),
-					m_pConfigTemp->octAlines, PROCESSING_BUFFER_SIZE);
-#else
-				m_syncDeinterleaving.allocate_queue_buffer(sizeof(uint16_t) * m_pConfigTemp->flimScans / 4 + sizeof(float) * m_pConfigTemp->octScansFFT / 2, m_pConfigTemp->octAlines, PROCESSING_BUFFER_SIZE);
-#endif
+
+				// Raw frames are read ahead in blocks of whole frames
+				qint64 raw_frame_size = getRawFrameSize(m_pConfigTemp);
+				m_nReadAheadFrames = (int)qMax((qint64)1, READ_AHEAD_BLOCK_SIZE / raw_frame_size);
+				m_syncDeinterleaving.allocate_queue_buffer((int)raw_frame_size, 1, READ_AHEAD_BLOCKS, m_nReadAheadFrames);
 				m_syncFlimProcessing.allocate_queue_buffer(m_pConfigTemp->flimScans, m_pConfigTemp->flimAlines, PROCESSING_BUFFER_SIZE);
 
 				// Set FLIm Object ///////////////////////////////////////////////////////////////////////////
@@ -119,6 +123,19 @@ void DataProcessing::startProcessing(QString fileName, int frame)
 				m_pFLIm->_resize(np::Uint16Array2(m_pConfigTemp->flimScans, m_pConfigTemp->flimAlines), m_pFLIm->_params);
 				m_pFLIm->loadMaskData(maskName);
 
+				// Processed FLIm maps cached by a previous review //////////////////////////////////////////
+				m_fileName = fileName;
+				if (m_pFlimMapCache) delete m_pFlimMapCache;
+				m_pFlimMapCache = new FlimMapCache(fileTitle + ".flim_cache", fileTitle + ".compo_cache");
+				m_pFlimMapCache->setKey(&file, m_pConfigTemp, maskName);
+				m_bFlimMapCached = m_pFlimMapCache->read(getFlimMaps());
+				m_dequePulseReviewFrames.clear();
+				if (m_bFlimMapCached)
+					SendStatusMessage("FLIm maps are restored from the cache.", false);
+
+				// Acquisition drops recorded beside the raw data (*.timestamps)
+				checkFrameStamps(fileTitle + ".timestamps");
+
 				if (m_pConfigTemp->axsunPipelineMode == 1)
 				{
 					if (m_pOCT) delete m_pOCT;
@@ -126,14 +143,25 @@ void DataProcessing::startProcessing(QString fileName, int frame)
 					m_pOCT->changeDiscomValue(m_pConfigTemp->axsunDispComp_a2);
 				}
 
+				// Progressive review: the frame to open with is read first ////////////////////////////////
+				{
+					std::unique_lock<std::mutex> lock(m_mtxFrameReady);
+					m_vectorFrameReady.assign(m_pConfigTemp->frames, 0);
+				}
+				int dummy;
+				while (m_queueDeinterleavingFrame.try_pop(dummy));
+				while (m_queueFlimProcessingFrame.try_pop(dummy));
+				m_nRequestedFrame = (frame > 0) ? frame - 1 : -1;
+				m_pResultTab->getViewTab()->setProgressiveState(_PROGRESSIVE_PREVIEW_);
+
 				// Get external data ////////////////////////////////////////////////////////////////////////
 				std::thread load_data([&]() { loadingRawData(&file, m_pConfigTemp); });
 
 				// Data DeInterleaving //////////////////////////////////////////////////////////////////////
-				std::thread deinterleave([&]() { deinterleaving(m_pOCT, m_pConfigTemp); });
+				std::thread deinterleave([&]() { np::memory::subsystem_scope mem_scope(_MEM_REVIEW_); deinterleaving(m_pOCT, m_pConfigTemp); });
 
 				// FLIm Process /////////////////////////////////////////////////////////////////////////////
-				std::thread flim_proc([&]() { flimProcessing(m_pFLIm, m_pConfigTemp); });
+				std::thread flim_proc([&]() { np::memory::subsystem_scope mem_scope(_MEM_REVIEW_); flimProcessing(m_pFLIm, m_pConfigTemp); });
 
 				// Wait for threads end /////////////////////////////////////////////////////////////////////
 				load_data.join();
@@ -147,11 +175,13 @@ void DataProcessing::startProcessing(QString fileName, int frame)
 				// Generate en face maps ////////////////////////////////////////////////////////////////////
 				getOctProjection(m_pResultTab->getViewTab()->m_vectorOctImage, m_pResultTab->getViewTab()->m_octProjection);
 
-				// Visualization ////////////////////////////////////////////////////////////////////////////
+				// Visualization (the preview of the progressive review stops here) //////////////////////////
+				m_pResultTab->getViewTab()->setProgressiveState(_PROGRESSIVE_FINALIZING_);
 				m_pResultTab->getViewTab()->invalidate();
 				if (m_pConfig->autoVibCorrectionMode)
 					m_pResultTab->getVibCorrectionButton()->setChecked(true);
 				m_pResultTab->getViewTab()->loadPickFrames(m_pResultTab->getViewTab()->m_vectorPickFrames);
+				m_pResultTab->getViewTab()->setProgressiveState(_PROGRESSIVE_OFF_);
 				if (frame == -1)
 					m_pResultTab->getViewTab()->getPlayButton()->setChecked(true);
 				else
@@ -167,7 +197,8 @@ void DataProcessing::startProcessing(QString fileName, int frame)
             std::chrono::duration<double> elapsed = std::chrono::system_clock::now() - start;
 
 			char msg[256];
-			sprintf(msg, "Finished record review processing... (elapsed time: %.2f sec)", elapsed.count());
+			sprintf(msg, "Finished record review processing... (elapsed time: %.2f sec, review memory: %d MB, pooled: %d MB)", elapsed.count(),
+				(int)(np::memory::live_bytes(_MEM_REVIEW_) >> 20), (int)(np::memory::pooled_bytes() >> 20));
 			SendStatusMessage(msg, false);
 		});
 
@@ -178,36 +209,47 @@ void DataProcessing::startProcessing(QString fileName, int frame)
 
 void DataProcessing::loadingRawData(QFile* pFile, Configuration* pConfig)
 {
-	int frameCount = 0;
+	qint64 frame_size = getRawFrameSize(pConfig);
+
+	// Frames are read in file order, except that a frame requested by the view is read next
+	std::vector<bool> is_read(pConfig->frames, false);
+	std::vector<uint8_t*> block;
+	int frameCount = 0, nextFrame = 0;
 	while (frameCount < pConfig->frames) /// + pConfig->interFrameSync)
 	{
-		// Get buffers from threading queues
-		uint8_t* frame_data = nullptr;
-		do
+		int start = m_nRequestedFrame.exchange(-1);
+		if ((start < 0) || (start >= pConfig->frames) || is_read.at(start))
 		{
-			{
-				std::unique_lock<std::mutex> lock(m_syncDeinterleaving.mtx);
-				if (!m_syncDeinterleaving.queue_buffer.empty())
-				{
-					frame_data = m_syncDeinterleaving.queue_buffer.front();
-					m_syncDeinterleaving.queue_buffer.pop();
-				}
-			}
+			while (is_read.at(nextFrame))
+				nextFrame++;
+			start = nextFrame;
+		}
 
-			if (frame_data)
-			{
-				// Read data from the external data
-#ifndef NEXT_GEN_SYSTEM
-				pFile->read(reinterpret_cast<char *>(frame_data), sizeof(uint16_t) * pConfig->flimFrameSize + sizeof(uint8_t) * pConfig->octFrameSize * (pConfig->axsunPipelineMode == 0 ? 1 : 4));
-#else
-				pFile->read(reinterpret_cast<char *>(frame_data), sizeof(uint16_t) * pConfig->flimFrameSize + sizeof(float) * pConfig->octFrameSize);
-#endif
-				frameCount++;
+		int n_frames = 0;
+		while ((n_frames < m_nReadAheadFrames) && (start + n_frames < pConfig->frames) && !is_read.at(start + n_frames))
+			n_frames++;
 
-				// Push the buffers to sync Queues
-				m_syncDeinterleaving.Queue_sync.push(frame_data);
-			}
-		} while (frame_data == nullptr);
+		// Get a block of buffers from threading queues: the deinterleaving returns them in read order, 
+		// so they come back as the contiguous block they were allocated in
+		m_syncDeinterleaving.acquire_block(block, n_frames);
+
+		// Read data from the external data (straight into the frame buffers, one request per contiguous run: 
+		// a whole block unless a requested frame broke the file order)
+		pFile->seek(frame_size * start);
+		SyncObject<uint8_t>::for_each_run(block, (size_t)frame_size, [&](uint8_t* ptr, int n) {
+			pFile->read(reinterpret_cast<char *>(ptr), frame_size * n);
+		});
+
+		for (int i = 0; i < n_frames; i++)
+			is_read.at(start + i) = true;
+		frameCount += n_frames;
+
+		// Push the buffers to sync Queues
+		for (int i = 0; i < n_frames; i++)
+		{
+			m_queueDeinterleavingFrame.push(start + i);
+			m_syncDeinterleaving.Queue_sync.push(block.at(i));
+		}
 	}
 }
 
@@ -222,6 +264,8 @@ void DataProcessing::deinterleaving(OCTProcess* pOCT, Configuration* pConfig)
 		uint8_t* frame_ptr = m_syncDeinterleaving.Queue_sync.pop();
 		if (frame_ptr != nullptr)
 		{
+			int frame = m_queueDeinterleavingFrame.pop();
+
 			// Get buffers from threading queues
 			uint16_t* pulse_ptr = nullptr;
 			do
@@ -243,7 +287,7 @@ void DataProcessing::deinterleaving(OCTProcess* pOCT, Configuration* pConfig)
 					memcpy(pulse_ptr, frame_ptr, sizeof(uint16_t) * pConfig->flimFrameSize);
 					if (frameCount >= 0) /// pConfig->interFrameSync)
 					{						
-						memset(pVisTab->m_vectorOctImage.at(frameCount).raw_ptr(), 0, pVisTab->m_vectorOctImage.at(frameCount).length());
+						memset(pVisTab->m_vectorOctImage.at(frame).raw_ptr(), 0, pVisTab->m_vectorOctImage.at(frame).length());
 						np::Uint8Array2 frame_data(pConfig->octScans, pConfig->octAlines);
 #ifndef NEXT_GEN_SYSTEM
 						if (pConfig->axsunPipelineMode == 0)
@@ -252,7 +296,7 @@ void DataProcessing::deinterleaving(OCTProcess* pOCT, Configuration* pConfig)
 							(*pOCT)(frame_data.raw_ptr(), (int16_t*)(frame_ptr + sizeof(uint16_t) * pConfig->flimFrameSize), 
 								pConfig->axsunDbRange.min, pConfig->axsunDbRange.max);
 #else
-						memcpy(pVisTab->m_vectorOctImage.at(frameCount).raw_ptr(), ///  - pConfig->interFrameSync
+						memcpy(pVisTab->m_vectorOctImage.at(frame).raw_ptr(), ///  - pConfig->interFrameSync
 							frame_ptr + sizeof(uint16_t) * pConfig->flimFrameSize, sizeof(float) * pConfig->octFrameSize);
 #endif
 #ifndef NEXT_GEN_SYSTEM
@@ -264,11 +308,11 @@ void DataProcessing::deinterleaving(OCTProcess* pOCT, Configuration* pConfig)
 							ippiMirror_8u_C1IR(frame_data, roi_oct.width, roi_oct, ippAxsVertical);  ///  - pConfig->interFrameSync
 
 						ippiCopy_8u_C1R(frame_data + pConfig->innerOffsetLength, roi_oct.width,  ///  - pConfig->interFrameSync
-							pVisTab->m_vectorOctImage.at(frameCount).raw_ptr(), roi_oct.width,  /// - pConfig->interFrameSync
+							pVisTab->m_vectorOctImage.at(frame).raw_ptr(), roi_oct.width,  /// - pConfig->interFrameSync
 							{ roi_oct.width - pConfig->innerOffsetLength, roi_oct.height });
 						
 						//ippiCopy_8u_C1R(frame_data, roi_oct.width, 
-						//	pVisTab->m_vectorOctImage.at(frameCount).raw_ptr() + m_pConfig->octScans - m_pConfig->innerOffsetLength, roi_oct.width,
+						//	pVisTab->m_vectorOctImage.at(frame).raw_ptr() + m_pConfig->octScans - m_pConfig->innerOffsetLength, roi_oct.width,
 						//	{ pConfig->innerOffsetLength, roi_oct.height });
 					}
 					///else
@@ -277,6 +321,7 @@ void DataProcessing::deinterleaving(OCTProcess* pOCT, Configuration* pConfig)
 					frameCount++;
 
 					// Push the buffers to sync Queues
+					m_queueFlimProcessingFrame.push(frame);
 					m_syncFlimProcessing.Queue_sync.push(pulse_ptr);
 
 					// Return (push) the buffer to the previous threading queue
@@ -307,13 +352,60 @@ void DataProcessing::flimProcessing(FLImProcess* pFLIm, Configuration* pConfig)
 	///QFile file("pulse.data");
 	///file.open(QIODevice::WriteOnly);
 
-	int frameCount = 0;
+	// Pulses for the pulse review by frame (empty ones are processed on demand: loadPulseReviewFrame)
+	pViewTab->m_vectorPulseCrop.resize(pConfig->frames);
+	pViewTab->m_vectorPulseBgSub.resize(pConfig->frames);
+	pViewTab->m_vectorPulseMask.resize(pConfig->frames);
+	pViewTab->m_vectorPulseSpline.resize(pConfig->frames);
+	pViewTab->m_vectorPulseFilter.resize(pConfig->frames);
+
+	// Processed frames are published in ranges of consecutive frames, at least every PROGRESSIVE_PUBLISH_INTERVAL msec
+	int first = -1, last = -1;
+	std::chrono::steady_clock::time_point published;
+	auto setFrameReady = [&](int frame) {
+		{
+			std::unique_lock<std::mutex> lock(m_mtxFrameReady);
+			m_vectorFrameReady.at(frame) = 1;
+		}
+
+		if ((first != -1) && (frame != last + 1))
+		{
+			emit publishedFrames(first, last);
+			first = -1;
+		}
+		if (first == -1)
+			first = frame;
+		last = frame;
+
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (now - published >= std::chrono::milliseconds(PROGRESSIVE_PUBLISH_INTERVAL))
+		{
+			emit publishedFrames(first, last);
+			first = -1;
+			published = now;
+		}
+	};
+
+	int frameCount = 0, n_evicted = 0;
 	while (frameCount < pConfig->frames) ///  + pConfig->interFrameSync)
 	{
 		// Get the buffer from the previous sync Queue
 		uint16_t* pulse_data = m_syncFlimProcessing.Queue_sync.pop();
 		if (pulse_data != nullptr)
 		{			
+			int frame = m_queueFlimProcessingFrame.pop();
+
+			// FLIm maps restored from the cache: the buffers only pass through for the OCT data
+			if (m_bFlimMapCached)
+			{
+				setFrameReady(frame);
+				emit processedSingleFrame(int(double(100 * frameCount++) / (double)pConfig->frames + 1));
+
+				std::unique_lock<std::mutex> lock(m_syncFlimProcessing.mtx);
+				m_syncFlimProcessing.queue_buffer.push(pulse_data);
+				continue;
+			}
+
 			// Pulse array definition
 			np::Uint16Array2 pulse_temp(pulse_data, pConfig->flimScans, pConfig->flimAlines);
 			np::Uint16Array2 pulse(pConfig->flimScans, pConfig->flimAlines);
@@ -325,24 +417,30 @@ void DataProcessing::flimProcessing(FLImProcess* pFLIm, Configuration* pConfig)
 			// FLIM Process
 			(*pFLIm)(itn, md, ltm, pulse);
 
-			// Copy for Pulse Review
-			np::Array<float, 2> crop(pFLIm->_resize.nx, pFLIm->_resize.ny);
-			np::Array<float, 2> bg_sub(pFLIm->_resize.nx, pFLIm->_resize.ny);
-			np::Array<float, 2> mask(pFLIm->_resize.nx, pFLIm->_resize.ny);
-			np::Array<float, 2> ext(pFLIm->_resize.nsite, pFLIm->_resize.ny);
-			np::Array<float, 2> filt(pFLIm->_resize.nsite, pFLIm->_resize.ny);
-
-			memcpy(crop, pFLIm->_resize.crop_src, crop.length() * sizeof(float));
-			memcpy(bg_sub, pFLIm->_resize.bgsb_src, bg_sub.length() * sizeof(float));
-			memcpy(mask, pFLIm->_resize.mask_src, mask.length() * sizeof(float));
-			memcpy(ext, pFLIm->_resize.ext_src, ext.length() * sizeof(float));
-			memcpy(filt, pFLIm->_resize.filt_src, filt.length() * sizeof(float));
-
-			pViewTab->m_vectorPulseCrop.push_back(crop);
-			pViewTab->m_vectorPulseBgSub.push_back(bg_sub);
-			pViewTab->m_vectorPulseMask.push_back(mask);
-			pViewTab->m_vectorPulseSpline.push_back(ext);
-			pViewTab->m_vectorPulseFilter.push_back(filt);
+			// Copy for Pulse Review (over the memory budget, left empty and processed on demand: loadPulseReviewFrame)
+			np::Array<float, 2> crop, bg_sub, mask, ext, filt;
+			if (!np::memory::over_budget())
+			{
+				crop = np::Array<float, 2>(pFLIm->_resize.nx, pFLIm->_resize.ny);
+				bg_sub = np::Array<float, 2>(pFLIm->_resize.nx, pFLIm->_resize.ny);
+				mask = np::Array<float, 2>(pFLIm->_resize.nx, pFLIm->_resize.ny);
+				ext = np::Array<float, 2>(pFLIm->_resize.nsite, pFLIm->_resize.ny);
+				filt = np::Array<float, 2>(pFLIm->_resize.nsite, pFLIm->_resize.ny);
+
+				memcpy(crop, pFLIm->_resize.crop_src, crop.length() * sizeof(float));
+				memcpy(bg_sub, pFLIm->_resize.bgsb_src, bg_sub.length() * sizeof(float));
+				memcpy(mask, pFLIm->_resize.mask_src, mask.length() * sizeof(float));
+				np::copy(ext, pFLIm->_resize.ext_src);
+				np::copy(filt, pFLIm->_resize.filt_src);
+			}
+			else
+				n_evicted++;
+
+			pViewTab->m_vectorPulseCrop.at(frame) = crop;
+			pViewTab->m_vectorPulseBgSub.at(frame) = bg_sub;
+			pViewTab->m_vectorPulseMask.at(frame) = mask;
+			pViewTab->m_vectorPulseSpline.at(frame) = ext;
+			pViewTab->m_vectorPulseFilter.at(frame) = filt;
 				
 			// Intensity compensation
 			for (int i = 0; i < 3; i++)
@@ -355,24 +453,25 @@ void DataProcessing::flimProcessing(FLImProcess* pFLIm, Configuration* pConfig)
 			// Copy for Intensity & Lifetime	
 			memcpy(pp, pFLIm->_resize.pulse_power, sizeof(float) * pp.length());
 
-			memcpy(&pViewTab->m_pulsepowerMap.at(0)(0, frameCount), &pp(0, 0), sizeof(float) * pConfig->flimAlines);
-			memcpy(&pViewTab->m_pulsepowerMap.at(1)(0, frameCount), &pp(0, 1), sizeof(float) * pConfig->flimAlines);
-			memcpy(&pViewTab->m_pulsepowerMap.at(2)(0, frameCount), &pp(0, 2), sizeof(float) * pConfig->flimAlines);
-			memcpy(&pViewTab->m_pulsepowerMap.at(3)(0, frameCount), &pp(0, 3), sizeof(float) * pConfig->flimAlines);
+			memcpy(&pViewTab->m_pulsepowerMap.at(0)(0, frame), &pp(0, 0), sizeof(float) * pConfig->flimAlines);
+			memcpy(&pViewTab->m_pulsepowerMap.at(1)(0, frame), &pp(0, 1), sizeof(float) * pConfig->flimAlines);
+			memcpy(&pViewTab->m_pulsepowerMap.at(2)(0, frame), &pp(0, 2), sizeof(float) * pConfig->flimAlines);
+			memcpy(&pViewTab->m_pulsepowerMap.at(3)(0, frame), &pp(0, 3), sizeof(float) * pConfig->flimAlines);
 
-            memcpy(&pViewTab->m_intensityMap.at(0)(0, frameCount), &itn(0, 1), sizeof(float) * pConfig->flimAlines);
-            memcpy(&pViewTab->m_intensityMap.at(1)(0, frameCount), &itn(0, 2), sizeof(float) * pConfig->flimAlines);
-            memcpy(&pViewTab->m_intensityMap.at(2)(0, frameCount), &itn(0, 3), sizeof(float) * pConfig->flimAlines);
+            memcpy(&pViewTab->m_intensityMap.at(0)(0, frame), &itn(0, 1), sizeof(float) * pConfig->flimAlines);
+            memcpy(&pViewTab->m_intensityMap.at(1)(0, frame), &itn(0, 2), sizeof(float) * pConfig->flimAlines);
+            memcpy(&pViewTab->m_intensityMap.at(2)(0, frame), &itn(0, 3), sizeof(float) * pConfig->flimAlines);
 
-			memcpy(&pViewTab->m_meandelayMap.at(0)(0, frameCount), &md(0, 0), sizeof(float) * pConfig->flimAlines);
-			memcpy(&pViewTab->m_meandelayMap.at(1)(0, frameCount), &md(0, 1), sizeof(float) * pConfig->flimAlines);
-			memcpy(&pViewTab->m_meandelayMap.at(2)(0, frameCount), &md(0, 2), sizeof(float) * pConfig->flimAlines);
-			memcpy(&pViewTab->m_meandelayMap.at(3)(0, frameCount), &md(0, 3), sizeof(float) * pConfig->flimAlines);
+			memcpy(&pViewTab->m_meandelayMap.at(0)(0, frame), &md(0, 0), sizeof(float) * pConfig->flimAlines);
+			memcpy(&pViewTab->m_meandelayMap.at(1)(0, frame), &md(0, 1), sizeof(float) * pConfig->flimAlines);
+			memcpy(&pViewTab->m_meandelayMap.at(2)(0, frame), &md(0, 2), sizeof(float) * pConfig->flimAlines);
+			memcpy(&pViewTab->m_meandelayMap.at(3)(0, frame), &md(0, 3), sizeof(float) * pConfig->flimAlines);
 
-            memcpy(&pViewTab->m_lifetimeMap.at(0)(0, frameCount), &ltm(0, 0), sizeof(float) * pConfig->flimAlines);
-            memcpy(&pViewTab->m_lifetimeMap.at(1)(0, frameCount), &ltm(0, 1), sizeof(float) * pConfig->flimAlines);
-            memcpy(&pViewTab->m_lifetimeMap.at(2)(0, frameCount), &ltm(0, 2), sizeof(float) * pConfig->flimAlines);
+            memcpy(&pViewTab->m_lifetimeMap.at(0)(0, frame), &ltm(0, 0), sizeof(float) * pConfig->flimAlines);
+            memcpy(&pViewTab->m_lifetimeMap.at(1)(0, frame), &ltm(0, 1), sizeof(float) * pConfig->flimAlines);
+            memcpy(&pViewTab->m_lifetimeMap.at(2)(0, frame), &ltm(0, 2), sizeof(float) * pConfig->flimAlines);
          
+			setFrameReady(frame);
 			emit processedSingleFrame(int(double(100 * frameCount++) / (double)pConfig->frames + 1));
 
 			// Return (push) the buffer to the previous threading queue
@@ -388,36 +487,30 @@ void DataProcessing::flimProcessing(FLImProcess* pFLIm, Configuration* pConfig)
 		}
 	}
 
+	if (first != -1)
+		emit publishedFrames(first, last);
+
+	if (m_bFlimMapCached)
+	{
+		calculateFlimParameters();
+		return;
+	}
+
+	if (n_evicted > 0)
+	{
+		char msg[256];
+		sprintf(msg, "Pulse review of %d frames is left to on-demand processing (memory budget: %d MB).", n_evicted, (int)(np::memory::budget() >> 20));
+		SendStatusMessage(msg, false);
+	}
+
 	// Normalized intensity & lifetime
-	for (int i = 0; i < 3; i++)
+	filterFlimMaps(pViewTab->m_intensityMap, pViewTab->m_lifetimeMap, pViewTab->getMedfiltIntensityMap(), pViewTab->getMedfiltLifetimeMap());
+
+	// Cache the processed maps for the next review of this pullback
+	if (m_pFlimMapCache && (frameCount == pConfig->frames))
 	{
-		FloatArray2 intensity_map1(3 * pViewTab->m_intensityMap.at(i).size(0), pViewTab->m_intensityMap.at(i).size(1));
-		for (int j = 0; j < 3; j++)
-			ippiCopy_32f_C1R(pViewTab->m_intensityMap.at(i), sizeof(float) * pViewTab->m_intensityMap.at(i).size(0),
-				&intensity_map1(j * pViewTab->m_intensityMap.at(i).size(0), 0), sizeof(float) * intensity_map1.size(0),
-				{ intensity_map1.size(0) / 3, intensity_map1.size(1) });
-		(*pViewTab->getMedfiltIntensityMap())(intensity_map1);
-		ippiCopy_32f_C1R(&intensity_map1(pViewTab->m_intensityMap.at(i).size(0), 0), sizeof(float) * intensity_map1.size(0),
-			pViewTab->m_intensityMap.at(i), sizeof(float) * pViewTab->m_intensityMap.at(i).size(0),
-			{ intensity_map1.size(0) / 3, intensity_map1.size(1) });
-
-		FloatArray2 lifetime_map1(3 * pViewTab->m_lifetimeMap.at(i).size(0), pViewTab->m_lifetimeMap.at(i).size(1));
-		for (int j = 0; j < 3; j++)
-			ippiCopy_32f_C1R(pViewTab->m_lifetimeMap.at(i), sizeof(float) * pViewTab->m_lifetimeMap.at(i).size(0),
-				&lifetime_map1(j * pViewTab->m_lifetimeMap.at(i).size(0), 0), sizeof(float) * lifetime_map1.size(0),
-				{ lifetime_map1.size(0) / 3, lifetime_map1.size(1) });
-		(*pViewTab->getMedfiltLifetimeMap())(lifetime_map1);
-		ippiCopy_32f_C1R(&lifetime_map1(pViewTab->m_lifetimeMap.at(i).size(0), 0), sizeof(float) * lifetime_map1.size(0),
-			pViewTab->m_lifetimeMap.at(i), sizeof(float) * pViewTab->m_lifetimeMap.at(i).size(0),
-			{ lifetime_map1.size(0) / 3, lifetime_map1.size(1) });
-
-		Uint8Array2 zero_lifetime0(lifetime_map1.size(0) / 3, lifetime_map1.size(1));
-		FloatArray2 zero_lifetime(lifetime_map1.size(0) / 3, lifetime_map1.size(1));
-		ippiCompareC_32f_C1R(pViewTab->m_lifetimeMap.at(i), sizeof(float) * pViewTab->m_lifetimeMap.at(i).size(0),
-			0.0f, zero_lifetime0, sizeof(uint8_t) * zero_lifetime0.size(0), { zero_lifetime0.size(0), zero_lifetime0.size(1) }, ippCmpGreater);
-		ippsConvert_8u32f(zero_lifetime0, zero_lifetime, zero_lifetime.length());
-		ippsDivC_32f_I(255.0f, zero_lifetime, zero_lifetime.length());
-		ippsMul_32f_I(zero_lifetime, pViewTab->m_intensityMap.at(i), zero_lifetime.length());
+		if (!m_pFlimMapCache->write(getFlimMaps()))
+			SendStatusMessage("Failed to write the FLIm map cache.", false);
 	}
 	
 	// Calculate other FLIm parameters
@@ -425,6 +518,144 @@ void DataProcessing::flimProcessing(FLImProcess* pFLIm, Configuration* pConfig)
 }
 
 
+void DataProcessing::loadPulseReviewFrame(int frame)
+{
+	QViewTab* pViewTab = m_pResultTab->getViewTab();
+	if (!m_pFLIm || !m_pConfigTemp || (frame < 0) || (frame >= (int)pViewTab->m_vectorPulseCrop.size()))
+		return;
+
+	np::memory::subsystem_scope mem_scope(_MEM_REVIEW_);
+
+	// Each raw frame starts with its FLIm pulses
+	qint64 frame_size = getRawFrameSize(m_pConfigTemp);
+
+	np::Uint16Array2 pulse(m_pConfigTemp->flimScans, m_pConfigTemp->flimAlines);
+	QFile file(m_fileName);
+	if (!file.open(QFile::ReadOnly) || !file.seek(frame * frame_size)
+		|| (file.read(reinterpret_cast<char*>(pulse.raw_ptr()), sizeof(uint16_t) * pulse.length()) != (qint64)(sizeof(uint16_t) * pulse.length())))
+		return;
+	file.close();
+
+	np::Array<float, 2> itn(m_pConfigTemp->flimAlines, 4);
+	np::Array<float, 2> md(m_pConfigTemp->flimAlines, 4);
+	np::Array<float, 2> ltm(m_pConfigTemp->flimAlines, 3);
+	(*m_pFLIm)(itn, md, ltm, pulse);
+
+	np::Array<float, 2> crop(m_pFLIm->_resize.nx, m_pFLIm->_resize.ny);
+	np::Array<float, 2> bg_sub(m_pFLIm->_resize.nx, m_pFLIm->_resize.ny);
+	np::Array<float, 2> mask(m_pFLIm->_resize.nx, m_pFLIm->_resize.ny);
+	np::Array<float, 2> ext(m_pFLIm->_resize.nsite, m_pFLIm->_resize.ny);
+	np::Array<float, 2> filt(m_pFLIm->_resize.nsite, m_pFLIm->_resize.ny);
+
+	memcpy(crop, m_pFLIm->_resize.crop_src, crop.length() * sizeof(float));
+	memcpy(bg_sub, m_pFLIm->_resize.bgsb_src, bg_sub.length() * sizeof(float));
+	memcpy(mask, m_pFLIm->_resize.mask_src, mask.length() * sizeof(float));
+	np::copy(ext, m_pFLIm->_resize.ext_src);
+	np::copy(filt, m_pFLIm->_resize.filt_src);
+
+	pViewTab->m_vectorPulseCrop.at(frame) = crop;
+	pViewTab->m_vectorPulseBgSub.at(frame) = bg_sub;
+	pViewTab->m_vectorPulseMask.at(frame) = mask;
+	pViewTab->m_vectorPulseSpline.at(frame) = ext;
+	pViewTab->m_vectorPulseFilter.at(frame) = filt;
+
+	// Over the memory budget, only the latest frames stay
+	m_dequePulseReviewFrames.push_back(frame);
+	while (np::memory::over_budget() && (m_dequePulseReviewFrames.size() > REVIEW_PULSE_FRAMES_KEPT))
+	{
+		int evicted = m_dequePulseReviewFrames.front();
+		m_dequePulseReviewFrames.pop_front();
+
+		pViewTab->m_vectorPulseCrop.at(evicted) = np::FloatArray2();
+		pViewTab->m_vectorPulseBgSub.at(evicted) = np::FloatArray2();
+		pViewTab->m_vectorPulseMask.at(evicted) = np::FloatArray2();
+		pViewTab->m_vectorPulseSpline.at(evicted) = np::FloatArray2();
+		pViewTab->m_vectorPulseFilter.at(evicted) = np::FloatArray2();
+	}
+}
+
+bool DataProcessing::isFrameReady(int frame)
+{
+	std::unique_lock<std::mutex> lock(m_mtxFrameReady);
+	return (frame >= 0) && (frame < (int)m_vectorFrameReady.size()) && m_vectorFrameReady.at(frame);
+}
+
+qint64 DataProcessing::getRawFrameSize(Configuration* pConfig)
+{
+#ifndef NEXT_GEN_SYSTEM
+	return sizeof(uint16_t) * (qint64)pConfig->flimFrameSize + sizeof(uint8_t) * (qint64)pConfig->octFrameSize * (pConfig->axsunPipelineMode == 0 ? 1 : 4);
+#else
+	return sizeof(uint16_t) * (qint64)pConfig->flimFrameSize + sizeof(float) * (qint64)pConfig->octFrameSize;
+#endif
+}
+
+std::vector<np::FloatArray2*> DataProcessing::getFlimMaps()
+{
+	QViewTab* pViewTab = m_pResultTab->getViewTab();
+
+	std::vector<np::FloatArray2*> maps;
+	for (auto& map : pViewTab->m_pulsepowerMap) maps.push_back(&map);
+	for (auto& map : pViewTab->m_intensityMap) maps.push_back(&map);
+	for (auto& map : pViewTab->m_meandelayMap) maps.push_back(&map);
+	for (auto& map : pViewTab->m_lifetimeMap) maps.push_back(&map);
+
+	return maps;
+}
+
+void DataProcessing::checkFrameStamps(const QString& path)
+{
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+		return; // recorded before the timestamps were introduced
+
+	// Sequence gaps of each stream, and the frames where FLIm & OCT fall out of step
+	QTextStream stream(&file);
+	stream.readLine();
+
+	int n_frames = 0, flim_drops = 0, oct_drops = 0;
+	int shift = 0;
+	QStringList shift_frames;
+	qint64 flim_seq0 = -1, oct_seq0 = -1;
+	while (!stream.atEnd())
+	{
+		QStringList row = stream.readLine().split('\t');
+		if (row.size() < 5)
+			continue;
+
+		int frame = row.at(0).toInt();
+		qint64 flim_seq = row.at(1).toLongLong();
+		qint64 oct_seq = row.at(3).toLongLong();
+
+		int flim_gap = (flim_seq0 >= 0) ? (int)(flim_seq - flim_seq0 - 1) : 0;
+		int oct_gap = (oct_seq0 >= 0) ? (int)(oct_seq - oct_seq0 - 1) : 0;
+		flim_drops += flim_gap;
+		oct_drops += oct_gap;
+		if (flim_gap != oct_gap)
+		{
+			shift += flim_gap - oct_gap;
+			if (shift_frames.size() < 10)
+				shift_frames << QString("%1(%2)").arg(frame + 1).arg(shift);
+		}
+
+		flim_seq0 = flim_seq;
+		oct_seq0 = oct_seq;
+		n_frames++;
+	}
+	file.close();
+
+	char msg[512];
+	if (flim_drops || oct_drops)
+	{
+		QByteArray frames = shift_frames.join(", ").toLocal8Bit();
+		sprintf(msg, "Acquisition drops in %d frames: FLIm %d, OCT %d. FLIm-OCT misaligned from frame(shift): %s",
+			n_frames, flim_drops, oct_drops, shift_frames.isEmpty() ? "none" : frames.constData());
+	}
+	else
+		sprintf(msg, "No acquisition drops in %d frames.", n_frames);
+	SendStatusMessage(msg, false);
+}
+
+
 #ifndef NEXT_GEN_SYSTEM
 void DataProcessing::getOctProjection(std::vector<np::Uint8Array2>& vecImg, np::Uint8Array2& octProj, int offset)
 #else
@@ -460,33 +691,86 @@ void DataProcessing::calculateFlimParameters()
 {
 	QViewTab* pViewTab = m_pResultTab->getViewTab();
 
-	// Intensity ratio
-	for (int i = 0; i < 3; i++)
-	{
-		int ch_num = i;
-		int ch_den = (i == 0) ? 2 : i - 1;
+	// Intensity ratio, intensity proportion & feature vectors
+	calculateFlimFeatures(pViewTab->m_intensityMap, pViewTab->m_lifetimeMap,
+		pViewTab->m_intensityRatioMap, pViewTab->m_intensityProportionMap, pViewTab->m_featVectors);
 
-		FloatArray2 ratio_temp(pViewTab->m_intensityMap.at(i).size(0), pViewTab->m_intensityMap.at(i).size(1));
-		ippsDiv_32f(pViewTab->m_intensityMap.at(ch_den), pViewTab->m_intensityMap.at(ch_num), ratio_temp.raw_ptr(), ratio_temp.length());
-		ippsLog10_32f_A11(ratio_temp.raw_ptr(), pViewTab->m_intensityRatioMap.at(ch_num).raw_ptr(), pViewTab->m_intensityRatioMap.at(ch_num).length());
-	}
+	// Per-frame lifetime statistics
+	pViewTab->calculateLifetimeStatistics();
 
-	// Intensity proportion
-	FloatArray2 sum(pViewTab->m_intensityMap.at(0).size(0), pViewTab->m_intensityMap.at(0).size(1));
-	ippsAdd_32f(pViewTab->m_intensityMap.at(0), pViewTab->m_intensityMap.at(1), sum, sum.length());
-	ippsAdd_32f_I(pViewTab->m_intensityMap.at(2), sum, sum.length());
+	m_pResultTab->getViewTab()->m_bRePrediction = true;
+}
+
+void DataProcessing::filterFlimMaps(std::vector<np::FloatArray2>& intensity, std::vector<np::FloatArray2>& lifetime,
+	medfilt* pMedfiltIntensity, medfilt* pMedfiltLifetime)
+{
+	// Median filtered with angular wrap-around, in place
 	for (int i = 0; i < 3; i++)
-		ippsDiv_32f(sum, pViewTab->m_intensityMap.at(i), pViewTab->m_intensityProportionMap.at(i), sum.length());
+	{
+		(*pMedfiltIntensity)(intensity.at(i));
+		(*pMedfiltLifetime)(lifetime.at(i));
+
+		// No intensity where no lifetime
+		float* pIntensity = intensity.at(i).raw_ptr();
+		const float* pLifetime = lifetime.at(i).raw_ptr();
+		tbb::parallel_for(tbb::blocked_range<int>(0, lifetime.at(i).length()),
+			[&](const tbb::blocked_range<int>& r) {
+			for (int j = r.begin(); j != r.end(); ++j)
+				if (!(pLifetime[j] > 0.0f))
+					pIntensity[j] = 0.0f;
+		});
+	}
+}
 
-	// Random forest feature aggregation
-	FloatArray2 features(pViewTab->m_lifetimeMap.at(0).length(), 9);
+void DataProcessing::calculateFlimFeatures(std::vector<np::FloatArray2>& intensity, std::vector<np::FloatArray2>& lifetime,
+	std::vector<np::FloatArray2>& ratio, std::vector<np::FloatArray2>& proportion, np::FloatArray2& features)
+{
+	float *pIntensity[3], *pLifetime[3], *pRatio[3], *pProp[3];
 	for (int i = 0; i < 3; i++)
 	{
-		memcpy(&features(0, 0 + i), pViewTab->m_lifetimeMap.at(i).raw_ptr(), sizeof(float) * pViewTab->m_lifetimeMap.at(i).length());
-		memcpy(&features(0, 3 + i), pViewTab->m_intensityRatioMap.at(i).raw_ptr(), sizeof(float) * pViewTab->m_intensityRatioMap.at(i).length());
-		memcpy(&features(0, 6 + i), pViewTab->m_intensityProportionMap.at(i).raw_ptr(), sizeof(float) * pViewTab->m_intensityProportionMap.at(i).length());
+		pIntensity[i] = intensity.at(i).raw_ptr();
+		pLifetime[i] = lifetime.at(i).raw_ptr();
+		pRatio[i] = ratio.at(i).raw_ptr();
+		pProp[i] = proportion.at(i).raw_ptr();
 	}
-	ippiTranspose_32f_C1R(features, sizeof(float) * features.size(0), pViewTab->m_featVectors, sizeof(float) * pViewTab->m_featVectors.size(0), { features.size(0), features.size(1) });
+	float* pFeat = features.raw_ptr(); // ML_N_FEATURES x N (features of a sample are contiguous)
+
+	// Intensity ratio, intensity proportion & feature vectors in a single blocked pass
+	int len = lifetime.at(0).length();
+	tbb::parallel_for(tbb::blocked_range<int>(0, len, FLIM_PARAM_BLOCK_SIZE),
+		[&](const tbb::blocked_range<int>& r) {
+		float temp[FLIM_PARAM_BLOCK_SIZE];
+		for (int k = r.begin(); k < r.end(); k += FLIM_PARAM_BLOCK_SIZE)
+		{
+			int n = (r.end() - k < FLIM_PARAM_BLOCK_SIZE) ? r.end() - k : FLIM_PARAM_BLOCK_SIZE;
 
-	m_pResultTab->getViewTab()->m_bRePrediction = true;
+			// Intensity ratio
+			for (int i = 0; i < 3; i++)
+			{
+				int ch_num = i;
+				int ch_den = (i == 0) ? 2 : i - 1;
+
+				ippsDiv_32f(pIntensity[ch_den] + k, pIntensity[ch_num] + k, temp, n);
+				ippsLog10_32f_A11(temp, pRatio[ch_num] + k, n);
+			}
+
+			// Intensity proportion
+			ippsAdd_32f(pIntensity[0] + k, pIntensity[1] + k, temp, n);
+			ippsAdd_32f_I(pIntensity[2] + k, temp, n);
+			for (int i = 0; i < 3; i++)
+				ippsDiv_32f(temp, pIntensity[i] + k, pProp[i] + k, n);
+
+			// Feature aggregation (written in sample order, no transpose)
+			for (int j = k; j < k + n; j++)
+			{
+				float* pF = pFeat + (size_t)ML_N_FEATURES * j;
+				for (int i = 0; i < 3; i++)
+				{
+					pF[0 + i] = pLifetime[i][j];
+					pF[3 + i] = pRatio[i][j];
+					pF[6 + i] = pProp[i][j];
+				}
+			}
+		}
+	});
 }
@@ -10,12 +10,19 @@
 #include <Common/callback.h>
 #include <Common/SyncObject.h>
 
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <atomic>
+
 
 class Configuration;
 class QResultTab;
 
 class FLImProcess;
 class OCTProcess;
+class FlimMapCache;
+class medfilt;
 
 class DataProcessing : public QObject
 {
@@ -33,6 +40,7 @@ public:
     inline FLImProcess* getFLImProcess() const { return m_pFLIm; }
 	inline OCTProcess* getOCTProcess() const { return m_pOCT; }
 	inline QString getIniName() const { return m_iniName; }
+	inline FlimMapCache* getFlimMapCache() const { return m_pFlimMapCache; }
 
 public:
     void startProcessing(QString, int frame = -1);
@@ -44,6 +52,22 @@ private:
 	
 public:
 	void calculateFlimParameters();
+	void loadPulseReviewFrame(int frame);
+
+	// Progressive review: frames are published as they are processed, a requested frame is read next
+	bool isFrameReady(int frame);
+	inline void requestFrame(int frame) { m_nRequestedFrame = frame; }
+
+	// Shared with the batch reprocessing (no view tab)
+	static void filterFlimMaps(std::vector<np::FloatArray2>& intensity, std::vector<np::FloatArray2>& lifetime,
+		medfilt* pMedfiltIntensity, medfilt* pMedfiltLifetime);
+	static void calculateFlimFeatures(std::vector<np::FloatArray2>& intensity, std::vector<np::FloatArray2>& lifetime,
+		std::vector<np::FloatArray2>& ratio, std::vector<np::FloatArray2>& proportion, np::FloatArray2& features);
+
+private:
+	static qint64 getRawFrameSize(Configuration* pConfig);
+	std::vector<np::FloatArray2*> getFlimMaps();
+	void checkFrameStamps(const QString& path);
 
 private:
 #ifndef NEXT_GEN_SYSTEM
@@ -54,6 +78,7 @@ private:
 
 signals:
 	void processedSingleFrame(int);
+	void publishedFrames(int, int); // first & last frames of a processed range
 	void abortedProcessing();
 	void finishedProcessing(bool);
 
@@ -70,8 +95,25 @@ private:
 	SyncObject<uint8_t> m_syncDeinterleaving;
     SyncObject<uint16_t> m_syncFlimProcessing;
 
+	// Frame indices travelling with the buffers (frames requested by the view leave the file order)
+	Queue<int> m_queueDeinterleavingFrame;
+	Queue<int> m_queueFlimProcessingFrame;
+
+	std::mutex m_mtxFrameReady;
+	std::vector<uint8_t> m_vectorFrameReady;
+	std::atomic<int> m_nRequestedFrame;
+
 private:
 	QString m_iniName;
+	QString m_fileName;
+	int m_nReadAheadFrames; // frames per read request
+
+	// Processed FLIm maps beside the raw data (*.flim_cache)
+	FlimMapCache* m_pFlimMapCache;
+	bool m_bFlimMapCached;
+
+	// Pulse review frames processed on demand, oldest first (evicted over the memory budget)
+	std::deque<int> m_dequePulseReviewFrames;
 
 private:
 	callback2<const char*, bool> SendStatusMessage;
@@ -5,6 +5,8 @@
 #include <Havana3/QResultTab.h>
 #include <Havana3/QViewTab.h>
 
+#include <DataAcquisition/DataProcessing.h>
+
 #include <DataAcquisition/FLImProcess/FLImProcess.h>
 #include <DataAcquisition/OCTProcess/OCTProcess.h>
 
@@ -16,7 +18,7 @@
 
 
 DataProcessingDotter::DataProcessingDotter(QWidget *parent)
-    : m_pConfigTemp(nullptr), m_pFLIm(nullptr)
+    : m_pConfigTemp(nullptr), m_pFLIm(nullptr), m_nFlimReadAheadFrames(1), m_nOctReadAheadFrames(1)
 {
 	// Set main window objects    
     m_pResultTab = dynamic_cast<QResultTab*>(parent);
@@ -57,6 +59,7 @@ void DataProcessingDotter::startProcessing(QString fileName, int frame)
 	{
 		std::thread t1([&, fileName, frame]() {
 
+			np::memory::subsystem_scope mem_scope(_MEM_REVIEW_);
 			std::chrono::system_clock::time_point start = std::chrono::system_clock::now();
 			
 			{
@@ -97,11 +100,15 @@ void DataProcessingDotter::startProcessing(QString fileName, int frame)
 				m_pResultTab->getViewTab()->setBuffers(m_pConfigTemp);
 				m_pResultTab->getViewTab()->setObjects(m_pConfigTemp);
 
-				m_syncFlimProcessing.allocate_queue_buffer(m_pConfigTemp->flimScans, m_pConfigTemp->flimAlines, PROCESSING_BUFFER_SIZE);
+				// FLIm & OCT raw frames are read ahead in blocks of whole frames, each file by its own loader
+				m_nFlimReadAheadFrames = (int)qMax((qint64)1, READ_AHEAD_BLOCK_SIZE / (qint64)(sizeof(uint16_t) * m_pConfigTemp->flimFrameSize));
+				m_nOctReadAheadFrames = (int)qMax((qint64)1, READ_AHEAD_BLOCK_SIZE / (qint64)(sizeof(uint8_t) * m_pConfigTemp->octFrameSize));
+				m_syncFlimProcessing.allocate_queue_buffer(m_pConfigTemp->flimScans, m_pConfigTemp->flimAlines, READ_AHEAD_BLOCKS, m_nFlimReadAheadFrames);
+				m_syncOctProcessing.allocate_queue_buffer(m_pConfigTemp->octScans, m_pConfigTemp->octAlines, READ_AHEAD_BLOCKS, m_nOctReadAheadFrames);
 
 				// Open OCT & FLIm raw file /////////////////////////////////////////////////////////////////
 				QFile flim_file(flimName), oct_file(rpdName);
-				if ((false == flim_file.open(QFile::ReadOnly)) || (false == oct_file.open(QFile::ReadOnly)))
+				if ((false == flim_file.open(QFile::ReadOnly | QFile::Unbuffered)) || (false == oct_file.open(QFile::ReadOnly | QFile::Unbuffered)))
 				{
 					SendStatusMessage("Invalid file path! Cannot review the data.", true);
 					emit abortedProcessing();
@@ -123,16 +130,21 @@ void DataProcessingDotter::startProcessing(QString fileName, int frame)
 				// Load OCT raw data ////////////////////////////////////////////////////////////////////////
 				std::thread load_oct_data([&]() { loadingOctRawData(&oct_file, m_pConfigTemp); });
 
+				// OCT Process //////////////////////////////////////////////////////////////////////////////
+				std::thread oct_proc([&]() { np::memory::subsystem_scope mem_scope(_MEM_REVIEW_); octProcessing(m_pConfigTemp); });
+
 				// FLIm Process /////////////////////////////////////////////////////////////////////////////
-				std::thread flim_proc([&]() { flimProcessing(m_pFLIm, m_pConfigTemp); });
+				std::thread flim_proc([&]() { np::memory::subsystem_scope mem_scope(_MEM_REVIEW_); flimProcessing(m_pFLIm, m_pConfigTemp); });
 
 				// Wait for threads end /////////////////////////////////////////////////////////////////////
 				load_flim_data.join();
 				load_oct_data.join();
+				oct_proc.join();
 				flim_proc.join();
 
 				// Delete threading sync buffers ////////////////////////////////////////////////////////////				
 				m_syncFlimProcessing.deallocate_queue_buffer();
+				m_syncOctProcessing.deallocate_queue_buffer();
 
 				// Close OCT & FLIm raw file ////////////////////////////////////////////////////////////////
 				flim_file.close();
@@ -255,55 +267,91 @@ void DataProcessingDotter::getOctInfo(QString rpdName, Configuration* pConfig)
 
 void DataProcessingDotter::loadingFlimRawData(QFile* pFile, Configuration* pConfig)
 {
+	qint64 frame_size = sizeof(uint16_t) * (qint64)pConfig->flimFrameSize;
+
+	std::vector<uint16_t*> block;
 	int frameCount = 0;
 	while (frameCount < pConfig->frames)
 	{
-		// Get buffers from threading queues
-		uint16_t* pulse_data = nullptr;
-		do
-		{
-			std::unique_lock<std::mutex> lock(m_syncFlimProcessing.mtx);
-			if (!m_syncFlimProcessing.queue_buffer.empty())
-			{
-				pulse_data = m_syncFlimProcessing.queue_buffer.front();
-				m_syncFlimProcessing.queue_buffer.pop();
-			}
+		// Get a block of buffers from threading queues
+		int n_frames = qMin(m_nFlimReadAheadFrames, pConfig->frames - frameCount);
+		m_syncFlimProcessing.acquire_block(block, n_frames);
 
-			if (pulse_data)
-			{
-				// Read data from the external data
-				pFile->read(reinterpret_cast<char *>(pulse_data), sizeof(uint16_t) * pConfig->flimFrameSize);
-				frameCount++;
-				
-				// Push the buffers to sync Queues
-				m_syncFlimProcessing.Queue_sync.push(pulse_data);
-			}
+		// Read data from the external data (one request per block, straight into the pulse buffers)
+		SyncObject<uint16_t>::for_each_run(block, (size_t)pConfig->flimFrameSize, [&](uint16_t* ptr, int n) {
+			pFile->read(reinterpret_cast<char *>(ptr), frame_size * n);
+		});
+		frameCount += n_frames;
 
-		} while (pulse_data == nullptr);
+		// Push the buffers to sync Queues
+		for (auto pulse_data : block)
+			m_syncFlimProcessing.Queue_sync.push(pulse_data);
 	}
 }
 
 void DataProcessingDotter::loadingOctRawData(QFile* pFile, Configuration* pConfig)
+{
+	qint64 frame_size = sizeof(uint8_t) * (qint64)pConfig->octFrameSize;
+
+	std::vector<uint8_t*> block;
+	int frameCount = 0;
+	while (frameCount < pConfig->frames)
+	{
+		// Get a block of buffers from threading queues
+		int n_frames = qMin(m_nOctReadAheadFrames, pConfig->frames - frameCount);
+		m_syncOctProcessing.acquire_block(block, n_frames);
+
+		// Read data from the external data (one request per block, straight into the frame buffers)
+		SyncObject<uint8_t>::for_each_run(block, (size_t)pConfig->octFrameSize, [&](uint8_t* ptr, int n) {
+			pFile->read(reinterpret_cast<char *>(ptr), frame_size * n);
+		});
+		frameCount += n_frames;
+
+		// Push the buffers to sync Queues
+		for (auto frame_data : block)
+			m_syncOctProcessing.Queue_sync.push(frame_data);
+	}
+}
+
+void DataProcessingDotter::octProcessing(Configuration* pConfig)
 {
 	QViewTab* pVisTab = m_pResultTab->getViewTab();
 
+	IppiSize roi_oct0 = { pConfig->octScans, pConfig->octAlines };
+	IppiSize roi_octR = { pConfig->octRadius, pConfig->octAlines };
+
+	std::vector<uint8_t*> block;
 	int frameCount = 0;
 	while (frameCount < pConfig->frames)
 	{
-		// Read data from the external data
-		IppiSize roi_oct0 = { pConfig->octScans, pConfig->octAlines };
-		IppiSize roi_octR = { pConfig->octRadius, pConfig->octAlines };
-		np::Uint8Array2 frame_data(roi_oct0.width, roi_oct0.height);
-		pFile->read(reinterpret_cast<char *>(frame_data.raw_ptr()), sizeof(uint8_t) * pConfig->octFrameSize);
-		
-		if (pConfig->verticalMirroring)
-			ippiMirror_8u_C1IR(frame_data, roi_oct0.width, roi_oct0, ippAxsVertical);
-
-		ippiCopy_8u_C1R(frame_data + pConfig->innerOffsetLength, roi_oct0.width,  ///  - pConfig->interFrameSync
-			pVisTab->m_vectorOctImage.at(frameCount).raw_ptr(), roi_octR.width,  /// - pConfig->interFrameSync
-			{ roi_octR.width, roi_octR.height });
-						
-		frameCount++;
+		// Get the block of buffers from the previous sync Queue
+		int n_frames = qMin(m_nOctReadAheadFrames, pConfig->frames - frameCount);
+		block.clear();
+		for (int i = 0; i < n_frames; i++)
+			block.push_back(m_syncOctProcessing.Queue_sync.pop());
+
+		// Frames of a block are independent: mirrored & cropped in parallel
+		tbb::parallel_for(tbb::blocked_range<int>(0, n_frames),
+			[&](const tbb::blocked_range<int>& r) {
+			for (int i = r.begin(); i != r.end(); ++i)
+			{
+				uint8_t* frame_data = block.at(i);
+				if (pConfig->verticalMirroring)
+					ippiMirror_8u_C1IR(frame_data, roi_oct0.width, roi_oct0, ippAxsVertical);
+
+				ippiCopy_8u_C1R(frame_data + pConfig->innerOffsetLength, roi_oct0.width,  ///  - pConfig->interFrameSync
+					pVisTab->m_vectorOctImage.at(frameCount + i).raw_ptr(), roi_octR.width,  /// - pConfig->interFrameSync
+					{ roi_octR.width, roi_octR.height });
+			}
+		});
+		frameCount += n_frames;
+
+		// Return (push) the buffers to the previous threading queue
+		{
+			std::unique_lock<std::mutex> lock(m_syncOctProcessing.mtx);
+			for (auto frame_data : block)
+				m_syncOctProcessing.queue_buffer.push(frame_data);
+		}
 	}
 }
 
@@ -347,8 +395,8 @@ void DataProcessingDotter::flimProcessing(FLImProcess* pFLIm, Configuration* pCo
 			memcpy(crop, pFLIm->_resize.crop_src, crop.length() * sizeof(float));
 			memcpy(bg_sub, pFLIm->_resize.bgsb_src, bg_sub.length() * sizeof(float));
 			memcpy(mask, pFLIm->_resize.mask_src, mask.length() * sizeof(float));
-			memcpy(ext, pFLIm->_resize.ext_src, ext.length() * sizeof(float));
-			memcpy(filt, pFLIm->_resize.filt_src, filt.length() * sizeof(float));
+			np::copy(ext, pFLIm->_resize.ext_src);
+			np::copy(filt, pFLIm->_resize.filt_src);
 
 			pViewTab->m_vectorPulseCrop.push_back(crop);
 			pViewTab->m_vectorPulseBgSub.push_back(bg_sub);
@@ -407,41 +455,9 @@ void DataProcessingDotter::flimProcessing(FLImProcess* pFLIm, Configuration* pCo
 		}
 	}
 
-	// Normalized intensity & lifetime
-	for (int i = 0; i < 3; i++)
-	{
-		//QFile file(QString("intensity/intensity_%1.data").arg(i + 1));
-		//file.open(QIODevice::WriteOnly);
-		//file.write(reinterpret_cast<const char*>(pViewTab->m_intensityMap.at(i).raw_ptr()), sizeof(float) * pViewTab->m_intensityMap.at(i).length());
-
-		FloatArray2 intensity_map1(3 * pViewTab->m_intensityMap.at(i).size(0), pViewTab->m_intensityMap.at(i).size(1));
-		for (int j = 0; j < 3; j++)
-			ippiCopy_32f_C1R(pViewTab->m_intensityMap.at(i), sizeof(float) * pViewTab->m_intensityMap.at(i).size(0),
-				&intensity_map1(j * pViewTab->m_intensityMap.at(i).size(0), 0), sizeof(float) * intensity_map1.size(0),
-				{ intensity_map1.size(0) / 3, intensity_map1.size(1) });
-		(*pViewTab->getMedfiltIntensityMap())(intensity_map1);
-		ippiCopy_32f_C1R(&intensity_map1(pViewTab->m_intensityMap.at(i).size(0), 0), sizeof(float) * intensity_map1.size(0),
-			pViewTab->m_intensityMap.at(i), sizeof(float) * pViewTab->m_intensityMap.at(i).size(0),
-			{ intensity_map1.size(0) / 3, intensity_map1.size(1) });
-
-		FloatArray2 lifetime_map1(3 * pViewTab->m_lifetimeMap.at(i).size(0), pViewTab->m_lifetimeMap.at(i).size(1));
-		for (int j = 0; j < 3; j++)
-			ippiCopy_32f_C1R(pViewTab->m_lifetimeMap.at(i), sizeof(float) * pViewTab->m_lifetimeMap.at(i).size(0),
-				&lifetime_map1(j * pViewTab->m_lifetimeMap.at(i).size(0), 0), sizeof(float) * lifetime_map1.size(0),
-				{ lifetime_map1.size(0) / 3, lifetime_map1.size(1) });
-		(*pViewTab->getMedfiltLifetimeMap())(lifetime_map1);
-		ippiCopy_32f_C1R(&lifetime_map1(pViewTab->m_lifetimeMap.at(i).size(0), 0), sizeof(float) * lifetime_map1.size(0),
-			pViewTab->m_lifetimeMap.at(i), sizeof(float) * pViewTab->m_lifetimeMap.at(i).size(0),
-			{ lifetime_map1.size(0) / 3, lifetime_map1.size(1) });
-
-		Uint8Array2 zero_lifetime0(lifetime_map1.size(0) / 3, lifetime_map1.size(1));
-		FloatArray2 zero_lifetime(lifetime_map1.size(0) / 3, lifetime_map1.size(1));
-		ippiCompareC_32f_C1R(pViewTab->m_lifetimeMap.at(i), sizeof(float) * pViewTab->m_lifetimeMap.at(i).size(0),
-			0.0f, zero_lifetime0, sizeof(uint8_t) * zero_lifetime0.size(0), { zero_lifetime0.size(0), zero_lifetime0.size(1) }, ippCmpGreater);
-		ippsConvert_8u32f(zero_lifetime0, zero_lifetime, zero_lifetime.length());
-		ippsDivC_32f_I(255.0f, zero_lifetime, zero_lifetime.length());
-		ippsMul_32f_I(zero_lifetime, pViewTab->m_intensityMap.at(i), zero_lifetime.length());
-	}
+	// Normalized intensity & lifetime (same filtering & masking as the standard review)
+	DataProcessing::filterFlimMaps(pViewTab->m_intensityMap, pViewTab->m_lifetimeMap,
+		pViewTab->getMedfiltIntensityMap(), pViewTab->getMedfiltLifetimeMap());
 		
 	// Calculate other FLIm parameters
 	calculateFlimParameters();
@@ -483,33 +499,12 @@ void DataProcessingDotter::calculateFlimParameters()
 {
 	QViewTab* pViewTab = m_pResultTab->getViewTab();
 
-	// Intensity ratio
-	for (int i = 0; i < 3; i++)
-	{
-		int ch_num = i;
-		int ch_den = (i == 0) ? 2 : i - 1;
+	// Intensity ratio, intensity proportion & feature vectors
+	DataProcessing::calculateFlimFeatures(pViewTab->m_intensityMap, pViewTab->m_lifetimeMap,
+		pViewTab->m_intensityRatioMap, pViewTab->m_intensityProportionMap, pViewTab->m_featVectors);
 
-		FloatArray2 ratio_temp(pViewTab->m_intensityMap.at(i).size(0), pViewTab->m_intensityMap.at(i).size(1));
-		ippsDiv_32f(pViewTab->m_intensityMap.at(ch_den), pViewTab->m_intensityMap.at(ch_num), ratio_temp.raw_ptr(), ratio_temp.length());
-		ippsLog10_32f_A11(ratio_temp.raw_ptr(), pViewTab->m_intensityRatioMap.at(ch_num).raw_ptr(), pViewTab->m_intensityRatioMap.at(ch_num).length());
-	}
-
-	// Intensity proportion
-	FloatArray2 sum(pViewTab->m_intensityMap.at(0).size(0), pViewTab->m_intensityMap.at(0).size(1));
-	ippsAdd_32f(pViewTab->m_intensityMap.at(0), pViewTab->m_intensityMap.at(1), sum, sum.length());
-	ippsAdd_32f_I(pViewTab->m_intensityMap.at(2), sum, sum.length());
-	for (int i = 0; i < 3; i++)
-		ippsDiv_32f(sum, pViewTab->m_intensityMap.at(i), pViewTab->m_intensityProportionMap.at(i), sum.length());
-
-	// Random forest feature aggregation
-	FloatArray2 features(pViewTab->m_lifetimeMap.at(0).length(), 9);
-	for (int i = 0; i < 3; i++)
-	{
-		memcpy(&features(0, 0 + i), pViewTab->m_lifetimeMap.at(i).raw_ptr(), sizeof(float) * pViewTab->m_lifetimeMap.at(i).length());
-		memcpy(&features(0, 3 + i), pViewTab->m_intensityRatioMap.at(i).raw_ptr(), sizeof(float) * pViewTab->m_intensityRatioMap.at(i).length());
-		memcpy(&features(0, 6 + i), pViewTab->m_intensityProportionMap.at(i).raw_ptr(), sizeof(float) * pViewTab->m_intensityProportionMap.at(i).length());
-	}
-	ippiTranspose_32f_C1R(features, sizeof(float) * features.size(0), pViewTab->m_featVectors, sizeof(float) * pViewTab->m_featVectors.size(0), { features.size(0), features.size(1) });
+	// Per-frame lifetime statistics
+	pViewTab->calculateLifetimeStatistics();
 
 	m_pResultTab->getViewTab()->m_bRePrediction = true;
 }
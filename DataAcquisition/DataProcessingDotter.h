@@ -43,6 +43,7 @@ private:
 private:
 	void loadingFlimRawData(QFile*, Configuration*);
 	void loadingOctRawData(QFile*, Configuration*);
+	void octProcessing(Configuration*);
 	void flimProcessing(FLImProcess*, Configuration*);
 	
 public:
@@ -70,6 +71,9 @@ private:
 private:
     // for threading operation	
     SyncObject<uint16_t> m_syncFlimProcessing;
+	SyncObject<uint8_t> m_syncOctProcessing;
+	int m_nFlimReadAheadFrames; // frames per read request of each file
+	int m_nOctReadAheadFrames;
 
 private:
 	QString m_iniName;
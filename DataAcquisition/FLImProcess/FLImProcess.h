@@ -70,7 +70,7 @@ struct FILTER // Gaussian Filtering
 
     void operator() (Ipp32f* pDst, Ipp32f* pSrc, int y)
     {
-        ippsFIRSR_32f(pSrc, pDst, srcWidth, pSpec, NULL, NULL, &pBuf[srcWidth * y]);
+        ippsFIRSR_32f(pSrc, pDst, srcWidth, pSpec, NULL, NULL, pBuf + bufStep * y);
     }
 
     void initialize(int _tapsLen, int _srcWidth, int ny)
@@ -93,14 +93,17 @@ struct FILTER // Gaussian Filtering
         if (pSpec) { ippsFree(pSpec); pSpec = nullptr; }
         pSpec = (IppsFIRSpec_32f*)ippsMalloc_8u(specSize);
         if (pBuf) { ippsFree(pBuf); pBuf = nullptr; }
-        pBuf = ippsMalloc_8u(ny * bufSize);
-        ippsFIRSRInit_32f(pTaps, tapsLen, ippAlgDirect, pSpec);
+        // One work buffer per A-line, each on a cache line of its own
+        bufStep = (bufSize + NP_MEMORY_ALIGNMENT - 1) / NP_MEMORY_ALIGNMENT * NP_MEMORY_ALIGNMENT;
+        pBuf = ippsMalloc_8u(ny * bufStep);
+        // FFT-based convolution when it beats the direct form (235 taps)
+        ippsFIRSRInit_32f(pTaps, tapsLen, ippAlgAuto, pSpec);
     }
 
 private:
     int tapsLen;
     int srcWidth;
-    int specSize, bufSize;
+    int specSize, bufSize, bufStep;
     IppsFIRSpec_32f* pSpec;
     Ipp8u* pBuf;
     Ipp32f* pTaps;
@@ -353,8 +356,9 @@ public:
         crop_src = std::move(FloatArray2((int)nx, (int)ny));
 		bgsb_src = std::move(FloatArray2((int)nx, (int)ny));
         mask_src = std::move(FloatArray2((int)nx, (int)ny));        
-        ext_src  = std::move(FloatArray2((int)nsite, (int)ny));
-        filt_src = std::move(FloatArray2((int)nsite, (int)ny));
+        // Spline & FIR rows start on a cache line (aligned loads in the filter): copy them out with np::copy
+        ext_src  = padded<float>((int)nsite, (int)ny);
+        filt_src = padded<float>((int)nsite, (int)ny);
 
         saturated = std::move(FloatArray2((int)ny, 4));
 		pulse_power = std::move(FloatArray2((int)ny, 4));
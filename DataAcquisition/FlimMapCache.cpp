@@ -0,0 +1,213 @@
+#include "FlimMapCache.h"
+
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QStringList>
+#include <QDateTime>
+#include <QCryptographicHash>
+
+
+FlimMapCache::FlimMapCache(const QString & cache_path, const QString & compo_path) :
+	m_path(cache_path), m_compoPath(compo_path), m_bMapsModified(false)
+{
+}
+
+FlimMapCache::~FlimMapCache()
+{
+}
+
+
+void FlimMapCache::setKey(QFile* pRawFile, Configuration* pConfig, const QString & mask_path)
+{
+	QCryptographicHash hash(QCryptographicHash::Md5);
+
+	// Raw data: size and samples at the start, middle and end (hashing the whole pullback would cost a full read)
+	qint64 raw_size = pRawFile->size();
+	hash.addData(reinterpret_cast<const char*>(&raw_size), sizeof(qint64));
+
+	qint64 pos0 = pRawFile->pos();
+	qint64 offsets[3] = { 0, (raw_size - FLIM_MAP_CACHE_SAMPLE_SIZE) / 2, raw_size - FLIM_MAP_CACHE_SAMPLE_SIZE };
+	for (int i = 0; i < 3; i++)
+	{
+		if (pRawFile->seek(offsets[i] > 0 ? offsets[i] : 0))
+			hash.addData(pRawFile->read(FLIM_MAP_CACHE_SAMPLE_SIZE));
+	}
+	pRawFile->seek(pos0);
+
+	// FLIm processing parameters
+	int32_t sizes[3] = { pConfig->frames, pConfig->flimScans, pConfig->flimAlines };
+	hash.addData(reinterpret_cast<const char*>(sizes), sizeof(sizes));
+	hash.addData(reinterpret_cast<const char*>(&pConfig->flimBg), sizeof(float));
+	hash.addData(reinterpret_cast<const char*>(pConfig->flimChStartInd), sizeof(pConfig->flimChStartInd));
+	hash.addData(reinterpret_cast<const char*>(pConfig->flimDelayOffset), sizeof(pConfig->flimDelayOffset));
+	hash.addData(reinterpret_cast<const char*>(pConfig->flimIntensityComp), sizeof(pConfig->flimIntensityComp));
+
+	float constants[4] = { (float)FLIM_CH_START_5, (float)GAUSSIAN_FILTER_WIDTH, (float)GAUSSIAN_FILTER_STD, (float)FLIM_SPLINE_FACTOR };
+	hash.addData(reinterpret_cast<const char*>(constants), sizeof(constants));
+
+	// FLIm mask
+	QFile mask_file(mask_path);
+	if (mask_file.open(QIODevice::ReadOnly))
+	{
+		hash.addData(mask_file.readAll());
+		mask_file.close();
+	}
+
+	m_key = hash.result();
+	m_bMapsModified = false;
+}
+
+bool FlimMapCache::read(const std::vector<np::FloatArray2*> & maps)
+{
+	return readMaps(m_path, m_key, 0, maps);
+}
+
+bool FlimMapCache::write(const std::vector<np::FloatArray2*> & maps)
+{
+	return writeMaps(m_path, m_key, 0, maps);
+}
+
+bool FlimMapCache::readComposition(const std::vector<np::FloatArray2*> & maps, int32_t tag, const QByteArray & model)
+{
+	if (m_compoPath.isEmpty() || m_bMapsModified)
+		return false;
+
+	return readMaps(m_compoPath, compositionKey(model), tag, maps);
+}
+
+bool FlimMapCache::writeComposition(const std::vector<np::FloatArray2*> & maps, int32_t tag, const QByteArray & model)
+{
+	if (m_compoPath.isEmpty() || m_bMapsModified)
+		return false;
+
+	return writeMaps(m_compoPath, compositionKey(model), tag, maps);
+}
+
+int32_t FlimMapCache::compositionTag(int ml_mode, bool vib_corrected, int delay_sync)
+{
+	// The features follow the vibration correction, which shifts the FLIm maps by the delay sync
+	return (1 << 24) | ((vib_corrected ? 1 : 0) << 16) | ((vib_corrected ? (delay_sync & 0xff) : 0) << 8) | (ml_mode & 0xff);
+}
+
+QByteArray FlimMapCache::modelFingerprint(bool random_forest)
+{
+	// Names, sizes & modification times of the model files: a retrained or replaced model misses the predictions of the previous one
+	QStringList files;
+	if (random_forest)
+		files << RF_COMPO_MODEL_NAME;
+	else
+	{
+		for (int i = 0; i < ML_N_CATS; i++)
+			files << QString("%1_%2.xml").arg(SVM_COMPO_MODEL_NAME).arg(i + 1);
+		files << QString("%1_standardize.ms").arg(SVM_COMPO_MODEL_NAME);
+	}
+
+	QCryptographicHash hash(QCryptographicHash::Md5);
+	foreach (const QString& file, files)
+	{
+		QFileInfo info(file);
+		qint64 stat[2] = { info.exists() ? info.size() : -1, info.exists() ? info.lastModified().toMSecsSinceEpoch() : 0 };
+		hash.addData(file.toUtf8());
+		hash.addData(reinterpret_cast<const char*>(stat), sizeof(stat));
+	}
+
+	return hash.result();
+}
+
+QByteArray FlimMapCache::compositionKey(const QByteArray & model) const
+{
+	if (m_key.isEmpty())
+		return QByteArray();
+
+	return QCryptographicHash::hash(m_key + model, QCryptographicHash::Md5);
+}
+
+
+bool FlimMapCache::readMaps(const QString & path, const QByteArray & key, int32_t tag, const std::vector<np::FloatArray2*> & maps)
+{
+	if (key.isEmpty() || maps.empty())
+		return false;
+
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+
+	int len = maps.at(0)->length();
+	qint64 payload_size = (qint64)maps.size() * len * sizeof(float);
+	if (file.size() != (qint64)sizeof(FlimMapCacheHeader) + payload_size)
+		return false;
+
+	// Memory-mapped: the payload is checked and copied without an intermediate buffer
+	uchar* ptr = file.map(0, file.size());
+	if (!ptr)
+		return false;
+
+	FlimMapCacheHeader header;
+	memcpy(&header, ptr, sizeof(FlimMapCacheHeader));
+
+	bool valid = (header.magic == FLIM_MAP_CACHE_MAGIC) && (header.version == FLIM_MAP_CACHE_VERSION)
+		&& (header.tag == tag) && (header.n_maps == (int32_t)maps.size()) && (header.size0 == maps.at(0)->size(0)) && (header.size1 == maps.at(0)->size(1))
+		&& (memcmp(header.key, key.constData(), sizeof(header.key)) == 0);
+
+	const char* payload = reinterpret_cast<const char*>(ptr + sizeof(FlimMapCacheHeader));
+	if (valid)
+	{
+		QByteArray checksum = QCryptographicHash::hash(QByteArray::fromRawData(payload, (int)payload_size), QCryptographicHash::Md5);
+		valid = memcmp(header.checksum, checksum.constData(), sizeof(header.checksum)) == 0;
+	}
+
+	if (valid)
+	{
+		for (size_t i = 0; i < maps.size(); i++)
+		{
+			if (maps.at(i)->length() != len)
+			{
+				valid = false;
+				break;
+			}
+			memcpy(maps.at(i)->raw_ptr(), payload + i * len * sizeof(float), sizeof(float) * len);
+		}
+	}
+
+	file.unmap(ptr);
+	file.close();
+
+	return valid;
+}
+
+bool FlimMapCache::writeMaps(const QString & path, const QByteArray & key, int32_t tag, const std::vector<np::FloatArray2*> & maps)
+{
+	if (key.isEmpty() || maps.empty())
+		return false;
+
+	FlimMapCacheHeader header;
+	memset(&header, 0, sizeof(FlimMapCacheHeader));
+	header.magic = FLIM_MAP_CACHE_MAGIC;
+	header.version = FLIM_MAP_CACHE_VERSION;
+	memcpy(header.key, key.constData(), sizeof(header.key));
+	header.tag = tag;
+	header.n_maps = (int32_t)maps.size();
+	header.size0 = maps.at(0)->size(0);
+	header.size1 = maps.at(0)->size(1);
+
+	QCryptographicHash hash(QCryptographicHash::Md5);
+	for (auto pMap : maps)
+	{
+		if ((pMap->size(0) != header.size0) || (pMap->size(1) != header.size1))
+			return false;
+		hash.addData(reinterpret_cast<const char*>(pMap->raw_ptr()), sizeof(float) * pMap->length());
+	}
+	QByteArray checksum = hash.result();
+	memcpy(header.checksum, checksum.constData(), sizeof(header.checksum));
+
+	// Written aside and renamed, so an interrupted write never leaves a valid-looking cache
+	QSaveFile file(path);
+	if (!file.open(QIODevice::WriteOnly))
+		return false;
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(FlimMapCacheHeader));
+	for (auto pMap : maps)
+		file.write(reinterpret_cast<const char*>(pMap->raw_ptr()), sizeof(float) * pMap->length());
+
+	return file.commit();
+}
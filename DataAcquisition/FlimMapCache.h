@@ -0,0 +1,73 @@
+#ifndef FLIMMAPCACHE_H
+#define FLIMMAPCACHE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QFile>
+
+#include <iostream>
+#include <vector>
+
+#include <Havana3/Configuration.h>
+
+#include <Common/array.h>
+
+
+// Bump whenever the FLIm processing or the map post-processing (median filter, masking) changes
+#define FLIM_MAP_CACHE_VERSION		2
+#define FLIM_MAP_CACHE_MAGIC		0x434d4648 // "HFMC"
+#define FLIM_MAP_CACHE_SAMPLE_SIZE	1048576 // 1 MB of raw data hashed at the start, middle and end
+
+struct FlimMapCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint8_t key[16]; // MD5 of the sampled raw data & FLIm processing parameters
+	uint8_t checksum[16]; // MD5 of the payload
+	int32_t n_maps;
+	int32_t size0; // flim alines
+	int32_t size1; // frames
+	int32_t tag; // 0: FLIm maps, otherwise composition maps (compositionTag)
+};
+
+class FlimMapCache
+{
+// Constructer & Destructer /////////////////////////////
+public:
+	explicit FlimMapCache(const QString & cache_path, const QString & compo_path = QString());
+	virtual ~FlimMapCache();
+
+// Methods //////////////////////////////////////////////
+public:
+	// The key has to be set before read or write
+	void setKey(QFile* pRawFile, Configuration* pConfig, const QString & mask_path);
+
+	// Maps are filled in order; false on a missing, stale or corrupted cache
+	bool read(const std::vector<np::FloatArray2*> & maps);
+	bool write(const std::vector<np::FloatArray2*> & maps);
+
+	// Composition probability maps predicted from the FLIm maps of the same key by the same model (*.compo_cache)
+	bool readComposition(const std::vector<np::FloatArray2*> & maps, int32_t tag, const QByteArray & model);
+	bool writeComposition(const std::vector<np::FloatArray2*> & maps, int32_t tag, const QByteArray & model);
+	static int32_t compositionTag(int ml_mode, bool vib_corrected, int delay_sync);
+	static QByteArray modelFingerprint(bool random_forest);
+
+	// FLIm maps edited after loading (e.g. delay offsets): they no longer match any cached composition
+	inline void setMapsModified() { m_bMapsModified = true; }
+
+	inline QString getPath() const { return m_path; }
+
+private:
+	QByteArray compositionKey(const QByteArray & model) const;
+	bool readMaps(const QString & path, const QByteArray & key, int32_t tag, const std::vector<np::FloatArray2*> & maps);
+	bool writeMaps(const QString & path, const QByteArray & key, int32_t tag, const std::vector<np::FloatArray2*> & maps);
+
+// Variables ////////////////////////////////////////////
+private:
+	QString m_path;
+	QString m_compoPath;
+	QByteArray m_key;
+	bool m_bMapsModified;
+};
+
+#endif // FLIMMAPCACHE_H
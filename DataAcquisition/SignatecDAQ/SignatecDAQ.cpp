@@ -12,7 +12,9 @@ SignatecDAQ::SignatecDAQ() :
     PreTrigger(0), TriggerDelay(0), DcOffset(0), BootTimeBufIdx(0),
     UseVirtualDevice(false), UseInternalTrigger(false), frameRate(0.0),
     _dirty(true), _running(false), _board(PX14_INVALID_HANDLE),
-    dma_bufp(nullptr)
+    dma_bufp(nullptr), dma_buf_samples(0), handoff_running(false), consuming_slot(-1),
+	nRingFrames(PX14_RING_FRAMES), nChunksPerFrame(PX14_CHUNKS_PER_FRAME), nFramesPerCallback(PX14_FRAMES_PER_CALLBACK),
+	droppedFrames(0), overwrittenFrames(0)
 {
 }
 
@@ -120,6 +122,10 @@ bool SignatecDAQ::initialize()
 		dumpError(result, pPreamble);
 		return false;
 	}	
+
+	// Capacity of the boot-time buffer bounds the DMA ring depth
+	if (SIG_SUCCESS != BootBufCfgGetPX14(_board, BootTimeBufIdx, &dma_buf_samples))
+		dma_buf_samples = 0;
 	
 	SendStatusMessage("[SignatecDAQ] PX14400 device is successfully initialized.", false);
 
@@ -256,6 +262,31 @@ void SignatecDAQ::run()
     // Update DC Offset value
     SetDcOffsetCh1PX14(_board, DcOffset);
 
+	// Ring geometry
+	if ((nChunksPerFrame < 1) || (getFrameSize() % nChunksPerFrame))
+		nChunksPerFrame = PX14_CHUNKS_PER_FRAME;
+	if (nFramesPerCallback < 1)
+		nFramesPerCallback = 1;
+	if (nRingFrames < nFramesPerCallback + 1)
+		nRingFrames = nFramesPerCallback + 1; // the batch being collected + the frame being transferred
+	char msg[MAX_MSG_LENGTH];
+	if (dma_buf_samples && ((unsigned int)(nRingFrames * getFrameSize()) > dma_buf_samples))
+	{
+		int max_frames = (int)(dma_buf_samples / getFrameSize());
+		if (max_frames < 2)
+		{
+			sprintf(msg, "ERROR: Boot-time DMA buffer (%u samples) is too small for two frames.", dma_buf_samples);
+			SendStatusMessage(msg, true);
+			return;
+		}
+		if (max_frames < nFramesPerCallback + 1)
+			nFramesPerCallback = max_frames - 1;
+		nRingFrames = max_frames;
+	}
+
+	sprintf(msg, "[SignatecDAQ] DMA ring: %d frames x %d chunks, %d frames per callback", nRingFrames, nChunksPerFrame, nFramesPerCallback);
+	SendStatusMessage(msg, false);
+
 	// Arm recording - Acquisition will begin when the PX14400 receives a trigger event.
 	result = BeginBufferedPciAcquisitionPX14(_board);
 	if (SIG_SUCCESS != result)
@@ -263,49 +294,58 @@ void SignatecDAQ::run()
 		dumpError(result, "ERROR: Failed to arm recording: ");
 		return;
 	}
+
+	// Handoff thread: DidAcquireData runs there, so a slow consumer never delays re-arming the DMA
+	{
+		std::unique_lock<std::mutex> lock(mtx_handoff);
+		queue_handoff.clear();
+		slot_stamps.assign(nRingFrames, FrameStamp());
+		handoff_running = true;
+		consuming_slot = -1;
+	}
+	droppedFrames = 0;
+	overwrittenFrames = 0;
+	_thread_handoff = std::thread(&SignatecDAQ::handoff, this);
 	
 	unsigned loop_counter = 0; // uint32
+	int ring_chunks = nRingFrames * nChunksPerFrame;
 	px14_sample_t *cur_chunkp = nullptr;
-	px14_sample_t *prev_chunkp = nullptr;	
 	ULONG dwTickStart = 0, dwTickLastUpdate;
 
 	unsigned long long BytesAcquired = 0, BytesAcquiredUpdate = 0;
 
 	unsigned int frameIndex = 0, frameIndexUpdate = 0;
+	bool failed = false;
 	
 	_running = true;
 	while (_running)
 	{		
-		// check running status
-
 		// Determine where new data transfer data will go. 
-		cur_chunkp = dma_bufp + ((loop_counter % 8) * getDataBufferSize());
+		int chunk = loop_counter % ring_chunks;
+		cur_chunkp = dma_bufp + (chunk * getDataBufferSize());
+
+		// A slot is re-armed: completed frames of it that were never handed off are lost
+		if (chunk % nChunksPerFrame == 0)
+		{
+			std::unique_lock<std::mutex> lock(mtx_handoff);
+			if (consuming_slot == chunk / nChunksPerFrame)
+				overwrittenFrames++;
+			while (!queue_handoff.empty() && ((int)(frameIndex - queue_handoff.front()) >= nRingFrames))
+			{
+				queue_handoff.pop_front();
+				droppedFrames++;
+			}
+		}
 
 		// Start asynchronous DMA transfer of new data; this function starts
-		//  the transfer and returns without waiting for it to finish. This
-		//  gives us a chance to process the last batch of data in parallel
-		//  with this transfer.
+		//  the transfer and returns without waiting for it to finish. 
+		//  The completed frames are processed in the handoff thread meanwhile.
 		result = GetPciAcquisitionDataFastPX14(_board, getDataBufferSize(), cur_chunkp, TRUE);
 		if (SIG_SUCCESS != result)
 		{
 			dumpError(result, "ERROR: Failed to obtain PCI acquisition data: ");
-			return;
-		}
-
-		// Process previous chunk data while we're transfering to
-		// loop_counter > 1000 : to prevent FIFO overflow
-		/// if ((loop_counter % 4 == 0 || loop_counter % 4 == 2) && loop_counter > 1000)
-		if ((loop_counter % 8 == 0 || loop_counter % 8 == 4) && loop_counter != 0)
-		{
-			if (loop_counter % 8 == 0)
-				prev_chunkp = dma_bufp + 4 * getDataBufferSize(); // last half of buffer;
-			else if (loop_counter % 8 == 4)
-				prev_chunkp = dma_bufp; // first half of buffer
-			
-			// Callback
-			np::Uint16Array2 frame(prev_chunkp, nChannels * nScans, nAlines);
-			DidAcquireData(frameIndex++, frame); // Callback function			
-			frameIndexUpdate++;
+			failed = true;
+			break;
 		}
 		
 		// Wait for the asynchronous DMA transfer to complete so we can loop 
@@ -324,12 +364,31 @@ void SignatecDAQ::run()
 			else
 			{
 				dumpError(result, "ERROR: Failed to WaitForTransferCompletePX14: ");
-				return;
+				failed = true;
+				break;
 			}
 
 			if (!_running)
 				break;
 		}
+		if (failed || (result != SIG_SUCCESS))
+			break;
+
+		// Frame completed: hand it off (the callback thread is woken once per batch)
+		if (chunk % nChunksPerFrame == nChunksPerFrame - 1)
+		{
+			bool notify;
+			{
+				std::unique_lock<std::mutex> lock(mtx_handoff);
+				FrameStamp& stamp = slot_stamps.at(frameIndex % nRingFrames);
+				stamp.sequence = frameIndex;
+				stamp.timestamp_us = FrameStamp::now_us();
+				queue_handoff.push_back(frameIndex++);
+				notify = (int)queue_handoff.size() >= nFramesPerCallback;
+			}
+			if (notify) cv_handoff.notify_one();
+			frameIndexUpdate++;
+		}
 			
 		// Acquisition Status
 		if (!dwTickStart) 
@@ -370,9 +429,8 @@ void SignatecDAQ::run()
 					}
 				}
 
-				char msg[MAX_MSG_LENGTH];
-				sprintf(msg, "[SignatecDAQ] [Elapsed Time] %u:%02u:%02u [DAQ Rate] %3.2f MiB/s [Frame Rate] %.2f fps", h, m, s, 
-					dRateUpdate, frameRate);
+				sprintf(msg, "[SignatecDAQ] [Elapsed Time] %u:%02u:%02u [DAQ Rate] %3.2f MiB/s [Frame Rate] %.2f fps [Overrun] %u dropped, %u overwritten", h, m, s, 
+					dRateUpdate, frameRate, (unsigned int)droppedFrames, (unsigned int)overwrittenFrames);
 				SendStatusMessage(msg, false);
 			}
 
@@ -382,10 +440,46 @@ void SignatecDAQ::run()
 		}
 	}
 
+	// Stop the handoff thread (frames still queued are not delivered)
+	{
+		std::unique_lock<std::mutex> lock(mtx_handoff);
+		handoff_running = false;
+	}
+	cv_handoff.notify_one();
+	_thread_handoff.join();
+
     // End the acquisition. Always do this since in ensures the board is cleaned up properly
 	EndBufferedPciAcquisitionPX14(_board);	
 }
 
+void SignatecDAQ::handoff()
+{
+	std::unique_lock<std::mutex> lock(mtx_handoff);
+	while (true)
+	{
+		cv_handoff.wait(lock, [&]() { return !handoff_running || ((int)queue_handoff.size() >= nFramesPerCallback); });
+		if (!handoff_running)
+			break;
+
+		// Callback, frame by frame (a frame stays valid until its slot is re-armed)
+		for (int i = 0; (i < nFramesPerCallback) && !queue_handoff.empty() && handoff_running; i++)
+		{
+			unsigned int n = queue_handoff.front();
+			queue_handoff.pop_front();
+			int slot = n % nRingFrames;
+			consuming_slot = slot;
+			current_stamp = slot_stamps.at(slot);
+			lock.unlock();
+
+			np::Uint16Array2 frame(dma_bufp + slot * getFrameSize(), nChannels * nScans, nAlines);
+			DidAcquireData(n, frame); // Callback function
+
+			lock.lock();
+			consuming_slot = -1;
+		}
+	}
+}
+
 // Dump a PX14400 library error
 void SignatecDAQ::dumpError(int res, const char* pPreamble)
 {
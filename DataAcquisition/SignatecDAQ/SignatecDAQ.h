@@ -3,15 +3,25 @@
 
 #include <Common/array.h>
 #include <Common/callback.h>
+#include <Common/FrameStamp.h>
 
 #include <iostream>
 #include <thread>
 #include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <atomic>
 
 #define PX14_ADC_RATE		400 // MHz
 #define PX14_VOLT_RANGE     1.2 // Vpp
 #define PX14_BOOTBUF_IDX    1
 
+#define PX14_RING_FRAMES			2 // DMA ring depth (frames)
+#define PX14_CHUNKS_PER_FRAME		4 // DMA transfers per frame
+#define PX14_FRAMES_PER_CALLBACK	1 // frames handed off per wake-up of the callback thread
+
 #define MAX_MSG_LENGTH		2000
 
 
@@ -37,11 +47,13 @@ public:
 
 public:
 	inline bool is_initialized() const { return !_dirty; }
-	inline int getDataBufferSize() { return nChannels * nScans * nAlines / 4; }
-	// Data buffer size (2 channel, half size. merge two buffers to build a frame) 
+	inline int getFrameSize() { return nChannels * nScans * nAlines; }
+	inline int getDataBufferSize() { return getFrameSize() / nChunksPerFrame; }
+	// Data buffer size (one DMA chunk, nChunksPerFrame chunks build a frame) 
 	
 private:
 	void run();
+	void handoff();
 
 private:
 	// Dump a PX14400 library error
@@ -59,8 +71,20 @@ private:
 	// Initialization flag
 	bool _dirty;
 
+	// DMA buffer capacity (samples, 0 if unknown)
+	unsigned int dma_buf_samples;
+
 	// thread
 	std::thread _thread;
+
+	// Handoff of completed frames from the DMA thread to the callback thread
+	std::thread _thread_handoff;
+	std::mutex mtx_handoff;
+	std::condition_variable cv_handoff;
+	std::deque<unsigned int> queue_handoff; // DMA frame numbers
+	std::vector<FrameStamp> slot_stamps; // stamped at DMA completion
+	bool handoff_running;
+	int consuming_slot; // ring slot inside DidAcquireData, -1 if none
 	
 public:
 	int nChannels, nScans, nAlines;
@@ -73,6 +97,16 @@ public:
 	double frameRate;
 	bool _running;	
 
+	// Ring geometry (applied when the acquisition starts)
+	int nRingFrames, nChunksPerFrame, nFramesPerCallback;
+
+	// Acquisition metadata of the frame inside DidAcquireData
+	FrameStamp current_stamp;
+
+	// Overrun counters
+	std::atomic<unsigned int> droppedFrames; // completed frames discarded before the callback got to them
+	std::atomic<unsigned int> overwrittenFrames; // frames re-armed by DMA while still inside the callback
+
 public:
 	// callbacks
 	callback2<int, const np::Uint16Array2 &> DidAcquireData;
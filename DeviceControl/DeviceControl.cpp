@@ -200,7 +200,7 @@ bool DeviceControl::connectPullbackMotor(bool enabled)
 		if (m_pPullbackMotor)
 		{
 			// Disconnect the motor
-			m_pPullbackMotor->cv_motor.notify_one();
+			m_pPullbackMotor->CancelMove();
 			m_pPullbackMotor->DisableMotor();
 			m_pPullbackMotor->DisconnectDevice();
 
@@ -261,7 +261,7 @@ void DeviceControl::stop()
 	if (m_pPullbackMotor)
 	{		
 		if (m_pPullbackMotor->getMovingState())
-			m_pPullbackMotor->cv_motor.notify_one();
+			m_pPullbackMotor->CancelMove();
 		else
 			m_pPullbackMotor->StopMotor();
 	}
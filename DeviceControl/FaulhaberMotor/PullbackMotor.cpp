@@ -5,7 +5,8 @@
 PullbackMotor::PullbackMotor() :
 	port_name(""), dev_num(2),
 	current_rpm(0), current_pos(0.0f), duration(0.0f),
-	enable_state(false), moving_state(false), _running(false)
+	enable_state(false), moving_state(false), 
+	move_requested(false), cancel_requested(false), _running(false)
 {
 	setPortName("", 2);
 	m_pSerialComm = new QSerialComm;
@@ -15,7 +16,11 @@ PullbackMotor::~PullbackMotor()
 {
 	if (_thread.joinable())
 	{
-		_running = false;
+		{
+			std::unique_lock<std::mutex> lock(mtx_motor);
+			_running = false;
+		}
+		cv_motor.notify_one();
 		_thread.join();
 	}
 	DisconnectDevice();
@@ -66,6 +71,7 @@ bool PullbackMotor::ConnectDevice()
 				return false;
 			}
 
+			_running = true;
 			_thread = std::thread(&PullbackMotor::monitor, this); // thread executing
 		}
 		else
@@ -197,6 +203,21 @@ void PullbackMotor::RotateMotor(int RPM)
 	moving_state = true;
 	sprintf(msg, "[FAULHABER] Motor rotated. (%d rpm) [%s]", RPM, port_name);
 	SendStatusMessage(msg, false);
+
+	// Wake the monitor: the move times out after duration from now
+	std::chrono::steady_clock::time_point start_time;
+	{
+		std::unique_lock<std::mutex> lock(mtx_motor);
+		move_requested = true;
+		cancel_requested = false;
+		move_start_time = std::chrono::steady_clock::now();
+		start_time = move_start_time; // a new move may replace it once the lock is released
+	}
+	cv_motor.notify_one();
+
+	sprintf(msg, "[FAULHABER] Move started at %lld ms (%.2f sec expected). [%s]",
+		(long long)std::chrono::duration_cast<std::chrono::milliseconds>(start_time.time_since_epoch()).count(), duration, port_name);
+	SendStatusMessage(msg, false);
 }
 
 void PullbackMotor::StopMotor()
@@ -240,6 +261,15 @@ void PullbackMotor::StopMotor()
 	//ReadPosition();
 }
 
+void PullbackMotor::CancelMove()
+{
+	{
+		std::unique_lock<std::mutex> lock(mtx_motor);
+		cancel_requested = true;
+	}
+	cv_motor.notify_one();
+}
+
 //void PullbackMotor::ReadPosition()
 //{
 //	get_current_pos[2] = dev_num;
@@ -268,18 +298,38 @@ void PullbackMotor::StopMotor()
 
 void PullbackMotor::monitor()
 {
-	_running = true;
+	std::unique_lock<std::mutex> lock(mtx_motor);
 	while (_running)
 	{
-		if (moving_state)
-		{
-			std::unique_lock<std::mutex> lock(mtx_motor);
-			auto status = cv_motor.wait_for(lock, std::chrono::milliseconds(int(1000 * duration)));
-			{	
-				StopMotor();
-				DidRotateEnd((int)status); // no_timeout 0, timeout 1
-			}
-		}
+		// Idle: sleep until a move starts
+		cv_motor.wait(lock, [&]() { return !_running || move_requested; });
+		if (!_running)
+			break;
+		move_requested = false;
+
+		// Moving: wait out the expected duration unless cancelled or replaced by a new move
+		auto deadline = move_start_time + std::chrono::milliseconds(int(1000 * duration));
+		bool woken = cv_motor.wait_until(lock, deadline, [&]() { return !_running || cancel_requested || move_requested; });
+		if (!_running)
+			break; // the device is stopped on disconnection
+		if (move_requested && !cancel_requested)
+			continue;
+
+		cancel_requested = false;
+		lock.unlock();
+
+		StopMotor();
+
+		std::chrono::steady_clock::time_point end_time = std::chrono::steady_clock::now();
+		char msg[256];
+		sprintf(msg, "[FAULHABER] Move %s at %lld ms. [%s]", woken ? "cancelled" : "finished",
+			(long long)std::chrono::duration_cast<std::chrono::milliseconds>(end_time.time_since_epoch()).count(), port_name);
+		SendStatusMessage(msg, false);
+
+		DidRotateEnd(woken ? 0 : 1); // no_timeout 0, timeout 1
+
+		lock.lock();
+		move_end_time = end_time;
 	}
 }
 
@@ -9,6 +9,7 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <chrono>
 
 #define GEAR_RATIO 339.6715627996165 //334.224
 
@@ -29,6 +30,7 @@ public:
 	void DisableMotor();
 	void RotateMotor(int RPM);
 	void StopMotor();
+	void CancelMove();
 	//void ReadPosition();
 
 private:
@@ -43,6 +45,9 @@ public:
 	inline bool getEnableState() { return enable_state; }
 	inline bool setMovingState(bool _state) { moving_state = _state; }
 	inline bool getMovingState() { return moving_state; }
+	// steady_clock, the same clock as the frame timestamps
+	inline std::chrono::steady_clock::time_point getMoveStartTime() { std::unique_lock<std::mutex> lock(mtx_motor); return move_start_time; }
+	inline std::chrono::steady_clock::time_point getMoveEndTime() { std::unique_lock<std::mutex> lock(mtx_motor); return move_end_time; }
 
 private:
 	uint8_t CalcCRCByte(uint8_t u8Byte, uint8_t u8CRC);
@@ -65,14 +70,20 @@ private:
 	// thread
 	std::thread _thread;
 
+	// monitor state (guarded by mtx_motor)
+	std::mutex mtx_motor;
+	std::condition_variable cv_motor;
+	bool move_requested;
+	bool cancel_requested;
+	std::chrono::steady_clock::time_point move_start_time;
+	std::chrono::steady_clock::time_point move_end_time;
+
 public:
 	bool _running;
 
 public:
-	callback<int> DidRotateEnd;
+	callback<int> DidRotateEnd; // no_timeout (cancelled) 0, timeout 1
 	callback2<const char*, bool> SendStatusMessage;
-	std::mutex mtx_motor;
-	std::condition_variable cv_motor;
 };
 
 #endif
@@ -81,6 +81,7 @@ LIBS += -L/opt/homebrew/Cellar/opencv@3/3.4.16_4/lib -lopencv_core \
 
 SOURCES += Havana3/Havana3.cpp \
     Havana3/HvnSqlDataBase.cpp \
+    Havana3/RawDataExporter.cpp \
     Havana3/MainWindow.cpp \
     Havana3/QHomeTab.cpp \    
     Havana3/QPatientSelectionTab.cpp \
@@ -97,6 +98,7 @@ SOURCES += Havana3/Havana3.cpp \
     Havana3/Dialog/DeviceOptionTab.cpp \
     Havana3/Dialog/FlimCalibTab.cpp \
     Havana3/Dialog/PulseReviewTab.cpp \
+    Havana3/Dialog/RoiListModel.cpp \
     Havana3/Dialog/ExportDlg.cpp
 
 win32 {
@@ -108,7 +110,9 @@ SOURCES += DataAcquisition/SignatecDAQ/SignatecDAQ.cpp \
     DataAcquisition/ThreadManager.cpp \
     DataAcquisition/DataAcquisition.cpp \
     DataAcquisition/DataProcessing.cpp \
-    DataAcquisition/DataProcessingDotter.cpp
+    DataAcquisition/DataProcessingDotter.cpp \
+    DataAcquisition/FlimMapCache.cpp \
+    DataAcquisition/BatchProcessing.cpp
 }
 macx {
 SOURCES += DataAcquisition/FLImProcess/FLImProcess.cpp \
@@ -116,7 +120,9 @@ SOURCES += DataAcquisition/FLImProcess/FLImProcess.cpp \
     DataAcquisition/ThreadManager.cpp \
     DataAcquisition/DataAcquisition.cpp \
     DataAcquisition/DataProcessing.cpp \
-    DataAcquisition/DataProcessingDotter.cpp
+    DataAcquisition/DataProcessingDotter.cpp \
+    DataAcquisition/FlimMapCache.cpp \
+    DataAcquisition/BatchProcessing.cpp
 }
 
 SOURCES += MemoryBuffer/MemoryBuffer.cpp
@@ -132,11 +138,13 @@ SOURCES += DeviceControl/FreqDivider/FreqDivider.cpp \
     DeviceControl/FaulhaberMotor/RotaryMotor.cpp \
     DeviceControl/DeviceControl.cpp
 
-SOURCES += Common/svm.cpp
+SOURCES += Common/allocator.cpp \
+    Common/svm.cpp
 
 
 HEADERS += Havana3/Configuration.h \
     Havana3/HvnSqlDataBase.h \
+    Havana3/RawDataExporter.h \
     Havana3/MainWindow.h \
     Havana3/QHomeTab.h \
     Havana3/QPatientSelectionTab.h \
@@ -153,6 +161,7 @@ HEADERS += Havana3/Configuration.h \
     Havana3/Dialog/DeviceOptionTab.h \
     Havana3/Dialog/FlimCalibTab.h \
     Havana3/Dialog/PulseReviewTab.h \
+    Havana3/Dialog/RoiListModel.h \
     Havana3/Dialog/ExportDlg.h
 
 win32 {
@@ -164,14 +173,18 @@ HEADERS += DataAcquisition/SignatecDAQ/SignatecDAQ.h \
     DataAcquisition/ThreadManager.h \
     DataAcquisition/DataAcquisition.h \
     DataAcquisition/DataProcessing.h \
-    DataAcquisition/DataProcessingDotter.h
+    DataAcquisition/DataProcessingDotter.h \
+    DataAcquisition/FlimMapCache.h \
+    DataAcquisition/BatchProcessing.h
 }
 macx {
 HEADERS += DataAcquisition/FLImProcess/FLImProcess.h \
     DataAcquisition/OCTProcess/OCTProcess.cpp \
     DataAcquisition/ThreadManager.h \
     DataAcquisition/DataAcquisition.h \
-    DataAcquisition/DataProcessing.h
+    DataAcquisition/DataProcessing.h \
+    DataAcquisition/FlimMapCache.h \
+    DataAcquisition/BatchProcessing.h
 }
 
 HEADERS += MemoryBuffer/MemoryBuffer.h
@@ -189,6 +202,7 @@ HEADERS += DeviceControl/FreqDivider/FreqDivider.h \
     DeviceControl/DeviceControl.h
 
 HEADERS += Common/lumen_detection.h \
+    Common/FrameStamp.h \
     Common/random_forest.h \
     Common/support_vector_machine.h \
     Common/svm.h
@@ -51,8 +51,32 @@
 
 #define RAW_SUBSAMPLING				8 // for raw data acquisition
 
+////////////////////////// Database /////////////////////////
+#define PATIENT_LIST_PAGE_SIZE		200
+#define PREVIEW_SIZE				144
+#define PREVIEW_FORMAT				"JPG"
+#define PREVIEW_QUALITY				90
+#define PREVIEW_CACHE_SIZE			32768 // KB
+
+#define EXPORT_COPY_THREADS			4
+#define EXPORT_COPY_BUFFER_SIZE		4194304 // 4 MB
+#define EXPORT_MANIFEST_NAME		"export_manifest.txt"
+
+#define BATCH_THREAD_BUDGET			0 // 0: all hardware threads (shared by every record in flight)
+#define BATCH_MEMORY_BUDGET			8192 // MB of review buffers of the records in flight
+#define BATCH_MAX_RECORDS			4 // records in flight at most
+
 //////////////// Thread & Buffer Processing /////////////////
 #define PROCESSING_BUFFER_SIZE		80
+#define VISUALIZATION_BUFFER_SIZE	4 // latest frames only, the oldest is dropped when the GUI falls behind
+#define LIVE_BUFFER_MEMORY_BUDGET	268435456 // 256 MB per live processing stage (when the count is not given in the ini)
+#define READ_AHEAD_BLOCK_SIZE		16777216 // 16 MB of whole frames per review read request
+#define READ_AHEAD_BLOCKS			4 // blocks read ahead of the review deinterleaving
+#define PROGRESSIVE_PUBLISH_INTERVAL	100 // msec between the processed frame ranges published to the review
+
+// np::memory subsystems (live bytes of the arrays allocated under their np::memory::subsystem_scope)
+enum MemorySubsystem { _MEM_GENERAL_ = 0, _MEM_STREAMING_, _MEM_REVIEW_, _MEM_BATCH_ };
+#define REVIEW_PULSE_FRAMES_KEPT	8 // on-demand pulse review frames kept when over the memory budget
 
 #ifdef _DEBUG
 #define WRITING_BUFFER_SIZE			500
@@ -66,6 +90,7 @@
 #define GAUSSIAN_FILTER_STD			56.5 ///60 // 48 // 48 vs 55 // 48 => 80MHz
 #define FLIM_SPLINE_FACTOR			20
 #define INTENSITY_THRES				0.001f
+#define FLIM_PARAM_BLOCK_SIZE		1024 // samples per block of the FLIm parameter pass
 
 /////////////////////// Visualization ///////////////////////
 #define DOTTER_OCT_RADIUS			1300
@@ -73,6 +98,12 @@
 
 #define LONGI_WIDTH					1180
 #define LONGI_HEIGHT				243
+#define LONGI_UPDATE_INTERVAL		16 // msec (coalesced longitudinal view updates from pulse review)
+
+#define ROI_JOURNAL_COMPACT_SIZE	64 // entries (roi.csv.journal folded into roi.csv)
+
+#define IVUS_FRAME_CACHE_SIZE		256 // frames
+#define IVUS_READ_AHEAD				24 // frames
 
 #define OCT_COLORTABLE              2 // sepia
 #define INTENSITY_COLORTABLE		0 // gray
@@ -140,7 +171,8 @@ public:
 	explicit Configuration() : dbPath(""), ivusPath(""), 
 		flimColormapType(0), octRadius(0), circOffset(0), reflectionRemoval(false), reflectionDistance(REFLECTION_DISTANCE), reflectionLevel(REFLECTION_LEVEL),
 		mergeNorFib(false), mergeMacTcfa(true), normalizeLogistics(true), playInterval(100),
-		rotatedAlines(0), verticalMirroring(false), intraFrameSync(0), interFrameSync(0), flimDelaySync(0), is_dotter(false)
+		rotatedAlines(0), verticalMirroring(false), intraFrameSync(0), interFrameSync(0), flimDelaySync(0), 
+		liveProcessingBuffers(0), liveVisualizationBuffers(0), axsunRingSize(0), memoryBudget(0), hugePages(false), is_dotter(false)
 	{
 		memset(flimDelayOffset0, 0, sizeof(float) * 3);
 		quantitationRange.min = -1;
@@ -252,6 +284,9 @@ public:
 		pmtGainVoltage = settings.value("pmtGainVoltage").toFloat(); 
 #ifndef NEXT_GEN_SYSTEM
         px14DcOffset = settings.value("px14DcOffset").toInt();
+		px14RingFrames = settings.value("px14RingFrames").toInt();
+		px14ChunksPerFrame = settings.value("px14ChunksPerFrame").toInt();
+		px14FramesPerCallback = settings.value("px14FramesPerCallback").toInt();
 #else
 		flimLaserPower = settings.value("flimLaserPower").toInt();
 #endif
@@ -262,6 +297,15 @@ public:
 		axsunDbRange.max = settings.value("axsunDbRangeMax").toFloat();
 		axsunDbRange.min = settings.value("axsunDbRangeMin").toFloat();
 
+		// Live buffers (0: sized from the image geometry)
+		liveProcessingBuffers = settings.value("liveProcessingBuffers").toInt();
+		liveVisualizationBuffers = settings.value("liveVisualizationBuffers").toInt();
+		axsunRingSize = settings.value("axsunRingSize").toInt();
+
+		// Array memory (0: no budget)
+		memoryBudget = settings.value("memoryBudget").toInt();
+		hugePages = settings.value("hugePages").toBool();
+
         // Database
         dbPath = settings.value("dbPath").toString();
 		ivusPath = settings.value("ivusPath").toString();
@@ -358,6 +402,9 @@ public:
 		settings.setValue("pmtGainVoltage", QString::number(pmtGainVoltage, 'f', 3));
 #ifndef NEXT_GEN_SYSTEM
         settings.setValue("px14DcOffset", px14DcOffset);
+		settings.setValue("px14RingFrames", px14RingFrames);
+		settings.setValue("px14ChunksPerFrame", px14ChunksPerFrame);
+		settings.setValue("px14FramesPerCallback", px14FramesPerCallback);
 #else
 		settings.setValue("flimLaserPower", flimLaserPower);
 #endif
@@ -368,6 +415,15 @@ public:
 		settings.setValue("axsunDbRangeMax", QString::number(axsunDbRange.max, 'f', 1));
 		settings.setValue("axsunDbRangeMin", QString::number(axsunDbRange.min, 'f', 1));
 
+		// Live buffers
+		settings.setValue("liveProcessingBuffers", liveProcessingBuffers);
+		settings.setValue("liveVisualizationBuffers", liveVisualizationBuffers);
+		settings.setValue("axsunRingSize", axsunRingSize);
+
+		// Array memory
+		settings.setValue("memoryBudget", memoryBudget);
+		settings.setValue("hugePages", hugePages);
+
         // Database
         settings.setValue("dbPath", dbPath);
 		settings.setValue("ivusPath", ivusPath);
@@ -460,6 +516,7 @@ public:
 	int laserPowerLevel;
 #ifndef NEXT_GEN_SYSTEM
     int px14DcOffset;
+	int px14RingFrames, px14ChunksPerFrame, px14FramesPerCallback; // DMA ring (0: SignatecDAQ defaults)
 #else
 	int flimLaserPower;
 #endif
@@ -468,6 +525,15 @@ public:
 	float axsunDispComp_a2, axsunDispComp_a3;
     ContrastRange<float> axsunDbRange;	
 
+	// Live buffers
+	int liveProcessingBuffers;
+	int liveVisualizationBuffers;
+	int axsunRingSize; // Axsun capture sections (0: AXSUN_RING_SIZE)
+
+	// Array memory
+	int memoryBudget; // MB of arrays & pooled blocks, the review evicts its caches beyond it (0: no budget)
+	bool hugePages;
+
     // Database
     QString dbPath;
 	QString ivusPath;
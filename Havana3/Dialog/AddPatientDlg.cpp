@@ -258,21 +258,15 @@ void AddPatientDlg::add()
     QString accession_number = m_pLineEdit_AccessionNumber->text();
     QString keywords = m_pLineEdit_Keywords->text();
 
-    QString command = QString("INSERT INTO patients(first_name, last_name, patient_id, dob, gender, accession_number, notes, physician_name) "
-                              "VALUES('%1', '%2', '%3', '%4', %5, '%6', '%7', '%8')").arg(first_name).arg(last_name).arg(patient_id)
-                              .arg(date_of_birth).arg(gender).arg(accession_number).arg(keywords).arg(physician_name);
+    QString command = "INSERT INTO patients(first_name, last_name, patient_id, dob, gender, accession_number, notes, physician_name) "
+                      "VALUES(?, ?, ?, ?, ?, ?, ?, ?)";
 
-    if (m_pHvnSqlDataBase->queryDatabase(command))
+    if (m_pHvnSqlDataBase->queryPrepared(command, { first_name, last_name, patient_id, date_of_birth, gender, accession_number, keywords, physician_name }))
     {
         m_pPatientSelectionTab->loadPatientDatabase();
-        for (int i = 0; i < m_pPatientSelectionTab->getTableWidgetPatientInformation()->rowCount(); i++)
-        {
-            if (m_pPatientSelectionTab->getTableWidgetPatientInformation()->item(i, 1)->text() == patient_id)
-            {
-                m_pPatientSelectionTab->getTableWidgetPatientInformation()->selectRow(i);
-                break;
-            }
-        }
+        int patient_row = m_pPatientSelectionTab->findPatientRow(patient_id);
+        if (patient_row >= 0)
+            m_pPatientSelectionTab->getTableWidgetPatientInformation()->selectRow(patient_row);
 
 		if (!QDir().exists(m_pConfig->dbPath + "/record/" + patient_id))
 			QDir().mkdir(m_pConfig->dbPath + "/record");
@@ -294,10 +288,9 @@ void AddPatientDlg::edit()
     QString accession_number = m_pLineEdit_AccessionNumber->text();
     QString keywords = m_pLineEdit_Keywords->text();
 
-    QString command = QString("UPDATE patients SET first_name='%1', last_name='%2', dob='%4', gender=%5, accession_number='%6', notes='%7', physician_name='%8' WHERE patient_id='%3'")
-                              .arg(first_name).arg(last_name).arg(patient_id).arg(date_of_birth).arg(gender).arg(accession_number).arg(keywords).arg(physician_name);
+    QString command = "UPDATE patients SET first_name=?, last_name=?, dob=?, gender=?, accession_number=?, notes=?, physician_name=? WHERE patient_id=?";
 	
-    if (m_pHvnSqlDataBase->queryDatabase(command))
+    if (m_pHvnSqlDataBase->queryPrepared(command, { first_name, last_name, date_of_birth, gender, accession_number, keywords, physician_name, patient_id }))
     {
         m_pPatientSummaryTab->loadPatientInformation();
 
@@ -309,9 +302,7 @@ void AddPatientDlg::edit()
 
 void AddPatientDlg::loadPatientInformation()
 {
-    QString command = QString("SELECT * FROM patients WHERE patient_id=%1").arg(m_patientId);
-
-    m_pHvnSqlDataBase->queryDatabase(command, [&](QSqlQuery& _sqlQuery) {
+    m_pHvnSqlDataBase->queryPrepared("SELECT * FROM patients WHERE patient_id=?", { m_patientId.toInt() }, [&](QSqlQuery& _sqlQuery) {
 
         while (_sqlQuery.next())
         {
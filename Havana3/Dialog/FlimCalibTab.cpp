@@ -371,7 +371,7 @@ void FlimCalibTab::drawRoiPulse(int aline)
     static int roi_width = 0;
     np::FloatArray2 data0((!m_pCheckBox_SplineView->isChecked()) ? ((!m_pCheckBox_ShowMask->isChecked()) ? m_pFLIm->_resize.crop_src : m_pFLIm->_resize.mask_src) : m_pFLIm->_resize.filt_src);
     np::FloatArray2 data(data0.size(0), data0.size(1));
-    memcpy(data.raw_ptr(), data0.raw_ptr(), sizeof(float) * data0.length());
+    np::copy(data, data0);
 
     if (roi_width != data.size(0))
     {
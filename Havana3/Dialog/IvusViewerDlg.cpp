@@ -17,21 +17,34 @@
 #include <ippi.h>
 
 
-cv::Mat ImageRotateInner(const cv::Mat src, double degree
-	, cv::Point2f base = cv::Point2f(std::numeric_limits<float>::infinity())) {
-	if (base.x == std::numeric_limits<float>::infinity()) {
-		base.x = src.cols / 2;
-		base.y = src.rows / 2;
+void BuildRotationMap(int width, int height, double degree, cv::Mat& map1, cv::Mat& map2)
+{
+	// Inverse mapping of the rotation about the image center, same geometry as warpAffine
+	cv::Mat rot = cv::getRotationMatrix2D(cv::Point2f(width / 2, height / 2), degree, 1.0);
+	cv::Mat inv; cv::invertAffineTransform(rot, inv);
+
+	cv::Mat mapX(height, width, CV_32FC1), mapY(height, width, CV_32FC1);
+	for (int y = 0; y < height; y++)
+	{
+		float* px = mapX.ptr<float>(y);
+		float* py = mapY.ptr<float>(y);
+		for (int x = 0; x < width; x++)
+		{
+			px[x] = (float)(inv.at<double>(0, 0) * x + inv.at<double>(0, 1) * y + inv.at<double>(0, 2));
+			py[x] = (float)(inv.at<double>(1, 0) * x + inv.at<double>(1, 1) * y + inv.at<double>(1, 2));
+		}
 	}
-	cv::Mat dst = src.clone();
-	cv::Mat rot = cv::getRotationMatrix2D(base, degree, 1.0);
-	cv::warpAffine(src, dst, rot, src.size());
-	return std::move(dst);
+
+	// Fixed-point maps are considerably faster to apply
+	cv::convertMaps(mapX, mapY, map1, map2, CV_16SC2);
 }
 
 
 IvusViewerDlg::IvusViewerDlg(QWidget *parent) :
-    QDialog(parent), m_pConfigTemp(nullptr), m_pResultTab(nullptr), _running(false)
+    QDialog(parent), m_pConfigTemp(nullptr), m_pResultTab(nullptr), _running(false),
+	m_nIvusFrames(0), m_nIvusWidth(0), m_nIvusHeight(0), m_nNextDecodeFrame(-1), m_nLastVisualizedFrame(0),
+	m_cacheIvusFrames(IVUS_FRAME_CACHE_SIZE), m_nReadAheadFrame(0), m_nReadAheadDirection(1),
+	m_bReadAheadPending(false), m_bReadAheadRunning(false), m_nRotationMapAngle(-1)
 {
     // Set default size & frame
     setFixedSize(500, 563);
@@ -78,6 +91,7 @@ IvusViewerDlg::~IvusViewerDlg()
 		_running = false;
 		playing.join();
 	}
+	stopReadAhead();
 }
 
 void IvusViewerDlg::keyPressEvent(QKeyEvent *e)
@@ -220,35 +234,91 @@ void IvusViewerDlg::loadIvusData(bool status)
 	// Get path to read	
 	if (fileName != "")
 	{
+		// Stop playing and read-ahead before switching the movie
+		m_pToggleButton_Play->setChecked(false);
+		stopReadAhead();
+
 		m_pConfigTemp->ivusPath = fileName;
 		{
-			cv::VideoCapture capture((m_pConfig->dbPath + "/" + m_pConfigTemp->ivusPath).toStdString());
-			cv::Mat frame;
+			std::unique_lock<std::mutex> lock(m_mtxCapture);
 
-			if (capture.isOpened())
 			{
-				m_vectorIvusImages.clear();
-				while (1)
+				std::unique_lock<std::mutex> lock(m_mtxCache);
+				m_cacheIvusFrames.clear();
+			}
+			m_ivusCapture.release();
+			m_nIvusFrames = 0;
+			m_nNextDecodeFrame = -1;
+			m_nLastVisualizedFrame = 0;
+
+			// Only the first frame is decoded here; the rest is streamed on demand
+			np::Uint8Array2 ivusImage;
+			if (m_ivusCapture.open((m_pConfig->dbPath + "/" + m_pConfigTemp->ivusPath).toStdString()) && decodeIvusFrame(0, ivusImage))
+			{
+				m_nIvusWidth = ivusImage.size(0);
+				m_nIvusHeight = ivusImage.size(1);
+				m_nIvusFrames = (int)m_ivusCapture.get(cv::CAP_PROP_FRAME_COUNT);
+				if (m_nIvusFrames <= 0)
 				{
-					capture >> frame;
-					if (frame.empty())
-						break;
-					
-					np::Uint8Array2 ivusImage(frame.cols, frame.rows);
-					ippiCopy_8u_C3C1R(frame.data, 3 * frame.cols, ivusImage, frame.cols, { frame.cols, frame.rows });
-					ippiMirror_8u_C1IR(ivusImage, frame.cols, { frame.cols, frame.rows }, ippAxsVertical);
-					m_vectorIvusImages.push_back(ivusImage);
-				} 
+					// Container without frame count: count by grabbing (no decoding)
+					m_nIvusFrames = 1;
+					while (m_ivusCapture.grab())
+						m_nIvusFrames++;
+					m_nNextDecodeFrame = m_nIvusFrames;
+				}
 			}
 			else
 			{
+				m_ivusCapture.release();
+
 				QMessageBox MsgBox(QMessageBox::Critical, "Read error", "Cannot open IVUS movie!");
 				MsgBox.exec();
 
 				return;
 			}
+
+			std::unique_lock<std::mutex> lock_cache(m_mtxCache);
+			m_cacheIvusFrames.insert(0, new np::Uint8Array2(ivusImage));
 		}
 
+		// Start read-ahead thread
+		m_bReadAheadRunning = true;
+		m_threadReadAhead = std::thread([&]() {
+			while (true)
+			{
+				int frame, direction;
+				{
+					std::unique_lock<std::mutex> lock(m_mtxReadAhead);
+					m_cvReadAhead.wait(lock, [&]() { return m_bReadAheadPending || !m_bReadAheadRunning; });
+					if (!m_bReadAheadRunning) break;
+
+					frame = m_nReadAheadFrame;
+					direction = m_nReadAheadDirection;
+					m_bReadAheadPending = false;
+				}
+
+				// Decoding is forward-only, so a backward window is also filled from its oldest frame
+				int first = (direction > 0) ? frame + 1 : std::max(frame - IVUS_READ_AHEAD, 0);
+				int last = (direction > 0) ? std::min(frame + IVUS_READ_AHEAD, m_nIvusFrames - 1) : frame - 1;
+				for (int i = first; i <= last; i++)
+				{
+					// Abandon the window as soon as a newer request arrives
+					if (m_bReadAheadPending || !m_bReadAheadRunning)
+						break;
+					if (isIvusFrameCached(i))
+						continue;
+
+					np::Uint8Array2 ivusImage;
+					{
+						std::unique_lock<std::mutex> lock(m_mtxCapture);
+						if (!decodeIvusFrame(i, ivusImage))
+							break;
+					}
+					cacheIvusFrame(i, ivusImage);
+				}
+			}
+		});
+
 		// Load matching data
 		m_pResultTab->getViewTab()->loadPickFrames(m_vectorMatches);
 
@@ -256,7 +326,7 @@ void IvusViewerDlg::loadIvusData(bool status)
 		m_pConfigTemp->setConfigFile(m_pResultTab->getDataProcessing()->getIniName());
 
 		// Set widgets
-		m_pImageView_Ivus->resetSize(m_vectorIvusImages.at(0).size(0), m_vectorIvusImages.at(0).size(1));
+		m_pImageView_Ivus->resetSize(m_nIvusWidth, m_nIvusHeight);
 
 		m_pPushButton_Pick->setEnabled(true);
 		m_pToggleButton_Play->setEnabled(true);
@@ -269,9 +339,9 @@ void IvusViewerDlg::loadIvusData(bool status)
 
 		m_pResultTab->getViewTab()->getPickButton()->setDisabled(true);
 
-		QString str; str.sprintf("   Frames : %4d / %4d", 1, m_vectorIvusImages.size());
+		QString str; str.sprintf("   Frames : %4d / %4d", 1, m_nIvusFrames);
 		m_pLabel_SelectFrame->setText(str);
-		m_pSlider_SelectFrame->setRange(0, (int)m_vectorIvusImages.size() - 1);
+		m_pSlider_SelectFrame->setRange(0, m_nIvusFrames - 1);
 
 		// Play IVUS movie
 		m_pToggleButton_Play->setChecked(true);
@@ -343,7 +413,7 @@ void IvusViewerDlg::play(bool enabled)
 		m_pToggleButton_Play->setIcon(style()->standardIcon(QStyle::SP_MediaStop));
 
 		int cur_frame = m_pSlider_SelectFrame->value();
-		int end_frame = (int)m_vectorIvusImages.size();
+		int end_frame = m_nIvusFrames;
 
 		if (cur_frame + 1 == end_frame)
 			cur_frame = 0;
@@ -374,15 +444,20 @@ void IvusViewerDlg::play(bool enabled)
 
 void IvusViewerDlg::visualizeImage(int frame)
 {
-	if (m_vectorIvusImages.size() != 0)
+	if (m_nIvusFrames != 0)
 	{
+		// Keep decoding ahead in the direction of navigation
+		requestReadAhead(frame, (frame >= m_nLastVisualizedFrame) ? 1 : -1);
+		m_nLastVisualizedFrame = frame;
+
 		// Draw IVUS image
-		m_imageBuffer = np::Uint8Array2(m_vectorIvusImages.at(frame).size(1), m_vectorIvusImages.at(frame).size(0));
+		if ((m_imageBuffer.size(0) != m_nIvusHeight) || (m_imageBuffer.size(1) != m_nIvusWidth))
+			m_imageBuffer = np::Uint8Array2(m_nIvusHeight, m_nIvusWidth);
 		getIvusImage(frame, m_pSlider_Rotation->value(), m_imageBuffer);
 		emit paintIvusImage(m_imageBuffer);
 
 		// Set widget
-		QString str; str.sprintf("   Frames : %4d / %4d", frame + 1, m_vectorIvusImages.size());
+		QString str; str.sprintf("   Frames : %4d / %4d", frame + 1, m_nIvusFrames);
 		m_pLabel_SelectFrame->setText(str);		
 	}
 }
@@ -399,7 +474,112 @@ void IvusViewerDlg::imageRotated(int angle)
 
 void IvusViewerDlg::getIvusImage(int frame, int angle, np::Uint8Array2& dst)
 {
-	cv::Mat inputMat = cv::Mat(m_vectorIvusImages.at(frame).size(1), m_vectorIvusImages.at(frame).size(0), CV_8UC1, m_vectorIvusImages.at(frame));
-	cv::Mat outputMat = ImageRotateInner(inputMat, angle);
-	memcpy(dst, outputMat.data, dst.length());	
-}
\ No newline at end of file
+	np::Uint8Array2 ivusImage;
+	if (!getIvusFrame(frame, ivusImage))
+	{
+		memset(dst, 0, dst.length());
+		return;
+	}
+
+	if (angle % 360 == 0)
+	{
+		memcpy(dst, ivusImage, dst.length());
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(m_mtxRotationMap);
+	if ((angle != m_nRotationMapAngle) || (m_rotationMap1.cols != m_nIvusWidth) || (m_rotationMap1.rows != m_nIvusHeight))
+	{
+		BuildRotationMap(m_nIvusWidth, m_nIvusHeight, angle, m_rotationMap1, m_rotationMap2);
+		m_nRotationMapAngle = angle;
+	}
+
+	cv::Mat inputMat(m_nIvusHeight, m_nIvusWidth, CV_8UC1, ivusImage);
+	cv::Mat outputMat(m_nIvusHeight, m_nIvusWidth, CV_8UC1, dst);
+	cv::remap(inputMat, outputMat, m_rotationMap1, m_rotationMap2, cv::INTER_LINEAR);
+}
+
+
+bool IvusViewerDlg::getIvusFrame(int frame, np::Uint8Array2& ivusImage)
+{
+	if ((frame < 0) || (frame >= m_nIvusFrames))
+		return false;
+
+	{
+		std::unique_lock<std::mutex> lock(m_mtxCache);
+		np::Uint8Array2* pCached = m_cacheIvusFrames.object(frame);
+		if (pCached)
+		{
+			ivusImage = *pCached;
+			return true;
+		}
+	}
+
+	// Cache miss: decode synchronously
+	{
+		std::unique_lock<std::mutex> lock(m_mtxCapture);
+		if (!decodeIvusFrame(frame, ivusImage))
+			return false;
+	}
+	cacheIvusFrame(frame, ivusImage);
+
+	return true;
+}
+
+bool IvusViewerDlg::decodeIvusFrame(int frame, np::Uint8Array2& ivusImage)
+{
+	// Called with m_mtxCapture held; seek only when the frame is not the next one in the stream
+	if (frame != m_nNextDecodeFrame)
+		m_ivusCapture.set(cv::CAP_PROP_POS_FRAMES, frame);
+
+	cv::Mat mat;
+	if (!m_ivusCapture.read(mat) || mat.empty())
+	{
+		m_nNextDecodeFrame = -1;
+		return false;
+	}
+	m_nNextDecodeFrame = frame + 1;
+
+	ivusImage = np::Uint8Array2(mat.cols, mat.rows);
+	ippiCopy_8u_C3C1R(mat.data, (int)mat.step, ivusImage, mat.cols, { mat.cols, mat.rows });
+	ippiMirror_8u_C1IR(ivusImage, mat.cols, { mat.cols, mat.rows }, ippAxsVertical);
+
+	return true;
+}
+
+void IvusViewerDlg::cacheIvusFrame(int frame, const np::Uint8Array2& ivusImage)
+{
+	std::unique_lock<std::mutex> lock(m_mtxCache);
+	if (!m_cacheIvusFrames.contains(frame))
+		m_cacheIvusFrames.insert(frame, new np::Uint8Array2(ivusImage));
+}
+
+bool IvusViewerDlg::isIvusFrameCached(int frame)
+{
+	std::unique_lock<std::mutex> lock(m_mtxCache);
+	return m_cacheIvusFrames.contains(frame);
+}
+
+void IvusViewerDlg::requestReadAhead(int frame, int direction)
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mtxReadAhead);
+		m_nReadAheadFrame = frame;
+		m_nReadAheadDirection = direction;
+		m_bReadAheadPending = true;
+	}
+	m_cvReadAhead.notify_one();
+}
+
+void IvusViewerDlg::stopReadAhead()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mtxReadAhead);
+		m_bReadAheadRunning = false;
+		m_bReadAheadPending = false;
+	}
+	m_cvReadAhead.notify_one();
+
+	if (m_threadReadAhead.joinable())
+		m_threadReadAhead.join();
+}
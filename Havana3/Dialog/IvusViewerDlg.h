@@ -8,9 +8,15 @@
 
 #include <Common/array.h>
 
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
 #include <iostream>
 #include <vector>
 #include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
 
 #define IVUS_IMG_SIZE 512
 
@@ -33,6 +39,14 @@ private:
 private:
 	void createWidgets();
 
+private:
+	bool getIvusFrame(int frame, np::Uint8Array2& ivusImage);
+	bool decodeIvusFrame(int frame, np::Uint8Array2& ivusImage);
+	void cacheIvusFrame(int frame, const np::Uint8Array2& ivusImage);
+	bool isIvusFrameCached(int frame);
+	void requestReadAhead(int frame, int direction);
+	void stopReadAhead();
+
 private slots:
 	void loadIvusData(bool);
 	void pickAsMatchedFrame();
@@ -42,6 +56,7 @@ private slots:
 
 public:
 	void getIvusImage(int frame, int angle, np::Uint8Array2& dst);
+	inline int getIvusFrameCount() const { return m_nIvusFrames; }
 
 signals:
 	void paintIvusImage(uint8_t*);
@@ -54,7 +69,6 @@ private:
 	QResultTab* m_pResultTab;
 	
 public:
-	std::vector<np::Uint8Array2> m_vectorIvusImages;
 	np::Uint8Array2 m_imageBuffer;
 	std::vector<QStringList> m_vectorMatches;
 
@@ -62,6 +76,29 @@ private:
 	std::thread playing;
 	bool _running;
 
+private:
+	// IVUS movie streaming (frames are decoded on demand)
+	cv::VideoCapture m_ivusCapture;
+	std::mutex m_mtxCapture;
+	int m_nIvusFrames, m_nIvusWidth, m_nIvusHeight;
+	int m_nNextDecodeFrame;
+	int m_nLastVisualizedFrame;
+
+	QCache<int, np::Uint8Array2> m_cacheIvusFrames;
+	std::mutex m_mtxCache;
+
+	std::thread m_threadReadAhead;
+	std::mutex m_mtxReadAhead;
+	std::condition_variable m_cvReadAhead;
+	int m_nReadAheadFrame, m_nReadAheadDirection;
+	std::atomic<bool> m_bReadAheadPending;
+	std::atomic<bool> m_bReadAheadRunning;
+
+	// Rotation remap (rebuilt only when the angle or frame size changes)
+	cv::Mat m_rotationMap1, m_rotationMap2;
+	int m_nRotationMapAngle;
+	std::mutex m_mtxRotationMap;
+
 private:
 	QVBoxLayout *m_pVBoxLayout;
     QGroupBox *m_pGroupBox_IvusViewer;
@@ -9,6 +9,7 @@
 #include <DataAcquisition/DataAcquisition.h>
 #include <DataAcquisition/DataProcessing.h>
 #include <DataAcquisition/DataProcessingDotter.h>
+#include <DataAcquisition/FlimMapCache.h>
 #include <DataAcquisition/SignatecDAQ/SignatecDAQ.h>
 #include <DataAcquisition/FLImProcess/FLImProcess.h>
 
@@ -49,7 +50,7 @@ uint32_t plaque_type_color[9] = { 0xf0f0f0, // none
 PulseReviewTab::PulseReviewTab(QWidget *parent) :
     QDialog(parent), m_pConfigTemp(nullptr), 
 	m_pResultTab(nullptr), m_pViewTab(nullptr), 
-	m_pFLIm(nullptr), m_totalRois(0), m_bFromTable(false)
+	m_pFLIm(nullptr), m_bFromTable(false), m_nPendingLongiAline(-1)
 {
 	// Set configuration objects
 	m_pResultTab = dynamic_cast<QResultTab*>(parent);
@@ -232,11 +233,19 @@ void PulseReviewTab::createPulseView()
 	m_pComboBox_PlaqueType->setFixedWidth(120);
 	m_pComboBox_PlaqueType->setDisabled(true);
 		
-	m_pTableWidget_RoiList = new QTableWidget(this);
-	m_pTableWidget_RoiList->setFixedSize(419, 180);
-	m_pTableWidget_RoiList->clearContents();
-	m_pTableWidget_RoiList->setRowCount(0);
-	m_pTableWidget_RoiList->setColumnCount(6);
+	QStringList typeNames;
+	for (int i = 0; i < m_pComboBox_PlaqueType->count(); i++)
+		typeNames << m_pComboBox_PlaqueType->itemText(i);
+
+	m_pRoiListModel = new RoiListModel(this);
+	m_pRoiListModel->setTypeNames(typeNames);
+
+	m_pRoiSortModel = new QSortFilterProxyModel(this);
+	m_pRoiSortModel->setSourceModel(m_pRoiListModel);
+
+	m_pTableView_RoiList = new QTableView(this);
+	m_pTableView_RoiList->setFixedSize(419, 180);
+	m_pTableView_RoiList->setModel(m_pRoiSortModel);
 	
 	m_pLabel_Comments = new QLabel(this);
 	m_pLabel_Comments->setText("   Comments  ");
@@ -246,33 +255,30 @@ void PulseReviewTab::createPulseView()
 	m_pLineEdit_Comments->setFixedWidth(80);
 	m_pLineEdit_Comments->setDisabled(true);
 
-	QStringList rowLabels1;
-	rowLabels1 << "#" << "Frame" << "Start" << "End" << "Type" << "Comments";
-	m_pTableWidget_RoiList->setHorizontalHeaderLabels(rowLabels1);
 	QHeaderView* pVh = new QHeaderView(Qt::Vertical);
 	pVh->hide();
-	m_pTableWidget_RoiList->setVerticalHeader(pVh);
-
-	m_pTableWidget_RoiList->setAlternatingRowColors(true);
-	m_pTableWidget_RoiList->setSelectionMode(QAbstractItemView::SingleSelection);
-	m_pTableWidget_RoiList->setEditTriggers(QAbstractItemView::NoEditTriggers);
-	m_pTableWidget_RoiList->setSelectionBehavior(QAbstractItemView::SelectRows);
-
-	m_pTableWidget_RoiList->setShowGrid(true);
-	m_pTableWidget_RoiList->setGridStyle(Qt::DotLine);
-	m_pTableWidget_RoiList->setSortingEnabled(true);
-	m_pTableWidget_RoiList->setCornerButtonEnabled(false);
-
-	m_pTableWidget_RoiList->verticalHeader()->setDefaultSectionSize(23);
-	m_pTableWidget_RoiList->verticalHeader()->setDefaultAlignment(Qt::AlignCenter);
-	m_pTableWidget_RoiList->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
-	m_pTableWidget_RoiList->horizontalHeader()->setSectionResizeMode(QHeaderView::Fixed);
-	m_pTableWidget_RoiList->horizontalHeader()->setStretchLastSection(true);
-	m_pTableWidget_RoiList->setColumnWidth(0, 20);
-	m_pTableWidget_RoiList->setColumnWidth(1, 45);
-	m_pTableWidget_RoiList->setColumnWidth(2, 45);
-	m_pTableWidget_RoiList->setColumnWidth(3, 45);
-	m_pTableWidget_RoiList->setColumnWidth(4, 110);
+	m_pTableView_RoiList->setVerticalHeader(pVh);
+
+	m_pTableView_RoiList->setAlternatingRowColors(true);
+	m_pTableView_RoiList->setSelectionMode(QAbstractItemView::SingleSelection);
+	m_pTableView_RoiList->setEditTriggers(QAbstractItemView::NoEditTriggers);
+	m_pTableView_RoiList->setSelectionBehavior(QAbstractItemView::SelectRows);
+
+	m_pTableView_RoiList->setShowGrid(true);
+	m_pTableView_RoiList->setGridStyle(Qt::DotLine);
+	m_pTableView_RoiList->setSortingEnabled(true);
+	m_pTableView_RoiList->setCornerButtonEnabled(false);
+
+	m_pTableView_RoiList->verticalHeader()->setDefaultSectionSize(23);
+	m_pTableView_RoiList->verticalHeader()->setDefaultAlignment(Qt::AlignCenter);
+	m_pTableView_RoiList->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+	m_pTableView_RoiList->horizontalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+	m_pTableView_RoiList->horizontalHeader()->setStretchLastSection(true);
+	m_pTableView_RoiList->setColumnWidth(0, 20);
+	m_pTableView_RoiList->setColumnWidth(1, 45);
+	m_pTableView_RoiList->setColumnWidth(2, 45);
+	m_pTableView_RoiList->setColumnWidth(3, 45);
+	m_pTableView_RoiList->setColumnWidth(4, 110);
 
 	// Set layout	
 	pGridLayout_PulseView->addWidget(m_pScope_PulseView, 0, 0, 1, 4);
@@ -320,7 +326,7 @@ void PulseReviewTab::createPulseView()
 
 	pVBoxLayout_Roi->addItem(pHBoxLayout_RoiSelect);
 	pVBoxLayout_Roi->addItem(pHBoxLayout_Label);
-	pVBoxLayout_Roi->addWidget(m_pTableWidget_RoiList);
+	pVBoxLayout_Roi->addWidget(m_pTableView_RoiList);
 
 	m_pVBoxLayout->addItem(pGridLayout_PulseView);
 	m_pVBoxLayout->addWidget(m_pTableWidget_CurrentResult);
@@ -330,6 +336,11 @@ void PulseReviewTab::createPulseView()
 	connect(m_pCheckBox_ShowWindow, SIGNAL(toggled(bool)), this, SLOT(showWindow(bool)));
 	connect(m_pCheckBox_ShowMeanDelay, SIGNAL(toggled(bool)), this, SLOT(showMeanDelay(bool)));
 	connect(m_pSlider_CurrentAline, SIGNAL(valueChanged(int)), this, SLOT(drawPulse(int)));
+
+	m_pTimer_LongiUpdate = new QTimer(this);
+	m_pTimer_LongiUpdate->setSingleShot(true);
+	m_pTimer_LongiUpdate->setInterval(LONGI_UPDATE_INTERVAL);
+	connect(m_pTimer_LongiUpdate, SIGNAL(timeout()), this, SLOT(updateLongiImage()));
 	connect(m_pComboBox_PulseType, SIGNAL(currentIndexChanged(int)), this, SLOT(changePulseType()));
 	for (int i = 0; i < 3; i++)	
 		connect(m_pLineEdit_DelayTimeOffset[i], SIGNAL(editingFinished()), this, SLOT(restoreOffsetValues()));
@@ -340,7 +351,7 @@ void PulseReviewTab::createPulseView()
 	connect(m_pPushButton_Set, SIGNAL(clicked(bool)), this, SLOT(set()));
 	connect(m_pPushButton_Cancel, SIGNAL(clicked(bool)), this, SLOT(cancel()));
 	connect(m_pComboBox_PlaqueType, SIGNAL(currentIndexChanged(int)), this, SLOT(changePlaqueType(int)));
-	connect(m_pTableWidget_RoiList, SIGNAL(currentCellChanged(int, int, int, int)), this, SLOT(selectRow(int, int, int, int)));
+	connect(m_pTableView_RoiList->selectionModel(), SIGNAL(currentRowChanged(const QModelIndex &, const QModelIndex &)), this, SLOT(selectRow(const QModelIndex &, const QModelIndex &)));
 		
 	// Load roi data
 	loadRois();
@@ -517,28 +528,33 @@ void PulseReviewTab::drawPulse(int aline)
 	while (aline1 >= m_pConfigTemp->flimAlines)
 		aline1 -= m_pConfigTemp->flimAlines;
 
-	// Select pulse type		
-	np::FloatArray2 pulse;
+	// Pulses are not kept in the FLIm map cache, so a reopened pullback processes them per frame when first reviewed
+	if (!m_pConfigTemp->is_dotter && (m_pViewTab->m_vectorPulseCrop.at(frame).length() == 0))
+		m_pResultTab->getDataProcessing()->loadPulseReviewFrame(frame);
+
+	// Select pulse type (referenced, not copied)
+	np::FloatArray2* pPulse = nullptr;
 	switch (m_pComboBox_PulseType->currentIndex())
 	{
 	case cropped:
-		pulse = m_pViewTab->m_vectorPulseCrop.at(frame);
+		pPulse = &m_pViewTab->m_vectorPulseCrop.at(frame);
 		break;
 	case bg_subtracted:
-		pulse = m_pViewTab->m_vectorPulseBgSub.at(frame);
+		pPulse = &m_pViewTab->m_vectorPulseBgSub.at(frame);
 		break;
 	case masked:
-		pulse = m_pViewTab->m_vectorPulseMask.at(frame);
+		pPulse = &m_pViewTab->m_vectorPulseMask.at(frame);
 		break;
 	case spline_interpolated:
-		pulse = m_pViewTab->m_vectorPulseSpline.at(frame);
+		pPulse = &m_pViewTab->m_vectorPulseSpline.at(frame);
 		break;
 	case filtered:
-		pulse = m_pViewTab->m_vectorPulseFilter.at(frame);
+		pPulse = &m_pViewTab->m_vectorPulseFilter.at(frame);
 		break;
 	default:
-		break;
+		return;
 	}
+	np::FloatArray2& pulse = *pPulse;
 
 	// Reset pulse view scale
 	if (roi_width != pulse.size(0))
@@ -550,11 +566,11 @@ void PulseReviewTab::drawPulse(int aline)
 
 	// Data
 	//auto pulse_power = m_pViewTab->m_pulsepowerMap;
-	auto intensity = m_pViewTab->m_intensityMap;
-	auto mean_delay = m_pViewTab->m_meandelayMap;
-	auto lifetime = m_pViewTab->m_lifetimeMap;
-	auto int_prop = m_pViewTab->m_intensityProportionMap;
-	auto int_ratio = m_pViewTab->m_intensityRatioMap;
+	std::vector<np::FloatArray2>& intensity = m_pViewTab->m_intensityMap;
+	std::vector<np::FloatArray2>& mean_delay = m_pViewTab->m_meandelayMap;
+	std::vector<np::FloatArray2>& lifetime = m_pViewTab->m_lifetimeMap;
+	std::vector<np::FloatArray2>& int_prop = m_pViewTab->m_intensityProportionMap;
+	std::vector<np::FloatArray2>& int_ratio = m_pViewTab->m_intensityRatioMap;
 	
 	// Window
 	if (m_pCheckBox_ShowWindow->isChecked())
@@ -587,7 +603,10 @@ void PulseReviewTab::drawPulse(int aline)
 	m_pViewTab->getEnFaceImageView()->setHorizontalLine(1, aline);
 	m_pViewTab->getEnFaceImageView()->getRender()->update();
 
-	m_pViewTab->visualizeLongiImage(4 * aline);
+	// Longitudinal view: only when its A-line actually changes, at most once per refresh interval
+	m_nPendingLongiAline = 4 * aline;
+	if ((m_nPendingLongiAline != m_pViewTab->getLongiAline()) && !m_pTimer_LongiUpdate->isActive())
+		m_pTimer_LongiUpdate->start();
 
 	// Update current data 
 	if (m_pViewTab->getCircImageView()->getRender()->m_nClicked != 2)
@@ -741,6 +760,13 @@ void PulseReviewTab::drawPulse(int aline)
 	//m_pColorbar_FluLifetime->resetColormap(ColorTable::colortable(LIFETIME_COLORTABLE));
 }
 
+void PulseReviewTab::updateLongiImage()
+{
+	// Latest requested A-line only; intermediate hover positions are dropped
+	if (m_nPendingLongiAline != m_pViewTab->getLongiAline())
+		m_pViewTab->visualizeLongiImage(m_nPendingLongiAline);
+}
+
 void PulseReviewTab::changePulseType()
 {
 	drawPulse(m_pSlider_CurrentAline->value());
@@ -774,6 +800,9 @@ void PulseReviewTab::updateDelayOffset()
 		
 		m_pConfigTemp->flimDelayOffset[i] = delayOffset;			
 	}
+	// The compositions are predicted again from the edited maps, never served from the cache of the loaded ones
+	if (!m_pConfigTemp->is_dotter && m_pResultTab->getDataProcessing()->getFlimMapCache())
+		m_pResultTab->getDataProcessing()->getFlimMapCache()->setMapsModified();
 	m_pResultTab->getDataProcessing()->calculateFlimParameters();
 	m_pViewTab->invalidate();
 	if (!m_pConfigTemp->is_dotter)
@@ -798,7 +827,7 @@ void PulseReviewTab::addRoi(bool toggled)
 	m_pComboBox_PlaqueType->setEnabled(toggled);
 	m_pLabel_Comments->setEnabled(toggled);
 	m_pLineEdit_Comments->setEnabled(toggled);
-	m_pTableWidget_RoiList->setDisabled(toggled);
+	m_pTableView_RoiList->setDisabled(toggled);
 
 	if (!toggled)
 	{
@@ -824,13 +853,16 @@ void PulseReviewTab::modifyRoi(bool toggled)
 	m_pComboBox_PlaqueType->setEnabled(toggled);
 	m_pLabel_Comments->setEnabled(toggled);
 	m_pLineEdit_Comments->setEnabled(toggled);
-	m_pTableWidget_RoiList->setDisabled(toggled);
+	m_pTableView_RoiList->setDisabled(toggled);
 
 	if (toggled)
 	{
-		int row = m_pTableWidget_RoiList->currentRow();
-		m_pComboBox_PlaqueType->setCurrentIndex(m_vectorRois.at(row).at(4).toInt());
-		m_pLineEdit_Comments->setText(m_vectorRois.at(row).at(5));		
+		int row = getCurrentRoiRow();
+		if (row >= 0)
+		{
+			m_pComboBox_PlaqueType->setCurrentIndex(m_pRoiListModel->getRoi(row).type);
+			m_pLineEdit_Comments->setText(m_pRoiListModel->getRoi(row).comments);
+		}
 	}
 	else
 	{
@@ -844,23 +876,21 @@ void PulseReviewTab::deleteRoi()
 {
 	QImageView *pCircView = m_pResultTab->getViewTab()->getCircImageView();
 
-	int row = m_pTableWidget_RoiList->currentRow();
+	int row = getCurrentRoiRow();
 	
 	m_pToggleButton_ModifyRoi->setDisabled(true);
 	m_pPushButton_DeleteRoi->setDisabled(true);
 	m_pPushButton_Cancel->setDisabled(true);
 	
-	m_vectorRois.erase(m_vectorRois.begin() + row);
+	if (row >= 0)
+		m_pRoiListModel->deleteRoi(m_pRoiListModel->getRoi(row).roi_num);
 
-	m_pTableWidget_RoiList->removeRow(row);
-	m_pTableWidget_RoiList->clearSelection();
+	m_pTableView_RoiList->clearSelection();
 	
 	pCircView->getRender()->m_bArcRoiSelect = false;
 	pCircView->getRender()->m_bArcRoiShow = false;
 	pCircView->getRender()->m_nClicked = 0;
 	pCircView->getRender()->update();
-
-	saveRois();
 }
 
 void PulseReviewTab::set()
@@ -872,53 +902,22 @@ void PulseReviewTab::set()
 		if (pCircView->getRender()->m_nClicked != 2)
 			return;
 		
-		// Add roi vector
-		QStringList rois;
-		rois << QString::number(++m_totalRois) // 0: roi num
-			<< QString::number(m_pViewTab->getCurrentFrame() + 1) // 1: frame
-			<< QString::number(pCircView->getRender()->m_RLines[0]) // 2: start
-			<< QString::number(pCircView->getRender()->m_RLines[1]) // 3: end
-			<< QString::number(m_pComboBox_PlaqueType->currentIndex()) // 4: type
-			<< m_pLineEdit_Comments->text() // 5: comments
-			<< QString::number((int)pCircView->getRender()->m_bCW) // 6: cw or ccw?
-			<< QString::number(m_pConfigTemp->rotatedAlines) // 7: rotated alines
-			<< QString::number(m_pViewTab->m_vibCorrIdx(m_pViewTab->getCurrentFrame())); // 8: vib corr 
-		
-		m_vectorRois.push_back(rois);
-
-		// Add row to table widget
-		int rowCount = m_pTableWidget_RoiList->rowCount();
-		m_pTableWidget_RoiList->insertRow(rowCount);
-
-		QTableWidgetItem *pNumItem = new QTableWidgetItem;
-		QTableWidgetItem *pFrameItem = new QTableWidgetItem;
-		QTableWidgetItem *pStartItem = new QTableWidgetItem;
-		QTableWidgetItem *pEndItem = new QTableWidgetItem;
-		QTableWidgetItem *pTypeItem = new QTableWidgetItem;
-		QTableWidgetItem *pCommentsItem = new QTableWidgetItem;
-
-		pNumItem->setData(Qt::DisplayRole, rois.at(0).toInt());
-		pFrameItem->setData(Qt::DisplayRole, rois.at(1).toInt());
-		pStartItem->setData(Qt::DisplayRole, rois.at(2).toInt());
-		pEndItem->setData(Qt::DisplayRole, rois.at(3).toInt());
-		pEndItem->setToolTip(rois.at(6).toInt() == 1 ? "CW" : "CCW");
-		pTypeItem->setText(m_pComboBox_PlaqueType->itemText(rois.at(4).toInt()));
-		pTypeItem->setToolTip(rois.at(4));
-		pCommentsItem->setText(rois.at(5));
-				
-		pNumItem->setTextAlignment(Qt::AlignCenter);
-		pFrameItem->setTextAlignment(Qt::AlignCenter);
-		pStartItem->setTextAlignment(Qt::AlignCenter);
-		pEndItem->setTextAlignment(Qt::AlignCenter);
-		pTypeItem->setTextAlignment(Qt::AlignCenter);
-		pCommentsItem->setTextAlignment(Qt::AlignCenter);
-
-		m_pTableWidget_RoiList->setItem(rowCount, 0, pNumItem);
-		m_pTableWidget_RoiList->setItem(rowCount, 1, pFrameItem);
-		m_pTableWidget_RoiList->setItem(rowCount, 2, pStartItem);
-		m_pTableWidget_RoiList->setItem(rowCount, 3, pEndItem);
-		m_pTableWidget_RoiList->setItem(rowCount, 4, pTypeItem);
-		m_pTableWidget_RoiList->setItem(rowCount, 5, pCommentsItem);
+		// Add roi
+		ArcRoi roi;
+		roi.roi_num = m_pRoiListModel->takeRoiNum();
+		roi.frame = m_pViewTab->getCurrentFrame() + 1;
+		roi.start = pCircView->getRender()->m_RLines[0];
+		roi.end = pCircView->getRender()->m_RLines[1];
+		roi.type = m_pComboBox_PlaqueType->currentIndex();
+		roi.comments = m_pLineEdit_Comments->text();
+		roi.clockwise = pCircView->getRender()->m_bCW;
+		roi.rotated_alines = m_pConfigTemp->rotatedAlines;
+		roi.vib_corr = m_pViewTab->m_vibCorrIdx(m_pViewTab->getCurrentFrame());
+		roi.has_vib_corr = true;
+		roi.start_aligned = roi.start;
+		roi.end_aligned = roi.end;
+
+		m_pRoiListModel->addRoi(roi);
 
 		// Set widgets
 		m_pToggleButton_AddRoi->setChecked(false);
@@ -927,44 +926,33 @@ void PulseReviewTab::set()
 		
 		pCircView->getRender()->m_nClicked = 0;
 		pCircView->getRender()->update();
-		m_pTableWidget_RoiList->clearSelection();		
+		m_pTableView_RoiList->clearSelection();		
 	}
 	else if (m_pToggleButton_ModifyRoi->isChecked())
 	{
 		if (pCircView->getRender()->m_nClicked != 2)
 			return;
 
-		// Get row & roi_num
-		int rowCount = m_pTableWidget_RoiList->currentRow();
-		int roi_num = m_pTableWidget_RoiList->item(rowCount, 0)->text().toInt();
-		int i;
-		for (i = 0; i < m_vectorRois.size(); i++)
-			if (m_vectorRois.at(i).at(0).toInt() == roi_num)
-				break;
+		// Get roi
+		int row = getCurrentRoiRow();
+		if (row < 0)
+			return;
 
 		// Modify roi data
-		QStringList rois_new;
-		rois_new << QString::number(roi_num) // 0: roi num
-			<< QString::number(m_pViewTab->getCurrentFrame() + 1) // 1: frame
-			<< QString::number(pCircView->getRender()->m_RLines[0]) // 2: start
-			<< QString::number(pCircView->getRender()->m_RLines[1]) // 3: end
-			<< QString::number(m_pComboBox_PlaqueType->currentIndex()) // 4: type
-			<< m_pLineEdit_Comments->text() // 5: comments
-			<< QString::number((int)pCircView->getRender()->m_bCW) // 6: cw or ccw?
-			<< QString::number(m_pConfigTemp->rotatedAlines) // 7: rotated alines
-			<< QString::number(m_pViewTab->m_vibCorrIdx(m_pViewTab->getCurrentFrame())); // 8: vib corr 
-
-		m_vectorRois.at(i) = rois_new;
-
-		// Modify row of table widget
-		m_pTableWidget_RoiList->item(rowCount, 0)->setData(Qt::DisplayRole, rois_new.at(0).toInt());
-		m_pTableWidget_RoiList->item(rowCount, 1)->setData(Qt::DisplayRole, rois_new.at(1).toInt());
-		m_pTableWidget_RoiList->item(rowCount, 2)->setData(Qt::DisplayRole, rois_new.at(2).toInt());
-		m_pTableWidget_RoiList->item(rowCount, 3)->setData(Qt::DisplayRole, rois_new.at(3).toInt());
-		m_pTableWidget_RoiList->item(rowCount, 3)->setToolTip(rois_new.at(6).toInt() == 1 ? "CW" : "CCW");
-		m_pTableWidget_RoiList->item(rowCount, 4)->setText(m_pComboBox_PlaqueType->itemText(rois_new.at(4).toInt()));
-		m_pTableWidget_RoiList->item(rowCount, 4)->setToolTip(rois_new.at(4));
-		m_pTableWidget_RoiList->item(rowCount, 5)->setText(rois_new.at(5));
+		ArcRoi roi = m_pRoiListModel->getRoi(row);
+		roi.frame = m_pViewTab->getCurrentFrame() + 1;
+		roi.start = pCircView->getRender()->m_RLines[0];
+		roi.end = pCircView->getRender()->m_RLines[1];
+		roi.type = m_pComboBox_PlaqueType->currentIndex();
+		roi.comments = m_pLineEdit_Comments->text();
+		roi.clockwise = pCircView->getRender()->m_bCW;
+		roi.rotated_alines = m_pConfigTemp->rotatedAlines;
+		roi.vib_corr = m_pViewTab->m_vibCorrIdx(m_pViewTab->getCurrentFrame());
+		roi.has_vib_corr = true;
+		roi.start_aligned = roi.start;
+		roi.end_aligned = roi.end;
+
+		m_pRoiListModel->modifyRoi(roi);
 
 		// Set widgets
 		m_pToggleButton_ModifyRoi->setChecked(false);
@@ -974,8 +962,6 @@ void PulseReviewTab::set()
 		pCircView->getRender()->m_nClicked = 0;
 		pCircView->getRender()->update();
 	}
-
-	saveRois();
 }
 
 void PulseReviewTab::cancel()
@@ -985,8 +971,8 @@ void PulseReviewTab::cancel()
 	if (m_pToggleButton_AddRoi->isChecked())
 	{
 		m_pToggleButton_AddRoi->setChecked(false);
-		m_pTableWidget_RoiList->clearSelection();
-		m_pTableWidget_RoiList->clearFocus();
+		m_pTableView_RoiList->clearSelection();
+		m_pTableView_RoiList->clearFocus();
 	}
 	else if (m_pToggleButton_ModifyRoi->isChecked())
 	{
@@ -999,8 +985,8 @@ void PulseReviewTab::cancel()
 		m_pToggleButton_ModifyRoi->setDisabled(true);
 		m_pPushButton_DeleteRoi->setDisabled(true);
 		m_pPushButton_Cancel->setDisabled(true);
-		m_pTableWidget_RoiList->clearSelection();
-		m_pTableWidget_RoiList->clearFocus();
+		m_pTableView_RoiList->clearSelection();
+		m_pTableView_RoiList->clearFocus();
 	}
 
 	m_pLineEdit_Comments->setText("");
@@ -1015,9 +1001,9 @@ void PulseReviewTab::changePlaqueType(int type)
 	pCircView->getRender()->update();
 }
 
-void PulseReviewTab::selectRow(int row, int, int row0, int)
+void PulseReviewTab::selectRow(const QModelIndex & current, const QModelIndex & previous)
 {
-	if (row0 == -1)
+	if (!previous.isValid() || !current.isValid())
 		return;
 
 	QImageView *pCircView = m_pResultTab->getViewTab()->getCircImageView();
@@ -1033,15 +1019,17 @@ void PulseReviewTab::selectRow(int row, int, int row0, int)
 	int delay_frame = delay / m_pConfigTemp->octAlines;
 	///int delay_aline = (delay % m_pConfigTemp->octAlines) / 4;
 
-	int frame0 = m_pTableWidget_RoiList->item(row, 1)->data(Qt::EditRole).toInt() - 1;
+	const ArcRoi& roi = m_pRoiListModel->getRoi(m_pRoiSortModel->mapToSource(current).row());
+
+	int frame0 = roi.frame - 1;
 	int frame = frame0 - delay_frame;
 	frame = (frame < 0) ? 0 : frame;
 	frame = (frame >= m_pConfigTemp->frames) ? m_pConfigTemp->frames - 1 : frame;
 
-	int start = m_pTableWidget_RoiList->item(row, 2)->data(Qt::EditRole).toInt();
-	int end = m_pTableWidget_RoiList->item(row, 3)->data(Qt::EditRole).toInt();
-	bool cw = m_pTableWidget_RoiList->item(row, 3)->toolTip() == "CW";
-	int type = m_pTableWidget_RoiList->item(row, 4)->toolTip().toInt();
+	int start = roi.start_aligned;
+	int end = roi.end_aligned;
+	bool cw = roi.clockwise;
+	int type = roi.type;
 
 	m_bFromTable = true;
 	m_pResultTab->getViewTab()->setCurrentFrame(frame0);
@@ -1173,156 +1161,48 @@ void PulseReviewTab::selectRow(int row, int, int row0, int)
 	}
 }
 
-void PulseReviewTab::saveRois()
-{
-	if (m_vectorRois.size() > 0)
-	{
-		QString roi_path = m_pResultTab->getRecordInfo().filename;
-		if (!m_pConfigTemp->is_dotter)
-			roi_path.replace("pullback.data", "roi.csv");
-		else
-			roi_path.replace(".xml", "/roi.csv");
-
-		QFile roi_file(roi_path);
-		if (roi_file.open(QFile::WriteOnly))
-		{
-			QTextStream stream(&roi_file);
-			stream << "#" << "\t"
-				<< "Frame" << "\t"
-				<< "Start" << "\t"
-				<< "End" << "\t"
-				<< "Type" << "\t"
-				<< "Comments" << "\t"
-				<< "Clockwise" << "\t"
-				<< "Rotated" << "\t"
-				<< "Vib Corr" << "\n";
-
-			for (int i = 0; i < m_vectorRois.size(); i++)
-			{
-				QStringList rois = m_vectorRois.at(i);
-
-				stream << rois.at(0) << "\t" // #
-					<< rois.at(1) << "\t" // Frame
-					<< rois.at(2) << "\t" // Start
-					<< rois.at(3) << "\t" // End
-					<< rois.at(4) << "\t" // Type
-					<< rois.at(5) << "\t" // Comments
-					<< rois.at(6) << "\t" // CW or CCW
-					<< rois.at(7) << "\t" // Rotated allines
-					//<< m_pViewTab->m_vibCorrIdx(rois.at(1).toInt() - 1) << "\n"; // Vib corr
-					<< rois.at(8) << "\n"; // Vib corr
-			}
-			stream << m_totalRois << "\n";
-
-			roi_file.close();
-		}
-	}
-}
-
 void PulseReviewTab::loadRois()
 {
-	disconnect(m_pTableWidget_RoiList, SIGNAL(currentCellChanged(int, int, int, int)), 0, 0);
-
-	int currentRow = m_pTableWidget_RoiList->currentRow();
-
-	m_vectorRois.clear();
-	m_pTableWidget_RoiList->clearContents();
-	m_pTableWidget_RoiList->setRowCount(0);
-	
 	QString roi_path = m_pResultTab->getRecordInfo().filename;
 	if (!m_pConfigTemp->is_dotter)
 		roi_path.replace("pullback.data", "roi.csv");
 	else
 		roi_path.replace(".xml", "/roi.csv");
 
-	//if (roi_path.split(".").at(1) != "csv")
-	//	return;
+	m_pRoiListModel->load(roi_path);
+	alignRois();
 
-	QFile roi_file(roi_path);
-	if (roi_file.open(QFile::ReadOnly))
-	{
-		QTextStream stream(&roi_file);
+	QImageView *pCircView = m_pResultTab->getViewTab()->getCircImageView();
+	pCircView->getRender()->m_nClicked = 0;
+	pCircView->getRender()->update();
+}
 
-		stream.readLine();
-		while (!stream.atEnd())
-		{
-			QStringList rois = stream.readLine().split('\t');
-			m_vectorRois.push_back(rois);
-		}
-		roi_file.close();
+void PulseReviewTab::alignRois()
+{
+	// Only the displayed start & end follow rotation and vibration correction, the file is not touched
+	m_pRoiListModel->alignRois([&](ArcRoi& roi) { alignRoi(roi); });
+}
 
-		QStringList rois = m_vectorRois.at(m_vectorRois.size() - 1);
-		m_totalRois = rois.at(0).toInt();
-		m_vectorRois.pop_back();
-		
-		for (int i = 0; i < m_vectorRois.size(); i++)
-		{
-			m_pTableWidget_RoiList->insertRow(i);
-
-			QTableWidgetItem *pNumItem = new QTableWidgetItem;
-			QTableWidgetItem *pFrameItem = new QTableWidgetItem;
-			QTableWidgetItem *pStartItem = new QTableWidgetItem;
-			QTableWidgetItem *pEndItem = new QTableWidgetItem;
-			QTableWidgetItem *pTypeItem = new QTableWidgetItem;
-			QTableWidgetItem *pCommentsItem = new QTableWidgetItem;
-
-			QStringList rois = m_vectorRois.at(i);
-
-			int roi_num = rois.at(0).toInt();
-			int frame = rois.at(1).toInt();
-			int start = rois.at(2).toInt();
-			int end = rois.at(3).toInt();
-			QString type = m_pComboBox_PlaqueType->itemText(rois.at(4).toInt());
-			QString comments = rois.at(5);
-			bool clockwise = rois.at(6).toInt() == 1;
-			int rotated_alines0 = rois.at(7).toInt();
-			int rotated_alines = m_pConfigTemp->rotatedAlines;
-			int vib_corr0 = 0, vib_corr = 0;
-			if (rois.size() > 8)
-			{
-				vib_corr0 = rois.at(8).toInt();
-				vib_corr = m_pViewTab->m_vibCorrIdx(frame - 1);
-			}
+int PulseReviewTab::getCurrentRoiRow() const
+{
+	QModelIndex index = m_pTableView_RoiList->currentIndex();
+	if (!index.isValid())
+		return -1;
 
-			start = start + rotated_alines0 - rotated_alines + vib_corr0 - vib_corr;
-			end = end + rotated_alines0 - rotated_alines + vib_corr0 - vib_corr;
-
-			if (start < 0) start += m_pConfigTemp->octAlines;
-			if (end < 0) end += m_pConfigTemp->octAlines;
-
-			start = start % m_pConfigTemp->octAlines;
-			end = end % m_pConfigTemp->octAlines;
-
-			pNumItem->setData(Qt::DisplayRole, roi_num);
-			pFrameItem->setData(Qt::DisplayRole, frame);
-			pStartItem->setData(Qt::DisplayRole, start);
-			pEndItem->setData(Qt::DisplayRole, end);
-			pEndItem->setToolTip(clockwise ? "CW" : "CCW");
-			pTypeItem->setText(type);
-			pTypeItem->setToolTip(rois.at(4));
-			pCommentsItem->setText(comments);
-
-			pNumItem->setTextAlignment(Qt::AlignCenter);
-			pFrameItem->setTextAlignment(Qt::AlignCenter);
-			pStartItem->setTextAlignment(Qt::AlignCenter);
-			pEndItem->setTextAlignment(Qt::AlignCenter);
-			pTypeItem->setTextAlignment(Qt::AlignCenter);
-			pCommentsItem->setTextAlignment(Qt::AlignCenter);
-
-			m_pTableWidget_RoiList->setItem(i, 0, pNumItem);
-			m_pTableWidget_RoiList->setItem(i, 1, pFrameItem);
-			m_pTableWidget_RoiList->setItem(i, 2, pStartItem);
-			m_pTableWidget_RoiList->setItem(i, 3, pEndItem);
-			m_pTableWidget_RoiList->setItem(i, 4, pTypeItem);
-			m_pTableWidget_RoiList->setItem(i, 5, pCommentsItem);
-		}	
-
-		QImageView *pCircView = m_pResultTab->getViewTab()->getCircImageView();
-		pCircView->getRender()->m_nClicked = 0;
-		pCircView->getRender()->update();
-	}
+	return m_pRoiSortModel->mapToSource(index).row();
+}
 
-	connect(m_pTableWidget_RoiList, SIGNAL(currentCellChanged(int, int, int, int)), this, SLOT(selectRow(int, int, int, int)));
+void PulseReviewTab::alignRoi(ArcRoi& roi)
+{
+	int rotated_alines = m_pConfigTemp->rotatedAlines;
+	int vib_corr = roi.has_vib_corr ? m_pViewTab->m_vibCorrIdx(roi.frame - 1) : 0;
 
-	if (currentRow >= 0) m_pTableWidget_RoiList->selectRow(currentRow);
-}
\ No newline at end of file
+	int start = roi.start + roi.rotated_alines - rotated_alines + roi.vib_corr - vib_corr;
+	int end = roi.end + roi.rotated_alines - rotated_alines + roi.vib_corr - vib_corr;
+
+	if (start < 0) start += m_pConfigTemp->octAlines;
+	if (end < 0) end += m_pConfigTemp->octAlines;
+
+	roi.start_aligned = start % m_pConfigTemp->octAlines;
+	roi.end_aligned = end % m_pConfigTemp->octAlines;
+}
@@ -6,6 +6,7 @@
 
 #include <Havana3/Viewer/QScope.h>
 #include <Havana3/Dialog/FlimCalibTab.h>
+#include <Havana3/Dialog/RoiListModel.h>
 
 #include <iostream>
 #include <vector>
@@ -47,12 +48,19 @@ public slots :
 	void deleteRoi();
 	void set();
 	void cancel();
-	void selectRow(int, int, int, int);
+	void selectRow(const QModelIndex &, const QModelIndex &);
 	void changePlaqueType(int);
 
+private slots:
+	void updateLongiImage();
+
 public:
-	void saveRois();
 	void loadRois();
+	void alignRois();
+
+private:
+	int getCurrentRoiRow() const;
+	void alignRoi(ArcRoi& roi);
 
 // Variables ////////////////////////////////////////////
 private:	
@@ -64,10 +72,13 @@ private:
 
 public:
 	int m_start, m_end;
-	std::vector<QStringList> m_vectorRois;
-	int m_totalRois;
 	bool m_bFromTable;
 
+private:
+	// Longitudinal view updates are coalesced and throttled to the display refresh
+	QTimer *m_pTimer_LongiUpdate;
+	int m_nPendingLongiAline;
+
 private:
 	Histogram* m_pHistogramIntensity;
 	Histogram* m_pHistogramLifetime;
@@ -108,7 +119,9 @@ private:
 	QLabel *m_pLabel_Comments;
 	QLineEdit *m_pLineEdit_Comments;
 
-	QTableWidget *m_pTableWidget_RoiList;
+	RoiListModel *m_pRoiListModel;
+	QSortFilterProxyModel *m_pRoiSortModel;
+	QTableView *m_pTableView_RoiList;
 
 	// Histogram widgets
 	QLabel *m_pLabel_FluIntensity;
@@ -0,0 +1,319 @@
+#include "RoiListModel.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QTextStream>
+
+
+QString ArcRoi::toString() const
+{
+	return QString("%1\t%2\t%3\t%4\t%5\t%6\t%7\t%8\t%9")
+		.arg(roi_num) // #
+		.arg(frame) // Frame
+		.arg(start) // Start
+		.arg(end) // End
+		.arg(type) // Type
+		.arg(comments) // Comments
+		.arg((int)clockwise) // CW or CCW
+		.arg(rotated_alines) // Rotated alines
+		.arg(vib_corr); // Vib corr
+}
+
+bool ArcRoi::fromString(const QString & line)
+{
+	QStringList rois = line.split('\t');
+	if (rois.size() < 8)
+		return false;
+
+	roi_num = rois.at(0).toInt();
+	frame = rois.at(1).toInt();
+	start = rois.at(2).toInt();
+	end = rois.at(3).toInt();
+	type = rois.at(4).toInt();
+	comments = rois.at(5);
+	clockwise = rois.at(6).toInt() == 1;
+	rotated_alines = rois.at(7).toInt();
+	has_vib_corr = rois.size() > 8;
+	vib_corr = has_vib_corr ? rois.at(8).toInt() : 0;
+	start_aligned = start;
+	end_aligned = end;
+
+	return true;
+}
+
+
+RoiListModel::RoiListModel(QObject *parent) :
+	QAbstractTableModel(parent), m_nTotalRois(0), m_nJournalEntries(0)
+{
+}
+
+RoiListModel::~RoiListModel()
+{
+	// roi.csv is what the other tools read: the edits of the session are folded in when the review closes
+	if (m_nJournalEntries > 0)
+		compact();
+}
+
+
+int RoiListModel::rowCount(const QModelIndex & parent) const
+{
+	return parent.isValid() ? 0 : (int)m_vectorRois.size();
+}
+
+int RoiListModel::columnCount(const QModelIndex & parent) const
+{
+	return parent.isValid() ? 0 : RoiColumnCount;
+}
+
+QVariant RoiListModel::data(const QModelIndex & index, int role) const
+{
+	if (!index.isValid() || (index.row() >= (int)m_vectorRois.size()))
+		return QVariant();
+
+	const ArcRoi& roi = m_vectorRois.at(index.row());
+
+	if (role == Qt::DisplayRole)
+	{
+		switch (index.column())
+		{
+		case NumColumn: return roi.roi_num;
+		case FrameColumn: return roi.frame;
+		case StartColumn: return roi.start_aligned;
+		case EndColumn: return roi.end_aligned;
+		case TypeColumn: return (roi.type < m_listTypeNames.size()) ? m_listTypeNames.at(roi.type) : QString::number(roi.type);
+		case CommentsColumn: return roi.comments;
+		}
+	}
+	else if (role == Qt::ToolTipRole)
+	{
+		if (index.column() == EndColumn)
+			return roi.clockwise ? "CW" : "CCW";
+		else if (index.column() == TypeColumn)
+			return QString::number(roi.type);
+	}
+	else if (role == Qt::TextAlignmentRole)
+		return Qt::AlignCenter;
+
+	return QVariant();
+}
+
+QVariant RoiListModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+	if ((role != Qt::DisplayRole) || (orientation != Qt::Horizontal))
+		return QVariant();
+
+	switch (section)
+	{
+	case NumColumn: return "#";
+	case FrameColumn: return "Frame";
+	case StartColumn: return "Start";
+	case EndColumn: return "End";
+	case TypeColumn: return "Type";
+	case CommentsColumn: return "Comments";
+	}
+
+	return QVariant();
+}
+
+
+bool RoiListModel::load(const QString & roi_path)
+{
+	beginResetModel();
+
+	m_roiPath = roi_path;
+	m_vectorRois.clear();
+	m_hashRows.clear();
+	m_nTotalRois = 0;
+	m_nJournalEntries = 0;
+
+	// Snapshot: header, one roi per line, and the total roi count at the end
+	QFile roi_file(m_roiPath);
+	if (roi_file.open(QFile::ReadOnly))
+	{
+		QTextStream stream(&roi_file);
+
+		stream.readLine();
+		while (!stream.atEnd())
+		{
+			QString line = stream.readLine();
+			ArcRoi roi;
+			if (roi.fromString(line))
+				upsert(roi);
+			else if (!line.isEmpty())
+				m_nTotalRois = qMax(m_nTotalRois, line.section('\t', 0, 0).toInt());
+		}
+		roi_file.close();
+	}
+
+	// Journal: edits made after the snapshot, replayed in order (replaying twice is harmless)
+	QFile journal_file(m_roiPath + ".journal");
+	if (journal_file.open(QFile::ReadOnly))
+	{
+		QTextStream stream(&journal_file);
+
+		while (!stream.atEnd())
+		{
+			QString line = stream.readLine();
+			if (line.startsWith("+\t"))
+			{
+				ArcRoi roi;
+				if (roi.fromString(line.mid(2)))
+					upsert(roi);
+			}
+			else if (line.startsWith("-\t"))
+				remove(line.mid(2).toInt(), false);
+			else
+				continue;
+
+			m_nJournalEntries++;
+		}
+		journal_file.close();
+	}
+
+	for (const ArcRoi& roi : m_vectorRois)
+		m_nTotalRois = qMax(m_nTotalRois, roi.roi_num);
+
+	endResetModel();
+
+	// Fold the journal of the previous session into the snapshot
+	if (m_nJournalEntries > 0)
+		return compact();
+
+	return true;
+}
+
+bool RoiListModel::addRoi(const ArcRoi & roi)
+{
+	m_nTotalRois = qMax(m_nTotalRois, roi.roi_num);
+
+	int row = (int)m_vectorRois.size();
+	beginInsertRows(QModelIndex(), row, row);
+	m_vectorRois.push_back(roi);
+	m_hashRows.insert(roi.roi_num, row);
+	endInsertRows();
+
+	return appendJournal("+\t" + roi.toString());
+}
+
+bool RoiListModel::modifyRoi(const ArcRoi & roi)
+{
+	int row = findRoi(roi.roi_num);
+	if (row < 0)
+		return false;
+
+	m_vectorRois.at(row) = roi;
+	emit dataChanged(index(row, 0), index(row, RoiColumnCount - 1));
+
+	return appendJournal("+\t" + roi.toString());
+}
+
+bool RoiListModel::deleteRoi(int roi_num)
+{
+	if (findRoi(roi_num) < 0)
+		return false;
+
+	remove(roi_num, true);
+
+	return appendJournal("-\t" + QString::number(roi_num));
+}
+
+bool RoiListModel::compact()
+{
+	if (m_roiPath.isEmpty())
+		return false;
+
+	if (m_vectorRois.empty() && !QFile::exists(m_roiPath))
+	{
+		QFile::remove(m_roiPath + ".journal");
+		m_nJournalEntries = 0;
+		return true;
+	}
+
+	QSaveFile roi_file(m_roiPath);
+	if (!roi_file.open(QFile::WriteOnly))
+		return false;
+
+	QTextStream stream(&roi_file);
+	stream << "#" << "\t"
+		<< "Frame" << "\t"
+		<< "Start" << "\t"
+		<< "End" << "\t"
+		<< "Type" << "\t"
+		<< "Comments" << "\t"
+		<< "Clockwise" << "\t"
+		<< "Rotated" << "\t"
+		<< "Vib Corr" << "\n";
+	for (const ArcRoi& roi : m_vectorRois)
+		stream << roi.toString() << "\n";
+	stream << m_nTotalRois << "\n";
+	stream.flush();
+
+	if (!roi_file.commit())
+		return false;
+
+	// The snapshot is in place before the journal goes away
+	QFile::remove(m_roiPath + ".journal");
+	m_nJournalEntries = 0;
+
+	return true;
+}
+
+void RoiListModel::alignRois(const std::function<void(ArcRoi&)> & align)
+{
+	if (m_vectorRois.empty())
+		return;
+
+	for (ArcRoi& roi : m_vectorRois)
+		align(roi);
+
+	emit dataChanged(index(0, StartColumn), index((int)m_vectorRois.size() - 1, EndColumn));
+}
+
+
+void RoiListModel::upsert(const ArcRoi & roi)
+{
+	int row = findRoi(roi.roi_num);
+	if (row < 0)
+	{
+		m_hashRows.insert(roi.roi_num, (int)m_vectorRois.size());
+		m_vectorRois.push_back(roi);
+	}
+	else
+		m_vectorRois.at(row) = roi;
+}
+
+void RoiListModel::remove(int roi_num, bool notify)
+{
+	int row = findRoi(roi_num);
+	if (row < 0)
+		return;
+
+	// Erase in place so that the row order (and that of the snapshot) is kept
+	if (notify) beginRemoveRows(QModelIndex(), row, row);
+	m_vectorRois.erase(m_vectorRois.begin() + row);
+	m_hashRows.remove(roi_num);
+	for (int i = row; i < (int)m_vectorRois.size(); i++)
+		m_hashRows.insert(m_vectorRois.at(i).roi_num, i);
+	if (notify) endRemoveRows();
+}
+
+bool RoiListModel::appendJournal(const QString & entry)
+{
+	if (m_roiPath.isEmpty())
+		return false;
+
+	QFile journal_file(m_roiPath + ".journal");
+	if (!journal_file.open(QFile::WriteOnly | QFile::Append))
+		return false;
+
+	QTextStream stream(&journal_file);
+	stream << entry << "\n";
+	stream.flush();
+	journal_file.close();
+
+	// The snapshot is also what marks a record as labeled, so it is created with the first roi
+	if ((++m_nJournalEntries >= ROI_JOURNAL_COMPACT_SIZE) || !QFile::exists(m_roiPath))
+		return compact();
+
+	return true;
+}
@@ -0,0 +1,89 @@
+#ifndef ROILISTMODEL_H
+#define ROILISTMODEL_H
+
+#include <QAbstractTableModel>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+
+#include <iostream>
+#include <vector>
+#include <functional>
+
+#include <Havana3/Configuration.h>
+
+
+struct ArcRoi
+{
+	int roi_num = 0;
+	int frame = 0; // 1-based
+	int start = 0; // as labeled (rotated_alines & vib_corr of the labeling time)
+	int end = 0;
+	int type = 0;
+	QString comments;
+	bool clockwise = false;
+	int rotated_alines = 0;
+	int vib_corr = 0;
+	bool has_vib_corr = false; // old roi.csv files have no vib corr column
+
+	// start & end re-aligned to the current rotation and vibration correction (not saved)
+	int start_aligned = 0;
+	int end_aligned = 0;
+
+	QString toString() const;
+	bool fromString(const QString & line);
+};
+
+class RoiListModel : public QAbstractTableModel
+{
+	Q_OBJECT
+
+public:
+	enum RoiColumn { NumColumn = 0, FrameColumn, StartColumn, EndColumn, TypeColumn, CommentsColumn, RoiColumnCount };
+
+// Constructer & Destructer /////////////////////////////
+public:
+	explicit RoiListModel(QObject *parent = nullptr);
+	virtual ~RoiListModel();
+
+// Methods //////////////////////////////////////////////
+public:
+	int rowCount(const QModelIndex & parent = QModelIndex()) const override;
+	int columnCount(const QModelIndex & parent = QModelIndex()) const override;
+	QVariant data(const QModelIndex & index, int role = Qt::DisplayRole) const override;
+	QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+public:
+	inline void setTypeNames(const QStringList & names) { m_listTypeNames = names; }
+	inline int getRoiCount() const { return (int)m_vectorRois.size(); }
+	inline const ArcRoi& getRoi(int row) const { return m_vectorRois.at(row); }
+	inline int findRoi(int roi_num) const { return m_hashRows.value(roi_num, -1); }
+	inline int takeRoiNum() { return ++m_nTotalRois; }
+
+	// roi.csv is the compacted snapshot, every edit after it is appended to roi.csv.journal
+	bool load(const QString & roi_path);
+	bool addRoi(const ArcRoi & roi);
+	bool modifyRoi(const ArcRoi & roi);
+	bool deleteRoi(int roi_num);
+	bool compact();
+
+	// Re-evaluates the displayed start & end of every ROI (e.g. after rotation)
+	void alignRois(const std::function<void(ArcRoi&)> & align);
+
+private:
+	void upsert(const ArcRoi & roi);
+	void remove(int roi_num, bool notify);
+	bool appendJournal(const QString & entry);
+
+// Variables ////////////////////////////////////////////
+private:
+	QString m_roiPath;
+	QStringList m_listTypeNames;
+
+	std::vector<ArcRoi> m_vectorRois;
+	QHash<int, int> m_hashRows; // roi_num -> row
+	int m_nTotalRois;
+	int m_nJournalEntries;
+};
+
+#endif // ROILISTMODEL_H
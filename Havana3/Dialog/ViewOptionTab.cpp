@@ -1216,7 +1216,7 @@ void ViewOptionTab::rotateImage(int shift)
 
 	if (m_pViewTab) m_pViewTab->invalidate();
 	if (m_pResultTab->getSettingDlg()->getPulseReviewTab())
-		m_pResultTab->getSettingDlg()->getPulseReviewTab()->loadRois();
+		m_pResultTab->getSettingDlg()->getPulseReviewTab()->alignRois();
 
 	m_pConfig->writeToLog(QString("Rotated alines set: %1").arg(shift));
 }
@@ -1,14 +1,58 @@
 
 #include "MainWindow.h"
 #include <QApplication>
+#include <QCommandLineParser>
+
+#include <DataAcquisition/BatchProcessing.h>
 
 #ifdef _DEBUG
 //#include <vld.h>
 #endif
 
 
+// Havana3 --batch [--threads n] [--memory MB] [--force] <records...>: review outputs cached beside each record, no window
+static int runBatch(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Batch reprocessing: FLIm maps, vibration correction, lumen contours and composition maps for instant review.");
+    parser.addHelpOption();
+    QCommandLineOption batchOption("batch", "Batch reprocessing mode.");
+    QCommandLineOption threadsOption("threads", "Thread budget shared by all records (default: all hardware threads).", "n", QString::number(BATCH_THREAD_BUDGET));
+    QCommandLineOption memoryOption("memory", "Memory budget of the records in flight.", "MB", QString::number(BATCH_MEMORY_BUDGET));
+    parser.addOption(batchOption);
+    parser.addOption(threadsOption);
+    parser.addOption(memoryOption);
+    QCommandLineOption forceOption("force", "Recompute and overwrite the outputs already cached beside the records.");
+    parser.addOption(forceOption);
+    parser.addPositionalArgument("records", "Record folders, pullback.data files, or text files listing them one per line.", "<records...>");
+    parser.process(a);
+
+    // Workstation settings (prediction mode, auto vibration correction) as the review would use them
+    Configuration config;
+    config.getConfigFile("Havana3.ini");
+
+    BatchProcessing batch(&config);
+    batch.setThreadBudget(parser.value(threadsOption).toInt());
+    batch.setMemoryBudget(parser.value(memoryOption).toLongLong() * 1048576);
+    batch.setForce(parser.isSet(forceOption));
+    batch.SendStatusMessage += [&](const char* msg, bool is_error) {
+        QString qmsg = QDateTime::currentDateTime().toString("[yyyy-MM-dd hh:mm:ss] ") + QString::fromUtf8(msg);
+        fprintf(is_error ? stderr : stdout, "%s\n", qmsg.toLocal8Bit().constData());
+        fflush(is_error ? stderr : stdout);
+    };
+
+    return batch.run(parser.positionalArguments()) ? 0 : 1;
+}
+
+
 int main(int argc, char *argv[])
 {
+    for (int i = 1; i < argc; i++)
+        if (!strcmp(argv[i], "--batch"))
+            return runBatch(argc, argv);
+
     QApplication a(argc, argv);
 
     qApp->setStyle(QStyleFactory::create("Fusion"));
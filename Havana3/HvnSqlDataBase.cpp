@@ -5,10 +5,12 @@
 
 #include <QSqlQuery>
 #include <QSqlError>
+#include <QThread>
+#include <QBuffer>
 
 
 HvnSqlDataBase::HvnSqlDataBase(QObject *parent) :
-    QObject(parent)
+    QObject(parent), m_nConnectionGeneration(0), m_cachePreview(PREVIEW_CACHE_SIZE)
 {
     // Set configuration objects
 	m_pMainWnd = dynamic_cast<MainWindow*>(parent);
@@ -24,6 +26,27 @@ HvnSqlDataBase::HvnSqlDataBase(QObject *parent) :
 
 HvnSqlDataBase::~HvnSqlDataBase()
 {
+	if (m_threadPreview.joinable())
+	{
+		m_queuePreview.push("");
+		m_threadPreview.join();
+	}
+
+	m_mainConnection.statements.clear();
+}
+
+
+HvnSqlConnection::~HvnSqlConnection()
+{
+	// Worker thread clones are removed from the registry when their thread exits
+	if (name != "")
+	{
+		statements.clear();
+		if (db.isOpen())
+			db.close();
+		db = QSqlDatabase();
+		QSqlDatabase::removeDatabase(name);
+	}
 }
 
 
@@ -39,16 +62,7 @@ bool HvnSqlDataBase::openDatabase(const QString& username, const QString& passwo
 
 			qDebug() << QSqlDatabase::drivers();
 
-#ifdef ENABLE_DATABASE_ENCRYPTION
-			m_sqlDataBase = QSqlDatabase::addDatabase("SQLITECIPHER", "DBConnection");
-			m_sqlDataBase.setDatabaseName(m_pConfig->dbPath + "/db.sqlite");		
-			m_sqlDataBase.setUserName(username);
-			m_sqlDataBase.setPassword(password);
-			m_sqlDataBase.setConnectOptions("QSQLITE_USE_CIPHER=sqlcipher");
-#else
-			m_sqlDataBase = QSqlDatabase::addDatabase("QSQLITE", "DBConnection");
-			m_sqlDataBase.setDatabaseName(m_pConfig->dbPath + "/db.sqlite");
-#endif
+			m_sqlDataBase = addConnection("DBConnection", username, password);
 			if (!m_sqlDataBase.open())
 			{
 				QString msg = "Failed to open: " + m_sqlDataBase.lastError().text();
@@ -64,8 +78,14 @@ bool HvnSqlDataBase::openDatabase(const QString& username, const QString& passwo
 			}
 			else
 			{
+				// The connection stays open for the whole session, so the (SQLCipher) key derivation is paid only once.
+				setConnectionPragmas(m_sqlDataBase);
+				m_mainConnection.db = m_sqlDataBase;
+				m_mainConnection.generation = ++m_nConnectionGeneration;
+
 				m_pConfig->writeToLog(QString("Database opened: %1").arg(db_fullpath));
 				if (init_req) initializeDatabase();
+				migrateDatabase();
 
 				m_username = username;
 				m_password = password;
@@ -79,14 +99,29 @@ bool HvnSqlDataBase::openDatabase(const QString& username, const QString& passwo
 
 void HvnSqlDataBase::closeDatabase()
 {
+	// Invalidate worker thread clones; they are reopened on their next query
+	m_nConnectionGeneration++;
+	m_mainConnection.statements.clear();
+	m_mainConnection.db = QSqlDatabase();
+	{
+		std::unique_lock<std::mutex> lock(m_mtxPreview);
+		m_cachePreview.clear();
+	}
+
     if (m_sqlDataBase.isOpen())
         m_sqlDataBase.close();
     m_sqlDataBase = QSqlDatabase();
-    m_sqlDataBase.removeDatabase("DBConnection");
+    QSqlDatabase::removeDatabase("DBConnection");
 
 	m_pConfig->writeToLog(QString("Database closed: %1").arg(m_pConfig->dbPath + "/db.sqlite"));
 }
 
+bool HvnSqlDataBase::checkpointDatabase()
+{
+	// Fold the WAL back into db.sqlite so that a plain file copy is complete
+	return queryDatabase("PRAGMA wal_checkpoint(TRUNCATE)");
+}
+
 void HvnSqlDataBase::initializeDatabase()
 {
 	QMessageBox MsgBox(QMessageBox::Information, "Database initialization", "There is no db.sqlite file in the specified path.\nDB initialization begins...");
@@ -142,11 +177,11 @@ void HvnSqlDataBase::createDatabase()
 }
 
 
-bool HvnSqlDataBase::queryDatabase(const QString &command, std::function<void(QSqlQuery &)> const &DidQuery, bool db_opened, const QByteArray & preview)
+bool HvnSqlDataBase::queryDatabase(const QString &command, std::function<void(QSqlQuery &)> const &DidQuery, const QByteArray & preview)
 {
-	if (!db_opened) m_sqlDataBase.open();
+	HvnSqlConnection* pConnection = getConnection();
     {
-		QSqlQuery sqlQuery(m_sqlDataBase);
+		QSqlQuery sqlQuery(pConnection->db);
 
 		sqlQuery.prepare(command);
 		if (preview.size() > 0)
@@ -154,26 +189,345 @@ bool HvnSqlDataBase::queryDatabase(const QString &command, std::function<void(QS
 
         if (!sqlQuery.exec())
         {
-			QString msg = "Failed to query: " + sqlQuery.lastError().text();
-			m_pConfig->writeToLog(QString("Database error: %1 [%2]").arg(msg).arg(command));
-
-            QMessageBox MsgBox(QMessageBox::Critical, "Database error", msg);
-            MsgBox.exec();
-
-			m_sqlDataBase.close();
+			reportError("Failed to query: " + sqlQuery.lastError().text(), command);
             return false;
         }
-		else
+		else if (QThread::currentThread() == thread())
 			m_pConfig->writeToLog(QString("Database query: %1").arg(command));
 
         // Do next thing
         DidQuery(sqlQuery);
     }
-	if (!db_opened) m_sqlDataBase.close(); 
 
     return true;
 }
 
+bool HvnSqlDataBase::queryPrepared(const QString &command, const QVariantList &values, std::function<void(QSqlQuery &)> const &DidQuery)
+{
+	HvnSqlConnection* pConnection = getConnection();
+	{
+		// Reuse the cached statement unless an enclosing query is still stepping through it
+		QSqlQuery sqlQuery;
+		auto it = pConnection->statements.find(command);
+		if ((it != pConnection->statements.end()) && !it.value().isActive())
+			sqlQuery = it.value();
+		else
+		{
+			sqlQuery = QSqlQuery(pConnection->db);
+			sqlQuery.setForwardOnly(true);
+			if (!sqlQuery.prepare(command))
+			{
+				reportError("Failed to prepare: " + sqlQuery.lastError().text(), command);
+				return false;
+			}
+			if (it == pConnection->statements.end())
+				pConnection->statements.insert(command, sqlQuery);
+		}
+
+		for (int i = 0; i < values.size(); i++)
+			sqlQuery.bindValue(i, values.at(i));
+
+		if (!sqlQuery.exec())
+		{
+			reportError("Failed to query: " + sqlQuery.lastError().text(), command);
+			sqlQuery.finish();
+			return false;
+		}
+		else if (QThread::currentThread() == thread())
+			m_pConfig->writeToLog(QString("Database query: %1").arg(command));
+
+		// Do next thing
+		DidQuery(sqlQuery);
+
+		// Reset the statement so that it can be rebound next time (the compiled program is kept)
+		sqlQuery.finish();
+	}
+
+	return true;
+}
+
+
+void HvnSqlDataBase::reportError(const QString &msg, const QString &command)
+{
+	// Worker threads (e.g. preview decoding) fail silently; only the GUI thread may pop up a message box
+	if (QThread::currentThread() == thread())
+	{
+		m_pConfig->writeToLog(QString("Database error: %1 [%2]").arg(msg).arg(command));
+
+		QMessageBox MsgBox(QMessageBox::Critical, "Database error", msg);
+		MsgBox.exec();
+	}
+	else
+		qDebug() << "Database error:" << msg << command;
+}
+
+QSqlDatabase HvnSqlDataBase::addConnection(const QString &name, const QString &username, const QString &password)
+{
+	QSqlDatabase db;
+#ifdef ENABLE_DATABASE_ENCRYPTION
+	db = QSqlDatabase::addDatabase("SQLITECIPHER", name);
+	db.setDatabaseName(m_pConfig->dbPath + "/db.sqlite");		
+	db.setUserName(username);
+	db.setPassword(password);
+	db.setConnectOptions("QSQLITE_USE_CIPHER=sqlcipher");
+#else
+	db = QSqlDatabase::addDatabase("QSQLITE", name);
+	db.setDatabaseName(m_pConfig->dbPath + "/db.sqlite");
+#endif
+	return db;
+}
+
+void HvnSqlDataBase::setConnectionPragmas(QSqlDatabase &db)
+{
+	// WAL lets readers (e.g. summary tabs) proceed while a record is being inserted
+	QSqlQuery sqlQuery(db);
+	sqlQuery.exec("PRAGMA journal_mode=WAL");
+	sqlQuery.exec("PRAGMA synchronous=NORMAL");
+	sqlQuery.exec("PRAGMA busy_timeout=5000");
+	sqlQuery.exec("PRAGMA temp_store=MEMORY");
+}
+
+HvnSqlConnection* HvnSqlDataBase::getConnection()
+{
+	// GUI thread
+	if (QThread::currentThread() == thread())
+		return &m_mainConnection;
+
+	// Worker threads: a QSqlDatabase may only be used from the thread that created it
+	HvnSqlConnection* pConnection = m_workerConnections.hasLocalData() ? m_workerConnections.localData() : nullptr;
+	if (!pConnection || (pConnection->generation != m_nConnectionGeneration))
+	{
+		m_workerConnections.setLocalData(nullptr); // deletes the stale clone first
+
+		pConnection = new HvnSqlConnection;
+		pConnection->name = QString("DBConnection_%1").arg((quintptr)QThread::currentThreadId());
+		pConnection->db = addConnection(pConnection->name, m_username, m_password);
+		pConnection->generation = m_nConnectionGeneration;
+		if (pConnection->db.open())
+			setConnectionPragmas(pConnection->db);
+		else
+			m_pConfig->writeToLog(QString("Database error: Failed to open worker connection: %1").arg(pConnection->db.lastError().text()));
+
+		m_workerConnections.setLocalData(pConnection);
+	}
+
+	return pConnection;
+}
+
+
+int HvnSqlDataBase::countPatients()
+{
+	int count = 0;
+	queryPrepared("SELECT COUNT(*) FROM patients", {}, [&](QSqlQuery& _sqlQuery) {
+		if (_sqlQuery.next())
+			count = _sqlQuery.value(0).toInt();
+	});
+
+	return count;
+}
+
+bool HvnSqlDataBase::queryPatientList(int offset, int limit, std::function<void(QSqlQuery &)> const &DidQuery)
+{
+	// Columns 0-8 follow the patients table; 9: number of visible records, 10: last visible record date.
+	// Records are aggregated in the same query, so the list costs one round trip per page instead of one per patient.
+	QString command = "SELECT p.first_name, p.last_name, p.id, p.patient_id, p.dob, p.gender, p.accession_number, p.notes, p.physician_name, "
+		"COUNT(r.id), MAX(r.datetime_taken) AS last_case FROM patients p "
+		"LEFT JOIN records r ON r.patient_id=p.patient_id AND r.comment NOT LIKE '%[HIDDEN]%' "
+		"GROUP BY p.id ORDER BY last_case DESC, p.id DESC LIMIT ? OFFSET ?";
+
+	return queryPrepared(command, { limit, offset }, DidQuery);
+}
+
+bool HvnSqlDataBase::queryRecordList(const QString & patient_id, std::function<void(QSqlQuery &)> const &DidQuery)
+{
+	// Same column layout as 'SELECT * FROM records', but the preview and feature blobs are left out
+	// (column 4 holds the preview size); previews are fetched per row by queryRecordPreview() once they are needed.
+	QString command = "SELECT r.id, r.patient_id, r.physician_name, r.datetime_taken, length(t.thumbnail), NULL, r.accession_number, r.title, r.comment, "
+		"r.filename, r.annotations, r.procedure_id, r.vessel_id FROM records r LEFT JOIN record_previews t ON t.record_id=r.id WHERE r.patient_id=?";
+
+	return queryPrepared(command, { patient_id.toInt() }, DidQuery);
+}
+
+QByteArray HvnSqlDataBase::queryRecordPreview(const QString & record_id)
+{
+	QByteArray preview;
+	queryPrepared("SELECT thumbnail FROM record_previews WHERE record_id=?", { record_id.toInt() }, [&](QSqlQuery& _sqlQuery) {
+		if (_sqlQuery.next())
+			preview = _sqlQuery.value(0).toByteArray();
+	});
+
+	return preview;
+}
+
+bool HvnSqlDataBase::updateRecordPreview(const QString & record_id, const QByteArray & preview)
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mtxPreview);
+		m_cachePreview.remove(record_id);
+	}
+
+	if (preview.size() == 0)
+		return queryPrepared("DELETE FROM record_previews WHERE record_id=?", { record_id.toInt() });
+	else
+		return queryPrepared("INSERT OR REPLACE INTO record_previews(record_id, thumbnail) VALUES(?, ?)", { record_id.toInt(), preview });
+}
+
+QByteArray HvnSqlDataBase::encodePreview(const QImage & image)
+{
+	// Previews are kept as compressed thumbnails at display size
+	QImage thumbnail = image;
+	if ((image.width() > PREVIEW_SIZE) || (image.height() > PREVIEW_SIZE))
+		thumbnail = image.scaled(PREVIEW_SIZE, PREVIEW_SIZE, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+
+	QByteArray arr;
+	QBuffer buffer(&arr);
+	buffer.open(QIODevice::WriteOnly);
+	thumbnail.save(&buffer, PREVIEW_FORMAT, PREVIEW_QUALITY);
+
+	return arr;
+}
+
+bool HvnSqlDataBase::getCachedPreview(const QString & record_id, QImage & image)
+{
+	std::unique_lock<std::mutex> lock(m_mtxPreview);
+
+	QImage* pImage = m_cachePreview.object(record_id);
+	if (pImage)
+		image = *pImage;
+
+	return pImage != nullptr;
+}
+
+void HvnSqlDataBase::requestPreview(const QString & record_id)
+{
+	// Previews are fetched & decoded on a single background thread; previewDecoded() is emitted when ready.
+	if (!m_threadPreview.joinable())
+	{
+		m_threadPreview = std::thread([&]() {
+			while (true)
+			{
+				QString id = m_queuePreview.pop();
+				if (id == "")
+					break;
+
+				QImage image;
+				if (getCachedPreview(id, image))
+				{
+					emit previewDecoded(id, image);
+					continue;
+				}
+
+				QByteArray arr = queryRecordPreview(id);
+				if ((arr.size() == 0) || !image.loadFromData(arr))
+					continue;
+
+				{
+					std::unique_lock<std::mutex> lock(m_mtxPreview);
+					m_cachePreview.insert(id, new QImage(image), image.byteCount() / 1024 + 1);
+				}
+
+				emit previewDecoded(id, image);
+			}
+		});
+	}
+
+	m_queuePreview.push(record_id);
+}
+
+
+
+void HvnSqlDataBase::migrateDatabase()
+{
+	int version = 0;
+	{
+		QSqlQuery sqlQuery(m_sqlDataBase);
+		if (sqlQuery.exec("PRAGMA user_version") && sqlQuery.next())
+			version = sqlQuery.value(0).toInt();
+	}
+
+	if (version < 1)
+	{
+		m_sqlDataBase.transaction();
+		{
+			// Indexes for the per-patient record lookups and the patient list aggregate
+			queryDatabase("CREATE INDEX IF NOT EXISTS \"idx_records_patient_id\" ON \"records\" (\"patient_id\", \"datetime_taken\")");
+			queryDatabase("CREATE INDEX IF NOT EXISTS \"idx_records_datetime_taken\" ON \"records\" (\"datetime_taken\")");
+
+			// Back-fill the comment column from comments.txt so that hidden records can be filtered in SQL
+			QStringList ids, comments;
+			queryDatabase("SELECT id, filename FROM records WHERE comment=''", [&](QSqlQuery& _sqlQuery) {
+				while (_sqlQuery.next())
+				{
+					QString filename0 = _sqlQuery.value(1).toString();
+					int idx = filename0.indexOf("record");
+					QString filename = m_pConfig->dbPath + filename0.remove(0, idx - 1);
+					QStringList filenames = filename.split("/");
+					QString last = filenames.last(); filenames.pop_back();
+					if (last.split(".").at(1) == "xml")
+					{
+						last.replace(".xml", "");
+						filenames.append(last);
+					}
+					filenames.append("comments.txt");
+					filename = filenames.join("/");
+
+					QFile text(filename);
+					if (text.open(QFile::ReadOnly))
+					{
+						QTextStream in(&text);
+						QString comment = in.readAll();
+						if (comment != "")
+						{
+							ids << _sqlQuery.value(0).toString();
+							comments << comment;
+						}
+					}
+					text.close();
+				}
+			});
+			for (int i = 0; i < ids.size(); i++)
+				queryPrepared("UPDATE records SET comment=? WHERE id=?", { comments.at(i), ids.at(i).toInt() });
+
+			queryDatabase("PRAGMA user_version=1");
+		}
+		m_sqlDataBase.commit();
+
+		m_pConfig->writeToLog("Database migrated: schema version 1 (record indexes)");
+	}
+
+	if (version < 2)
+	{
+		m_sqlDataBase.transaction();
+		{
+			// Previews move to their own table as compressed thumbnails, so record queries no longer drag the blobs along
+			queryDatabase("CREATE TABLE IF NOT EXISTS \"record_previews\" (\"record_id\" INTEGER, \"thumbnail\" BLOB NOT NULL, "
+				"PRIMARY KEY(\"record_id\"), FOREIGN KEY(\"record_id\") REFERENCES \"records\"(\"id\"))");
+
+			QStringList ids;
+			QList<QByteArray> thumbnails;
+			queryDatabase("SELECT id, preview FROM records WHERE preview IS NOT NULL", [&](QSqlQuery& _sqlQuery) {
+				while (_sqlQuery.next())
+				{
+					QImage image;
+					if (image.loadFromData(_sqlQuery.value(1).toByteArray()))
+					{
+						ids << _sqlQuery.value(0).toString();
+						thumbnails << encodePreview(image);
+					}
+				}
+			});
+			for (int i = 0; i < ids.size(); i++)
+				queryPrepared("INSERT OR REPLACE INTO record_previews(record_id, thumbnail) VALUES(?, ?)", { ids.at(i).toInt(), thumbnails.at(i) });
+			queryDatabase("UPDATE records SET preview=NULL WHERE preview IS NOT NULL");
+
+			queryDatabase("PRAGMA user_version=2");
+		}
+		m_sqlDataBase.commit();
+
+		m_pConfig->writeToLog("Database migrated: schema version 2 (compressed preview thumbnails)");
+	}
+}
+
 
 QString HvnSqlDataBase::getGender(int id)
 {
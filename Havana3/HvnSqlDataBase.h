@@ -2,6 +2,17 @@
 #define HVNSQLDATABASE_H
 
 #include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QThreadStorage>
+#include <QHash>
+#include <QCache>
+#include <QImage>
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+
+#include <Common/Queue.h>
 
 #include <Havana3/Configuration.h>
 
@@ -12,6 +23,16 @@ enum PROCEDURE { NOT_SELECTED_PROCEDURE = 0, PRE_PCI, POST_PCI, FOLLOW_UP, OTHER
 
 class MainWindow;
 
+struct HvnSqlConnection
+{
+	~HvnSqlConnection();
+
+	QString name;
+	QSqlDatabase db;
+	QHash<QString, QSqlQuery> statements; // prepared statements keyed by SQL text
+	int generation = 0;
+};
+
 class HvnSqlDataBase : public QObject
 {
     Q_OBJECT
@@ -29,9 +50,35 @@ public:
 public:
 	bool openDatabase(const QString & username, const QString & password);
     void closeDatabase();
+	bool checkpointDatabase();
     void initializeDatabase();
 	void createDatabase();
-    bool queryDatabase(const QString &, std::function<void(QSqlQuery &)> const &DidQuery = [](QSqlQuery &){}, bool db_opened = false, const QByteArray & preview = QByteArray(0, '\0'));
+    bool queryDatabase(const QString &, std::function<void(QSqlQuery &)> const &DidQuery = [](QSqlQuery &){}, const QByteArray & preview = QByteArray(0, '\0'));
+	bool queryPrepared(const QString &, const QVariantList &, std::function<void(QSqlQuery &)> const &DidQuery = [](QSqlQuery &){});
+
+public:
+	// Bulk queries (patient list with record aggregates, record list without blobs)
+	int countPatients();
+	bool queryPatientList(int offset, int limit, std::function<void(QSqlQuery &)> const &DidQuery);
+	bool queryRecordList(const QString & patient_id, std::function<void(QSqlQuery &)> const &DidQuery);
+	QByteArray queryRecordPreview(const QString & record_id);
+
+public:
+	// Record previews (compressed thumbnails, decoded on a background thread with an in-memory cache)
+	bool updateRecordPreview(const QString & record_id, const QByteArray & preview);
+	QByteArray encodePreview(const QImage & image);
+	bool getCachedPreview(const QString & record_id, QImage & image);
+	void requestPreview(const QString & record_id);
+
+signals:
+	void previewDecoded(const QString &, const QImage &);
+
+private:
+	QSqlDatabase addConnection(const QString &, const QString &, const QString &);
+	void setConnectionPragmas(QSqlDatabase &);
+	void migrateDatabase();
+	void reportError(const QString &, const QString &);
+	HvnSqlConnection* getConnection();
 	
 public:
     QString getGender(int);
@@ -44,7 +91,18 @@ private:
     Configuration *m_pConfig;
     QSqlDatabase m_sqlDataBase;
 
+	// Long-lived connections: GUI thread uses m_mainConnection, worker threads get their own clone
+	HvnSqlConnection m_mainConnection;
+	QThreadStorage<HvnSqlConnection*> m_workerConnections;
+	std::atomic<int> m_nConnectionGeneration;
+
 	QString m_username, m_password;
+
+	// Preview decoding thread & cache
+	std::thread m_threadPreview;
+	Queue<QString> m_queuePreview;
+	std::mutex m_mtxPreview;
+	QCache<QString, QImage> m_cachePreview;
 };
 
 #endif // HVNSQLDATABASE_H
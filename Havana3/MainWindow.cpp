@@ -37,6 +37,9 @@ MainWindow::MainWindow(QWidget *parent) :
     m_pConfiguration = new Configuration;
     m_pConfiguration->getConfigFile("Havana3.ini");
 
+	np::memory::set_budget((int64_t)m_pConfiguration->memoryBudget << 20);
+	np::memory::set_huge_pages(m_pConfiguration->hugePages);
+
     m_pConfiguration->flimScans = FLIM_SCANS;
     m_pConfiguration->flimAlines = FLIM_ALINES;
 	m_pConfiguration->flimFrameSize = m_pConfiguration->flimScans * m_pConfiguration->flimAlines;
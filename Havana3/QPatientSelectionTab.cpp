@@ -11,7 +11,7 @@
 
 
 QPatientSelectionTab::QPatientSelectionTab(QWidget *parent) :
-    QDialog(parent), m_pAddPatientDlg(nullptr)
+    QDialog(parent), m_nTotalPatients(0), m_bAllPatientsLoaded(true), m_pAddPatientDlg(nullptr)
 {
     // Set title
     setWindowTitle("Patient Selection");
@@ -121,6 +121,10 @@ void QPatientSelectionTab::createPatientSelectionViewWidgets()
 	connect(m_pPushButton_SearchData, SIGNAL(clicked(bool)), this, SLOT(searchData()));
     connect(m_pLineEdit_DatabaseLocation, SIGNAL(textChanged(const QString &)), this, SLOT(editDatabaseLocation(const QString &)));
     connect(m_pPushButton_DatabaseLocation, SIGNAL(clicked(bool)), this, SLOT(findDatabaseLocation()));
+	connect(m_pTableWidget_PatientInformation->verticalScrollBar(), &QScrollBar::valueChanged, [&](int value) {
+		if (value >= m_pTableWidget_PatientInformation->verticalScrollBar()->maximum())
+			fetchMorePatients();
+	});
 }
 
 void QPatientSelectionTab::createPatientSelectionTable()
@@ -206,8 +210,9 @@ void QPatientSelectionTab::removePatient()
 			m_pMainWnd->removeTabView(pTabView);
 	}
 
-    m_pHvnSqlDataBase->queryDatabase(QString("DELETE FROM patients WHERE patient_id='%1'").arg(patient_id));
+    m_pHvnSqlDataBase->queryPrepared("DELETE FROM patients WHERE patient_id=?", { patient_id });
     m_pTableWidget_PatientInformation->removeRow(current_row);
+	m_nTotalPatients--;
 
 	m_pConfig->writeToLog(QString("Patient info removed: %1 (ID: %2)").arg(patient_name).arg(patient_id));
 }
@@ -291,7 +296,7 @@ void QPatientSelectionTab::searchData()
 			// Find patient id & load his/her imaging database
 			if (pt_name != "")
 			{
-				m_pHvnSqlDataBase->queryDatabase("SELECT * FROM patients", [&](QSqlQuery& _sqlQuery) {
+				m_pHvnSqlDataBase->queryPrepared("SELECT * FROM patients", {}, [&](QSqlQuery& _sqlQuery) {
 					while (_sqlQuery.next())
 					{
 						QString _pt_name = _sqlQuery.value(1).toString() + ", " + _sqlQuery.value(0).toString();
@@ -304,15 +309,14 @@ void QPatientSelectionTab::searchData()
 				});
 			}
 
-			for (int i = 0; i < m_pTableWidget_PatientInformation->rowCount(); i++)
-				if (m_pTableWidget_PatientInformation->item(i, 1)->text() == pt_id)
-					emit m_pTableWidget_PatientInformation->cellDoubleClicked(i, 0);
+			int patient_row = findPatientRow(pt_id);
+			if (patient_row >= 0)
+				emit m_pTableWidget_PatientInformation->cellDoubleClicked(patient_row, 0);
 								
 			// Load the specified pullback
 			if (acq_date != "")
 			{
-				QString command = QString("SELECT * FROM records WHERE patient_id=%1").arg(pt_id);
-				m_pHvnSqlDataBase->queryDatabase(command, [&](QSqlQuery& _sqlQuery) {
+				m_pHvnSqlDataBase->queryPrepared("SELECT * FROM records WHERE patient_id=?", { pt_id.toInt() }, [&](QSqlQuery& _sqlQuery) {
 					while (_sqlQuery.next())
 					{						
 						// Read comment
@@ -366,7 +370,7 @@ void QPatientSelectionTab::searchData()
 
 		connect(pPushButton_Random, &QPushButton::clicked, [&, pTextEdit_Data]() {
 
-			m_pHvnSqlDataBase->queryDatabase("SELECT * FROM patients", [&](QSqlQuery& _sqlQuery) {
+			m_pHvnSqlDataBase->queryPrepared("SELECT * FROM patients", {}, [&](QSqlQuery& _sqlQuery) {
 
 				srand(time(0));
 
@@ -396,13 +400,12 @@ void QPatientSelectionTab::searchData()
 					}
 				}
 
-				for (int i = 0; i < m_pTableWidget_PatientInformation->rowCount(); i++)
-					if (m_pTableWidget_PatientInformation->item(i, 1)->text() == pt_id)
-						emit m_pTableWidget_PatientInformation->cellDoubleClicked(i, 0);
+				int patient_row = findPatientRow(pt_id);
+				if (patient_row >= 0)
+					emit m_pTableWidget_PatientInformation->cellDoubleClicked(patient_row, 0);
 
 				// Load the random pullback
-				QString command = QString("SELECT * FROM records WHERE patient_id=%1").arg(pt_id);
-				m_pHvnSqlDataBase->queryDatabase(command, [&](QSqlQuery& _sqlQuery) {
+				m_pHvnSqlDataBase->queryPrepared("SELECT * FROM records WHERE patient_id=?", { pt_id.toInt() }, [&](QSqlQuery& _sqlQuery) {
 
 					int num = 0;
 					while (_sqlQuery.next())
@@ -535,13 +538,29 @@ void QPatientSelectionTab::loadPatientDatabase()
 
 	m_pTableWidget_PatientInformation->clearContents();
 	m_pTableWidget_PatientInformation->setRowCount(0);
+
+	// Patients are loaded page by page (see fetchMorePatients)
+	m_nTotalPatients = m_pHvnSqlDataBase->countPatients();
+	m_bAllPatientsLoaded = false;
+	fetchMorePatients();
+
+	m_pConfig->writeToLog(QString("Patient database loaded: %1").arg(m_pConfig->dbPath));
+
+	if (currentRow >= 0) m_pTableWidget_PatientInformation->selectRow(currentRow);
+}
+
+void QPatientSelectionTab::fetchMorePatients()
+{
+	if (m_bAllPatientsLoaded)
+		return;
+
     m_pTableWidget_PatientInformation->setSortingEnabled(false);
 
-	//QStringList dataset;
-	
-    m_pHvnSqlDataBase->queryDatabase("SELECT * FROM patients", [&](QSqlQuery& _sqlQuery) {
+	int rowCount = m_pTableWidget_PatientInformation->rowCount();
+	int nFetched = 0;
+
+	m_pHvnSqlDataBase->queryPatientList(rowCount, PATIENT_LIST_PAGE_SIZE, [&](QSqlQuery& _sqlQuery) {
 
-        int rowCount = 0;
         while (_sqlQuery.next())
         {
             m_pTableWidget_PatientInformation->insertRow(rowCount);
@@ -554,87 +573,9 @@ void QPatientSelectionTab::loadPatientDatabase()
             QTableWidgetItem *pPhysicianItem = new QTableWidgetItem;
             QTableWidgetItem *pKeywordsItem = new QTableWidgetItem;
 
-			QDate last_date(1, 1, 1); QTime last_time(0, 0, 0);  int total = 0;
-            QString command = QString("SELECT * FROM records WHERE patient_id=%1").arg(_sqlQuery.value(3).toString());
-            m_pHvnSqlDataBase->queryDatabase(command, [&, _sqlQuery](QSqlQuery& __sqlQuery) {
-                while (__sqlQuery.next())
-                {		
-					// Read comment
-					QString comment;
-					{
-						QString filename0 = __sqlQuery.value(9).toString();
-						int idx = filename0.indexOf("record");
-						QString filename = m_pConfig->dbPath + filename0.remove(0, idx - 1);
-						QStringList filenames = filename.split("/");						
-						QString last = filenames.last(); filenames.pop_back();
-						if (last.split(".").at(1) == "xml")
-						{
-							last.replace(".xml", "");
-							filenames.append(last);
-						}						
-						filenames.append("comments.txt");
-						filename = filenames.join("/");
-
-						QFile text(filename);
-						if (text.open(QFile::ReadOnly))
-						{
-							QTextStream in(&text);
-							comment = in.readAll();
-						}
-						text.close();
-					}
-					
-					if (!comment.contains("[HIDDEN]"))
-					{
-						///QStringList comments = comment.split('\n');
-						///QString procedure = m_pHvnSqlDataBase->getProcedure(__sqlQuery.value(11).toInt());
-
-						///bool is_sat = false;
-						///for (int i = 0; i < comments.size(); i++)
-						///{
-						///	if (comments.at(i).contains("sat"))
-						///	{
-						///		is_sat = true;
-						///		break;
-						///	}
-						///}
-
-						///bool is_better_pair = false;
-						///for (int i = 0; i < comments.size(); i++)
-						///{
-						///	if (comments.at(i).contains("(better pair)"))
-						///	{
-						///		is_better_pair = true;
-						///		break;
-						///	}
-						///}
-
-						///bool is_bad = false;
-						///for (int i = 0; i < comments.size(); i++)
-						///{
-						///	if (comments.at(i).contains("bad") || comments.at(i).contains("incomplete"))
-						///	{
-						///		is_bad = true;
-						///		break;
-						///	}
-						///}
-
-						///dataset << (QString("%1").arg(_sqlQuery.value(3).toString().toInt(), 8, 10, QChar('0'))) + " / " + (_sqlQuery.value(1).toString() + ", " + _sqlQuery.value(0).toString())
-						///	+ " / " + __sqlQuery.value(3).toString() + " / " + comments.at(1) + " / " + procedure + " / " + QString::number(total + 1)
-						///	+ " / " + QString::number(is_sat); // +" / " + QString::number(is_better_pair) + " / " + QString::number(is_bad);
-
-						QTime time = QDateTime::fromString(__sqlQuery.value(3).toString(), "yyyy-MM-dd hh:mm:ss").time();
-						QDate date = QDateTime::fromString(__sqlQuery.value(3).toString(), "yyyy-MM-dd hh:mm:ss").date();
-
-						if (date > last_date)
-							last_date = date;
-						if (time > last_time)
-							last_time = time;
-
-						total++;
-					}
-                }
-            }, true);
+			// Visible record count & last record date (aggregated by the query)
+			int total = _sqlQuery.value(9).toInt();
+			QString last_case = _sqlQuery.value(10).toString();
 
 			QDate date_of_birth = QDate::fromString(_sqlQuery.value(4).toString(), "yyyy-MM-dd");
 			QDate date_today = QDate::currentDate();
@@ -644,8 +585,8 @@ void QPatientSelectionTab::loadPatientDatabase()
             pIdItem->setText(QString("%1").arg(_sqlQuery.value(3).toString().toInt(), 8, 10, QChar('0')));
             pGenderItem->setText(m_pHvnSqlDataBase->getGender(_sqlQuery.value(5).toInt()));
             pDobItem->setText(QString("%1 (%2)").arg(_sqlQuery.value(4).toString()).arg(age));
-            pLastCaseItem->setText((total != 0 ? last_date.toString("yyyy-MM-dd") : "N/A") + QString(" (%1)").arg(total));
-			pLastCaseItem->setToolTip(last_date.toString("yyyy-MM-dd") + " " + last_time.toString("hh:mm:ss"));
+            pLastCaseItem->setText((total != 0 ? last_case.left(10) : "N/A") + QString(" (%1)").arg(total));
+			pLastCaseItem->setToolTip(last_case);
             pPhysicianItem->setText(_sqlQuery.value(8).toString());
             pKeywordsItem->setText(_sqlQuery.value(7).toString());
 
@@ -666,31 +607,11 @@ void QPatientSelectionTab::loadPatientDatabase()
 				QDir().mkdir(m_pConfig->dbPath + "/record/" + _sqlQuery.value(3).toString());
 
             rowCount++;
+			nFetched++;
         }
-
-		m_pConfig->writeToLog(QString("Patient database loaded: %1").arg(m_pConfig->dbPath));
     });
 
-	///QFile file("dataset_paths.csv");
-	///if (file.open(QFile::WriteOnly))
-	///{
-	///	QTextStream stream(&file);
-
-	///	for (int i = 0; i < dataset.size(); i++)
-	///	{
-	///		QStringList _dataset = dataset.at(i).split("/");
-
-	///		stream << _dataset.at(0) << "\t" // ID
-	///			<< _dataset.at(1) << "\t" // Name
-	///			<< _dataset.at(2) << "\t" // Acq date
-	///			<< _dataset.at(3) << "\t" // culprit
-	///			<< _dataset.at(4) << "\t" // procedure
-	///			<< _dataset.at(5) << "\t" // reproducibility
-	///			<< _dataset.at(6) << "\n"; // better pair
-	///			//<< _dataset.at(7) << "\n"; // bad data
-	///	}
-	///	file.close();
-	///}
+	m_bAllPatientsLoaded = (nFetched < PATIENT_LIST_PAGE_SIZE) || (rowCount >= m_nTotalPatients);
 
     m_pTableWidget_PatientInformation->setSortingEnabled(true);
 	m_pTableWidget_PatientInformation->sortItems(4, Qt::DescendingOrder);
@@ -698,6 +619,19 @@ void QPatientSelectionTab::loadPatientDatabase()
 	for (int i = m_pTableWidget_PatientInformation->rowCount(); i > 0; i--)
 		numbers << QString::number(i);
 	m_pTableWidget_PatientInformation->setVerticalHeaderLabels(numbers);
-	
-	if (currentRow >= 0) m_pTableWidget_PatientInformation->selectRow(currentRow);
+}
+
+int QPatientSelectionTab::findPatientRow(const QString &patient_id)
+{
+	// Fetch further pages until the patient shows up in the table
+	while (true)
+	{
+		for (int i = 0; i < m_pTableWidget_PatientInformation->rowCount(); i++)
+			if (m_pTableWidget_PatientInformation->item(i, 1)->text().toInt() == patient_id.toInt())
+				return i;
+
+		if (m_bAllPatientsLoaded)
+			return -1;
+		fetchMorePatients();
+	}
 }
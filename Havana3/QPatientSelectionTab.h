@@ -41,12 +41,20 @@ private slots:
 	
 public:
     void loadPatientDatabase();
+	int findPatientRow(const QString &);
+
+private:
+	void fetchMorePatients();
 
 // Variables ////////////////////////////////////////////
 private:
     MainWindow* m_pMainWnd;
     Configuration* m_pConfig;
     HvnSqlDataBase* m_pHvnSqlDataBase;
+
+private:
+	int m_nTotalPatients;
+	bool m_bAllPatientsLoaded;
 	
 private:
 	// Widgets for patient selection view
@@ -8,6 +8,7 @@
 #include <Havana3/MainWindow.h>
 #include <Havana3/Configuration.h>
 #include <Havana3/HvnSqlDataBase.h>
+#include <Havana3/RawDataExporter.h>
 #include <Havana3/QStreamTab.h>
 #include <Havana3/QResultTab.h>
 #include <Havana3/Dialog/AddPatientDlg.h>
@@ -55,6 +56,12 @@ QPatientSummaryTab::~QPatientSummaryTab()
 	}
 }
 
+void QPatientSummaryTab::showEvent(QShowEvent *e)
+{
+	QDialog::showEvent(e);
+	QTimer::singleShot(0, this, SLOT(loadVisiblePreviews()));
+}
+
 void QPatientSummaryTab::keyPressEvent(QKeyEvent *e)
 {
 	if (e->key() != Qt::Key_Escape)
@@ -207,6 +214,8 @@ void QPatientSummaryTab::createPatientSummaryTable()
     // Connect signal and slot
 	connect(m_pTableWidget_RecordInformation, SIGNAL(cellDoubleClicked(int, int)), this, SLOT(editContents(int, int)));
 	connect(this, SIGNAL(requestDelete(QString)), this, SLOT(deleteRecordData(QString)));
+	connect(m_pTableWidget_RecordInformation->verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(loadVisiblePreviews()));
+	connect(m_pHvnSqlDataBase, SIGNAL(previewDecoded(const QString &, const QImage &)), this, SLOT(setPreviewImage(const QString &, const QImage &)));
 }
 
 
@@ -357,27 +366,14 @@ void QPatientSummaryTab::exportRawData(bool toggled)
 				QFileDialog::ShowDirsOnly | QFileDialog::DontUseNativeDialog);
 			if (export_path != "")
 			{
-				// Make record path
-				QDir rec_dir(export_path + "/record");
-				if (!rec_dir.exists()) {
-					rec_dir.mkdir(export_path + "/record");
-				}
+				// Fold the WAL into db.sqlite before it is copied
+				m_pHvnSqlDataBase->checkpointDatabase();
 
-				// Copy database file
-				QFile::copy(m_pConfig->dbPath + "/db.sqlite", export_path + "/db.sqlite");
+				// Collect files to export (copied in parallel; an interrupted export resumes in the same path)
+				RawDataExporter* pExporter = new RawDataExporter(export_path, this);
+				pExporter->addFile(m_pConfig->dbPath + "/db.sqlite", "db.sqlite", false);
 
-				// Get export data
-				QString command = QString("SELECT * FROM records WHERE patient_id=%1").arg(m_patientInfo.patientId);
-
-				m_pHvnSqlDataBase->queryDatabase(command, [&](QSqlQuery& _sqlQuery) {
-
-					QMessageBox msg_box(QMessageBox::NoIcon, "Export Raw Data...", "", QMessageBox::NoButton, this);
-					msg_box.setStandardButtons(0);
-					msg_box.setWindowModality(Qt::WindowModal);
-					msg_box.setWindowFlags(Qt::Window | Qt::WindowTitleHint | Qt::CustomizeWindowHint);
-					msg_box.move(QApplication::desktop()->screen()->rect().center() - msg_box.rect().center());
-					msg_box.setFixedSize(msg_box.width(), msg_box.height());
-					msg_box.show();
+				m_pHvnSqlDataBase->queryRecordList(m_patientInfo.patientId, [&](QSqlQuery& _sqlQuery) {
 
 					while (_sqlQuery.next())
 					{
@@ -391,51 +387,72 @@ void QPatientSummaryTab::exportRawData(bool toggled)
 						QFileInfo check_file(fullpath);
 						if ((check_file.exists() && check_file.isFile()))
 						{
-							// Get patient info & date info
+							// Get date info
 							QStringList folders = rel_path.split('/');
-							QString patient = folders.at(folders.size() - 3);
 							QString date = folders.at(folders.size() - 2);
-							int idx = export_date.indexOf(date);
 
-							if (idx != -1)
+							if (export_date.indexOf(date) != -1)
 							{
-								// Make patient path
-								QDir patient_dir(export_path + "/record/" + patient);
-								if (!patient_dir.exists()) {
-									patient_dir.mkdir(export_path + "/record/" + patient);
-								}
-
-								// Make date path
-								QDir date_dir(export_path + "/record/" + patient + "/" + date);
-								if (!date_dir.exists()) {
-									date_dir.mkdir(export_path + "/record/" + patient + "/" + date);
-								}
-
 								// Source and destination
 								QStringList src_folders = fullpath.split('/');
 								src_folders.pop_back();
 								QString src_path = src_folders.join('/');
-								
-								QStringList dst_folders = (export_path + rel_path).split('/');
+
+								QStringList dst_folders = rel_path.split('/', QString::SkipEmptyParts);
 								dst_folders.pop_back();
 								QString dst_path = dst_folders.join('/');
-								
+
 								// Get entry list
 								QDir dir(src_path);
-								QStringList entrylist = dir.entryList();
-								entrylist.pop_front();
-								entrylist.pop_front();
-								
-								// Copy data
-								foreach(const QString& entry, entrylist)
-									QFile::copy(src_path + "/" + entry, dst_path + "/" + entry);
+								foreach(const QString& entry, dir.entryList(QDir::Files))
+									pExporter->addFile(src_path + "/" + entry, dst_path + "/" + entry);
 							}
 						}
 					}
+				});
 
-					msg_box.close();
-					QDesktopServices::openUrl(QUrl("file:///" + export_path));
+				// Byte-level progress, polled while the copy threads run
+				QProgressDialog *pProgressDialog = new QProgressDialog("Export Raw Data...", "Cancel", 0, 1000, this);
+				pProgressDialog->setWindowTitle("Export Raw Data...");
+				pProgressDialog->setWindowModality(Qt::WindowModal);
+				pProgressDialog->setAutoClose(false);
+				pProgressDialog->setAutoReset(false);
+				pProgressDialog->setMinimumDuration(0);
+
+				QTimer *pTimer = new QTimer(pProgressDialog);
+				connect(pTimer, &QTimer::timeout, [pExporter, pProgressDialog]() {
+					double total = (double)qMax(pExporter->getTotalBytes(), (qint64)1);
+					pProgressDialog->setValue((int)(1000.0 * (double)pExporter->getCopiedBytes() / total));
+					pProgressDialog->setLabelText(QString("Export Raw Data... (%1 / %2 files, %3 / %4 MB)")
+						.arg(pExporter->getCopiedFiles()).arg(pExporter->getTotalFiles())
+						.arg(pExporter->getCopiedBytes() / 1048576).arg(pExporter->getTotalBytes() / 1048576));
 				});
+				connect(pProgressDialog, &QProgressDialog::canceled, [pExporter]() { pExporter->cancel(); });
+				connect(pExporter, &RawDataExporter::finished, this, [&, pExporter, pProgressDialog](bool canceled) {
+
+					pProgressDialog->close();
+					pProgressDialog->deleteLater();
+
+					QStringList failed = pExporter->getFailedFiles();
+					if (!failed.isEmpty())
+					{
+						QMessageBox MsgBox(QMessageBox::Warning, "Export error", QString("Failed to export %1 file(s). Export again into the same path to retry.\n\n%2")
+							.arg(failed.size()).arg(failed.mid(0, 10).join('\n')));
+						MsgBox.exec();
+					}
+					else if (!canceled)
+						QDesktopServices::openUrl(QUrl("file:///" + pExporter->getExportPath()));
+
+					m_pConfig->writeToLog(QString("Raw data export %1: %2 (%3 / %4 files)").arg(canceled ? "canceled" : "finished")
+						.arg(pExporter->getExportPath()).arg(pExporter->getCopiedFiles()).arg(pExporter->getTotalFiles()));
+
+					pExporter->deleteLater();
+					m_pToggleButton_Export->setEnabled(true);
+				});
+
+				m_pToggleButton_Export->setDisabled(true);
+				pTimer->start(100);
+				pExporter->start();
 			}
 		}
 
@@ -506,10 +523,8 @@ void QPatientSummaryTab::import()
 			}
 
 			// Add to database
-			QString command = QString("INSERT INTO records(patient_id, datetime_taken, title, filename, procedure_id, vessel_id) "
-				"VALUES('%1', '%2', '%3', '%4', %5, %6)").arg(record_info.patientId).arg(record_info.date)
-				.arg(record_info.title).arg(record_info.filename).arg(record_info.procedure).arg(record_info.vessel);
-			m_pHvnSqlDataBase->queryDatabase(command);
+			QString command = "INSERT INTO records(patient_id, datetime_taken, title, filename, procedure_id, vessel_id) VALUES(?, ?, ?, ?, ?, ?)";
+			m_pHvnSqlDataBase->queryPrepared(command, { record_info.patientId, record_info.date, record_info.title, record_info.filename, record_info.procedure, record_info.vessel });
 			
 			m_pConfig->writeToLog(QString("Exisiting record imported: %1 (ID: %2): %3")
 				.arg(m_patientInfo.patientName).arg(m_patientInfo.patientId).arg(fileName));
@@ -574,15 +589,13 @@ void QPatientSummaryTab::editContents(int row, int column)
 				connect(pDialog, &QDialog::finished, [&, pTextEdit_Comment]() {
 					QString comment = pTextEdit_Comment->toPlainText();
 					{
-						QString command = QString("UPDATE records SET comment='%1' WHERE id=%2").arg(comment).arg(m_pTableWidget_RecordInformation->item(row, 0)->toolTip());
-						m_pHvnSqlDataBase->queryDatabase(command);
-						if (command.contains("[HIDDEN]"))
+						m_pHvnSqlDataBase->queryPrepared("UPDATE records SET comment=? WHERE id=?", { comment, m_pTableWidget_RecordInformation->item(row, 0)->toolTip().toInt() });
+						if (comment.contains("[HIDDEN]"))
 							loadRecordDatabase();
 					}
 					{
 						QString recordId = m_pTableWidget_RecordInformation->item(row, 0)->toolTip();
-						QString command = QString("SELECT * FROM records WHERE id=%1").arg(recordId);
-						m_pHvnSqlDataBase->queryDatabase(command, [&](QSqlQuery& _sqlQuery) {
+						m_pHvnSqlDataBase->queryPrepared("SELECT * FROM records WHERE id=?", { recordId.toInt() }, [&](QSqlQuery& _sqlQuery) {
 							while (_sqlQuery.next())
 							{
 								QString filename0 = _sqlQuery.value(9).toString();
@@ -646,8 +659,7 @@ void QPatientSummaryTab::editContents(int row, int column)
 				});
 				connect(pDialog, &QDialog::finished, [&, pTextEdit_Title]() {
 					QString title = pTextEdit_Title->toPlainText();
-					QString command = QString("UPDATE records SET title='%1' WHERE id=%2").arg(title).arg(m_pTableWidget_RecordInformation->item(row, 0)->toolTip());
-					m_pHvnSqlDataBase->queryDatabase(command);
+					m_pHvnSqlDataBase->queryPrepared("UPDATE records SET title=? WHERE id=?", { title, m_pTableWidget_RecordInformation->item(row, 0)->toolTip().toInt() });
 					m_pConfig->writeToLog(QString("Record title updated: %1 (ID: %2): %3 : record id: %4")
 						.arg(m_patientInfo.patientName).arg(m_patientInfo.patientId).arg(m_pTableWidget_RecordInformation->item(row, 2)->text()).arg(m_pTableWidget_RecordInformation->item(row, 0)->toolTip()));
 				});
@@ -677,8 +689,7 @@ void QPatientSummaryTab::editContents(int row, int column)
 				connect(pDialog, &QDialog::finished, [&, pComboBox_Vessel]() {
 					int vessel = pComboBox_Vessel->currentIndex();
 					m_pTableWidget_RecordInformation->item(row, column)->setText(m_pHvnSqlDataBase->getVessel(vessel));
-					QString command = QString("UPDATE records SET vessel_id=%1 WHERE id=%2").arg(vessel).arg(m_pTableWidget_RecordInformation->item(row, 0)->toolTip());
-					m_pHvnSqlDataBase->queryDatabase(command);
+					m_pHvnSqlDataBase->queryPrepared("UPDATE records SET vessel_id=? WHERE id=?", { vessel, m_pTableWidget_RecordInformation->item(row, 0)->toolTip().toInt() });
 				});
 
 				QVBoxLayout *pVBoxLayout = new QVBoxLayout;
@@ -706,8 +717,7 @@ void QPatientSummaryTab::editContents(int row, int column)
 				connect(pDialog, &QDialog::finished, [&, pComboBox_Procedure]() {
 					int procedure = pComboBox_Procedure->currentIndex();
 					m_pTableWidget_RecordInformation->item(row, column)->setText(m_pHvnSqlDataBase->getProcedure(procedure));
-					QString command = QString("UPDATE records SET procedure_id=%1 WHERE id=%2").arg(procedure).arg(m_pTableWidget_RecordInformation->item(row, 0)->toolTip());
-					m_pHvnSqlDataBase->queryDatabase(command);
+					m_pHvnSqlDataBase->queryPrepared("UPDATE records SET procedure_id=? WHERE id=?", { procedure, m_pTableWidget_RecordInformation->item(row, 0)->toolTip().toInt() });
 				});
 
 				QVBoxLayout *pVBoxLayout = new QVBoxLayout;
@@ -722,8 +732,7 @@ void QPatientSummaryTab::editContents(int row, int column)
 		else if (column == 2)
 		{
 			QString recordId = m_pTableWidget_RecordInformation->item(row, 0)->toolTip();
-			QString command = QString("SELECT * FROM records WHERE id=%1").arg(recordId);
-			m_pHvnSqlDataBase->queryDatabase(command, [&](QSqlQuery& _sqlQuery) {
+			m_pHvnSqlDataBase->queryPrepared("SELECT * FROM records WHERE id=?", { recordId.toInt() }, [&](QSqlQuery& _sqlQuery) {
 				while (_sqlQuery.next())
 				{
 					QString filename0 = _sqlQuery.value(9).toString();
@@ -774,10 +783,8 @@ void QPatientSummaryTab::deleteRecordData(const QString& record_id)
 		return;
 	}
 
-	QString command = QString("SELECT * FROM records WHERE id=%1").arg(record_id);
-
 	int current_row = -1;
-	m_pHvnSqlDataBase->queryDatabase(command, [&, ret](QSqlQuery& _sqlQuery) {
+	m_pHvnSqlDataBase->queryPrepared("SELECT * FROM records WHERE id=?", { record_id.toInt() }, [&, ret](QSqlQuery& _sqlQuery) {
 
 		while (_sqlQuery.next())
 		{
@@ -811,16 +818,15 @@ void QPatientSummaryTab::deleteRecordData(const QString& record_id)
 		}
 	});
 
-	m_pHvnSqlDataBase->queryDatabase(QString("DELETE FROM records WHERE id='%1'").arg(record_id));
+	m_pHvnSqlDataBase->queryPrepared("DELETE FROM records WHERE id=?", { record_id.toInt() });
+	m_pHvnSqlDataBase->updateRecordPreview(record_id, QByteArray());
 	m_pTableWidget_RecordInformation->removeRow(current_row);
 }
 
 
 void QPatientSummaryTab::loadPatientInformation()
 {
-    QString command = QString("SELECT * FROM patients WHERE patient_id=%1").arg(m_patientInfo.patientId);
-
-    m_pHvnSqlDataBase->queryDatabase(command, [&](QSqlQuery& _sqlQuery) {
+    m_pHvnSqlDataBase->queryPrepared("SELECT * FROM patients WHERE patient_id=?", { m_patientInfo.patientId.toInt() }, [&](QSqlQuery& _sqlQuery) {
         while (_sqlQuery.next())
         {
 			QDate date_of_birth = QDate::fromString(_sqlQuery.value(4).toString(), "yyyy-MM-dd");
@@ -869,9 +875,7 @@ void QPatientSummaryTab::loadRecordDatabase()
 	m_pTableWidget_RecordInformation->setRowCount(0);
     m_pTableWidget_RecordInformation->setSortingEnabled(false);
 
-    QString command = QString("SELECT * FROM records WHERE patient_id=%1").arg(m_patientInfo.patientId);
-
-	m_pHvnSqlDataBase->queryDatabase(command, [&](QSqlQuery& _sqlQuery) {
+	m_pHvnSqlDataBase->queryRecordList(m_patientInfo.patientId, [&](QSqlQuery& _sqlQuery) {
 
 		int rowCount = 0;
 		while (_sqlQuery.next())
@@ -970,18 +974,10 @@ void QPatientSummaryTab::loadRecordDatabase()
 				}
 			}
 
-			QByteArray previewByteArray = _sqlQuery.value(4).toByteArray();
-			if (previewByteArray.size() > 0)
+			if (_sqlQuery.value(4).toInt() > 0) // preview size; the image itself is fetched by loadVisiblePreviews()
 			{
-				QPixmap previewImage = QPixmap();
-				previewImage.loadFromData(previewByteArray, "bmp", Qt::ColorOnly);
-				if (comment.contains("[HIDDEN]"))
-				{
-					QImage previewImage0 = previewImage.toImage();
-					QImage previewImage1 = previewImage0.convertToFormat(QImage::Format_Grayscale8);
-					previewImage = QPixmap::fromImage(previewImage1);
-				}
-				pPreviewItem->setData(Qt::DecorationRole, previewImage);
+				pPreviewItem->setData(Qt::UserRole, _sqlQuery.value(0));
+				pPreviewItem->setData(Qt::UserRole + 1, comment.contains("[HIDDEN]"));
 			}
 			else
 			{
@@ -1073,4 +1069,53 @@ void QPatientSummaryTab::loadRecordDatabase()
 	m_pTableWidget_RecordInformation->setVerticalHeaderLabels(numbers);
 
 	if (currentRow >= 0) m_pTableWidget_RecordInformation->selectRow(currentRow);
+
+	QTimer::singleShot(0, this, SLOT(loadVisiblePreviews()));
+}
+
+void QPatientSummaryTab::loadVisiblePreviews()
+{
+	// Fetch & decode previews only for the rows scrolled into view
+	if (!m_pTableWidget_RecordInformation->isVisible())
+		return;
+
+	int first_row = m_pTableWidget_RecordInformation->rowAt(0);
+	int last_row = m_pTableWidget_RecordInformation->rowAt(m_pTableWidget_RecordInformation->viewport()->height() - 1);
+	if (first_row < 0)
+		return;
+	if (last_row < 0)
+		last_row = m_pTableWidget_RecordInformation->rowCount() - 1;
+
+	for (int i = first_row; i <= last_row; i++)
+	{
+		QTableWidgetItem *pPreviewItem = m_pTableWidget_RecordInformation->item(i, 1);
+		if (!pPreviewItem || !pPreviewItem->data(Qt::UserRole).isValid())
+			continue;
+
+		QString record_id = pPreviewItem->data(Qt::UserRole).toString();
+		pPreviewItem->setData(Qt::UserRole, QVariant());
+
+		// Decoded on the database's preview thread unless it is already cached
+		QImage previewImage;
+		if (m_pHvnSqlDataBase->getCachedPreview(record_id, previewImage))
+			setPreviewImage(record_id, previewImage);
+		else
+			m_pHvnSqlDataBase->requestPreview(record_id);
+	}
+}
+
+void QPatientSummaryTab::setPreviewImage(const QString &record_id, const QImage &image)
+{
+	for (int i = 0; i < m_pTableWidget_RecordInformation->rowCount(); i++)
+	{
+		if (m_pTableWidget_RecordInformation->item(i, 0)->toolTip() == record_id)
+		{
+			QTableWidgetItem *pPreviewItem = m_pTableWidget_RecordInformation->item(i, 1);
+			if (pPreviewItem->data(Qt::UserRole + 1).toBool()) // hidden
+				pPreviewItem->setData(Qt::DecorationRole, QPixmap::fromImage(image.convertToFormat(QImage::Format_Grayscale8)));
+			else
+				pPreviewItem->setData(Qt::DecorationRole, QPixmap::fromImage(image));
+			break;
+		}
+	}
 }
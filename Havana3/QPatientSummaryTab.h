@@ -40,6 +40,7 @@ public:
 	
 // Methods //////////////////////////////////////////////
 protected:
+	void showEvent(QShowEvent *);
 	void keyPressEvent(QKeyEvent *);
 	    
 public:
@@ -65,6 +66,8 @@ private slots:
 	void deleteSettingDlg();
 	void editContents(int, int);
 	void deleteRecordData(const QString &);
+	void loadVisiblePreviews();
+	void setPreviewImage(const QString &, const QImage &);
 
 public:
     void loadPatientInformation();
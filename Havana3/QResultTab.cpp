@@ -182,6 +182,7 @@ void QResultTab::createResultReviewWidgets()
 	connect(m_pDataProcessing, SIGNAL(processedSingleFrame(int)), m_pProgressBar, SLOT(setValue(int)));
 	connect(m_pDataProcessing, &DataProcessing::abortedProcessing, [&]() { m_pMainWnd->getTabWidget()->tabCloseRequested(m_pMainWnd->getCurrentTabIndex()); });
 	connect(m_pDataProcessing, SIGNAL(finishedProcessing(bool)), this, SLOT(setVisibleState(bool)));
+	connect(m_pDataProcessing, SIGNAL(publishedFrames(int, int)), this, SLOT(publishFrames(int, int)));
 
 	connect(m_pDataProcessingDotter, SIGNAL(processedSingleFrame(int)), m_pProgressBar, SLOT(setValue(int)));
 	connect(m_pDataProcessingDotter, &DataProcessingDotter::abortedProcessing, [&]() { m_pMainWnd->getTabWidget()->tabCloseRequested(m_pMainWnd->getCurrentTabIndex()); });
@@ -262,8 +263,7 @@ void QResultTab::readRecordData()
 
 void QResultTab::loadRecordInfo()
 {
-	QString command = QString("SELECT * FROM records WHERE id=%1").arg(m_recordInfo.recordId);
-	m_pHvnSqlDataBase->queryDatabase(command, [&](QSqlQuery& _sqlQuery) {
+	m_pHvnSqlDataBase->queryPrepared("SELECT * FROM records WHERE id=?", { m_recordInfo.recordId.toInt() }, [&](QSqlQuery& _sqlQuery) {
 		while (_sqlQuery.next())
 		{
 			m_recordInfo.patientId = _sqlQuery.value(1).toString();
@@ -296,51 +296,13 @@ void QResultTab::loadRecordInfo()
 			}
 			m_recordInfo.comment = comment;
 			
-			QStringList date_list;			
-			QString command = QString("SELECT * FROM records WHERE patient_id=%1").arg(m_recordInfo.patientId);
-			m_pHvnSqlDataBase->queryDatabase(command, [&, _sqlQuery](QSqlQuery& __sqlQuery) {
-				while (__sqlQuery.next())
-				{					
-					QString comment;
-					{
-						QString filename0 = __sqlQuery.value(9).toString();
-						int idx = filename0.indexOf("record");
-						QString filename = m_pConfig->dbPath + filename0.remove(0, idx - 1);;
-						QStringList filenames = filename.split("/");
-						QString last = filenames.last(); filenames.pop_back();
-						if (last.split(".").at(1) == "xml")
-						{
-							last.replace(".xml", "");
-							filenames.append(last);
-						}
-						filenames.append("comments.txt");
-						filename = filenames.join("/");
-
-						QFile text(filename);
-						if (text.open(QFile::ReadOnly))
-						{
-							QTextStream in(&text);
-							comment = in.readAll();
-						}
-						text.close();
-					}
-
-					if (!comment.contains("[HIDDEN]"))
-					{					
-						QString date_ = __sqlQuery.value(3).toString();
-						date_list.append(date_);					
-					}
-				}
-			});
-			date_list.sort();
-
+			// Pullback number: order of this record among the patient's visible records
 			int pb_num = 0;
-			foreach(QString date_, date_list)
-			{
-				pb_num++;
-				if (date_ == m_recordInfo.date)
-					break;
-			}		
+			QString command = "SELECT COUNT(*) FROM records WHERE patient_id=? AND datetime_taken<=? AND comment NOT LIKE '%[HIDDEN]%'";
+			m_pHvnSqlDataBase->queryPrepared(command, { m_recordInfo.patientId.toInt(), m_recordInfo.date }, [&](QSqlQuery& __sqlQuery) {
+				if (__sqlQuery.next())
+					pb_num = __sqlQuery.value(0).toInt();
+			});
 
 			m_recordInfo.pb_num = pb_num;
 			if (m_recordInfo.comment.contains("[HIDDEN]"))
@@ -370,8 +332,7 @@ void QResultTab::loadRecordInfo()
 
 void QResultTab::loadPatientInfo()
 {
-	QString command = QString("SELECT * FROM patients WHERE patient_id=%1").arg(m_recordInfo.patientId);
-	m_pHvnSqlDataBase->queryDatabase(command, [&](QSqlQuery& _sqlQuery) {
+	m_pHvnSqlDataBase->queryPrepared("SELECT * FROM patients WHERE patient_id=?", { m_recordInfo.patientId.toInt() }, [&](QSqlQuery& _sqlQuery) {
 		while (_sqlQuery.next())
 		{
 			m_recordInfo.patientName = _sqlQuery.value(1).toString() + ", " + _sqlQuery.value(0).toString();
@@ -400,8 +361,7 @@ void QResultTab::updatePreviewImage()
 {
 	emit getCapture(m_recordInfo.preview);
 
-	QString command = QString("UPDATE records SET preview=:preview WHERE id=%1").arg(m_recordInfo.recordId);
-	m_pHvnSqlDataBase->queryDatabase(command, [&](QSqlQuery &) {}, false, m_recordInfo.preview);
+	m_pHvnSqlDataBase->updateRecordPreview(m_recordInfo.recordId, m_recordInfo.preview);
 
 	m_pConfig->writeToLog(QString("Record preview updated: %1 (ID: %2): %3 : record id: %4")
 		.arg(m_recordInfo.patientName).arg(m_recordInfo.patientId).arg(m_recordInfo.date).arg(m_recordInfo.recordId));
@@ -410,15 +370,56 @@ void QResultTab::updatePreviewImage()
 
 void QResultTab::setVisibleState(bool enabled)
 {
+	bool previewed = !m_pGroupBox_ResultReview->isHidden();
+
 	m_pGroupBox_ResultReview->setVisible(enabled);
 	m_pProgressBar->setVisible(!enabled);
+
+	// End of the progressive review: all controls back and the whole view of the current frame
+	if (enabled)
+	{
+		foreach(QWidget* pWidget, m_listPreviewDisabled)
+			pWidget->setEnabled(true);
+		m_listPreviewDisabled.clear();
+
+		if (previewed)
+			m_pViewTab->visualizeImage(m_pViewTab->getCurrentFrame());
+	}
+}
+
+void QResultTab::publishFrames(int first, int last)
+{
+	// Progressive review: shown with the first frame processed, only the frame navigation is enabled until the end
+	if (m_pGroupBox_ResultReview->isHidden())
+	{
+		int frame0 = (m_firstFrame > 0) ? m_firstFrame - 1 : 0;
+		if ((frame0 < first) || (frame0 > last))
+			return;
+
+		QList<QWidget*> keep = { m_pViewTab->getSliderSelectFrame(), m_pViewTab->getIncrementButton(), m_pViewTab->getDecrementButton() };
+		foreach(QWidget* pWidget, m_pGroupBox_ResultReview->findChildren<QWidget*>())
+		{
+			if ((qobject_cast<QAbstractButton*>(pWidget) || qobject_cast<QComboBox*>(pWidget)) && !keep.contains(pWidget) && pWidget->isEnabled())
+			{
+				pWidget->setEnabled(false);
+				m_listPreviewDisabled.push_back(pWidget);
+			}
+		}
+		m_pGroupBox_ResultReview->setVisible(true);
+
+		if (m_pViewTab->getCurrentFrame() != frame0)
+			m_pViewTab->setCurrentFrame(frame0);
+		else
+			m_pViewTab->visualizeImage(frame0);
+	}
+
+	m_pViewTab->publishFrames(first, last);
 }
 
 void QResultTab::changeVesselInfo(int info)
 {
     m_recordInfo.vessel = info;
-    QString command = QString("UPDATE records SET vessel_id=%1 WHERE id=%2").arg(info).arg(m_recordInfo.recordId);
-    m_pHvnSqlDataBase->queryDatabase(command);
+    m_pHvnSqlDataBase->queryPrepared("UPDATE records SET vessel_id=? WHERE id=?", { info, m_recordInfo.recordId.toInt() });
 
 	m_pConfig->writeToLog(QString("Record vessel updated: %1 (ID: %2): %3 : record id: %4")
 		.arg(m_recordInfo.patientName).arg(m_recordInfo.patientId).arg(m_recordInfo.date).arg(m_recordInfo.recordId));
@@ -427,8 +428,7 @@ void QResultTab::changeVesselInfo(int info)
 void QResultTab::changeProcedureInfo(int info)
 {
     m_recordInfo.procedure = info;
-    QString command = QString("UPDATE records SET procedure_id=%1 WHERE id=%2").arg(info).arg(m_recordInfo.recordId);
-    m_pHvnSqlDataBase->queryDatabase(command);
+    m_pHvnSqlDataBase->queryPrepared("UPDATE records SET procedure_id=? WHERE id=?", { info, m_recordInfo.recordId.toInt() });
 
 	m_pConfig->writeToLog(QString("Record procedure updated: %1 (ID: %2): %3 : record id: %4")
 		.arg(m_recordInfo.patientName).arg(m_recordInfo.patientId).arg(m_recordInfo.date).arg(m_recordInfo.recordId));
@@ -480,8 +480,7 @@ void QResultTab::createCommentDlg()
 void QResultTab::updateComment()
 {
 	{
-		QString command = QString("UPDATE records SET comment='%1' WHERE id=%2").arg(m_recordInfo.comment).arg(m_recordInfo.recordId);
-		m_pHvnSqlDataBase->queryDatabase(command);
+		m_pHvnSqlDataBase->queryPrepared("UPDATE records SET comment=? WHERE id=?", { m_recordInfo.comment, m_recordInfo.recordId.toInt() });
 	}
 	{
 		QString comment = m_recordInfo.comment;		
@@ -606,7 +605,7 @@ void QResultTab::enableVibrationCorrection(bool)
 		if (m_pSettingDlg)
 		{
 			if (m_pSettingDlg->getPulseReviewTab())
-				m_pSettingDlg->getPulseReviewTab()->loadRois();
+				m_pSettingDlg->getPulseReviewTab()->alignRois();
 			if (m_pSettingDlg->getViewOptionTab())
 			{
 				m_pSettingDlg->getViewOptionTab()->getLabelFlimDelaySync()->setDisabled(true);
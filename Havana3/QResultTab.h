@@ -54,6 +54,7 @@ public:
 
 private slots:
 	void setVisibleState(bool);
+	void publishFrames(int, int);
     void changeVesselInfo(int);
     void changeProcedureInfo(int);
 	void openContainingFolder();
@@ -103,6 +104,7 @@ private:
     QViewTab* m_pViewTab;
 
 	QProgressBar* m_pProgressBar;
+	QList<QWidget*> m_listPreviewDisabled; // controls held back while the record is previewed
 	
     // Dialogs
     SettingDlg *m_pSettingDlg;
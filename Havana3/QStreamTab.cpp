@@ -45,12 +45,26 @@
 #include <ipps.h>
 
 
+static int getLiveBufferCount(int n_config, size_t frame_bytes, int n_max)
+{
+	// Given in the ini, or as many as the memory budget allows up to n_max
+	if (n_config > 0)
+		return n_config;
+
+	size_t n_budget = LIVE_BUFFER_MEMORY_BUDGET / (frame_bytes > 0 ? frame_bytes : 1);
+	return (int)qBound((size_t)2, n_budget, (size_t)n_max);
+}
+
+
 QStreamTab::QStreamTab(QString patient_id, QWidget *parent) :
     QDialog(parent), m_pSettingDlg(nullptr)
 #ifdef DEVELOPER_MODE
 	, m_pScope_Alines(nullptr)
 #endif
 {
+	// Arrays of the live pipeline are accounted to the streaming
+	np::memory::subsystem_scope mem_scope(_MEM_STREAMING_);
+
 	// Set main window objects
     m_pMainWnd = dynamic_cast<MainWindow*>(parent);
     m_pConfig = m_pMainWnd->m_pConfiguration;
@@ -68,22 +82,26 @@ QStreamTab::QStreamTab(QString patient_id, QWidget *parent) :
 	m_pThreadOctProcess = new ThreadManager("OCT image process");
 	m_pThreadVisualization = new ThreadManager("Visualization process");
 
-	// Create buffers for threading operation
-	m_syncFlimProcessing.allocate_queue_buffer(m_pConfig->flimScans, m_pConfig->flimAlines, PROCESSING_BUFFER_SIZE);  // FLIm Processing
+	// Create buffers for threading operation (sized from the loaded configuration)
 #ifndef NEXT_GEN_SYSTEM
-	if (m_pConfig->axsunPipelineMode == PipelineMode::JPEG_COMPRESSED)
-		m_syncOctProcessing.allocate_queue_buffer(m_pConfig->octScans, m_pConfig->octAlines, PROCESSING_BUFFER_SIZE); // OCT Processing
-	else
-		m_syncOctProcessing.allocate_queue_buffer(4 * m_pConfig->octScans, m_pConfig->octAlines, PROCESSING_BUFFER_SIZE); // OCT Processing
+	int oct_scans = (m_pConfig->axsunPipelineMode == PipelineMode::JPEG_COMPRESSED) ? m_pConfig->octScans : 4 * m_pConfig->octScans;
+	int oct_img_scans = m_pConfig->octScans;
+	size_t oct_bytes = sizeof(uint8_t) * oct_scans * m_pConfig->octAlines;
 #else
-	m_syncOctProcessing.allocate_queue_buffer(m_pConfig->octScansFFT / 2, m_pConfig->octAlines, PROCESSING_BUFFER_SIZE); // OCT Processing
-#endif
-	m_syncFlimVisualization.allocate_queue_buffer(11, m_pConfig->flimAlines, PROCESSING_BUFFER_SIZE);  // FLIm Visualization
-#ifndef NEXT_GEN_SYSTEM
-	m_syncOctVisualization.allocate_queue_buffer(m_pConfig->octScans, m_pConfig->octAlines, PROCESSING_BUFFER_SIZE);  // OCT Visualization
-#else
-	m_syncOctVisualization.allocate_queue_buffer(m_pConfig->octScansFFT / 2, m_pConfig->octAlines, PROCESSING_BUFFER_SIZE);  // OCT Visualization
+	int oct_scans = m_pConfig->octScansFFT / 2;
+	int oct_img_scans = m_pConfig->octScansFFT / 2;
+	size_t oct_bytes = sizeof(float) * oct_scans * m_pConfig->octAlines;
 #endif
+	int n_flim_proc = getLiveBufferCount(m_pConfig->liveProcessingBuffers, sizeof(uint16_t) * m_pConfig->flimFrameSize, PROCESSING_BUFFER_SIZE);
+	int n_oct_proc = getLiveBufferCount(m_pConfig->liveProcessingBuffers, oct_bytes, PROCESSING_BUFFER_SIZE);
+	int n_vis = (m_pConfig->liveVisualizationBuffers > 0) ? m_pConfig->liveVisualizationBuffers : VISUALIZATION_BUFFER_SIZE;
+
+	m_syncFlimProcessing.allocate_queue_buffer(m_pConfig->flimScans, m_pConfig->flimAlines, n_flim_proc);  // FLIm Processing
+	m_syncOctProcessing.allocate_queue_buffer(oct_scans, m_pConfig->octAlines, n_oct_proc); // OCT Processing
+	m_syncFlimVisualization.allocate_queue_buffer(11, m_pConfig->flimAlines, n_vis);  // FLIm Visualization
+	m_syncOctVisualization.allocate_queue_buffer(oct_img_scans, m_pConfig->octAlines, n_vis);  // OCT Visualization
+
+	m_pConfig->writeToLog(QString("Live buffers: FLIm processing %1, OCT processing %2, visualization %3").arg(n_flim_proc).arg(n_oct_proc).arg(n_vis));
 
     // Set signal object
     setFlimAcquisitionCallback();
@@ -302,9 +320,7 @@ void QStreamTab::changePatient(QString patient_id)
 {
 	m_recordInfo.patientId = patient_id;
 
-	QString command = QString("SELECT * FROM patients WHERE patient_id=%1").arg(m_recordInfo.patientId);
-
-	m_pHvnSqlDataBase->queryDatabase(command, [&](QSqlQuery& _sqlQuery) {
+	m_pHvnSqlDataBase->queryPrepared("SELECT * FROM patients WHERE patient_id=?", { m_recordInfo.patientId.toInt() }, [&](QSqlQuery& _sqlQuery) {
 		while (_sqlQuery.next())
 		{
 			m_recordInfo.patientName = _sqlQuery.value(1).toString() + ", " + _sqlQuery.value(0).toString();
@@ -406,6 +422,7 @@ bool QStreamTab::enableDataAcquisition(bool enabled)
         if (m_pDataAcquisition->InitializeAcquistion())
         {
             // Start thread process
+			m_pViewTab->m_bStreamingDrawing = false;
             m_pThreadVisualization->startThreading();
 			m_pThreadOctProcess->startThreading();
             m_pThreadFlimProcess->startThreading();
@@ -580,6 +597,7 @@ void QStreamTab::setFlimAcquisitionCallback()
 #endif
 
 					// Push to the copy queue for copying transfered data in copy thread
+					m_pMemoryBuffer->m_syncFlimBuffering.set_stamp(pulse_ptr, m_pDataAcquisition->getFlimFrameStamp());
                     m_pMemoryBuffer->m_syncFlimBuffering.Queue_sync.push(pulse_ptr);
 				}
 			}
@@ -698,6 +716,7 @@ void QStreamTab::setOctAcquisitionCallback()
 #endif
 
 					// Push to the copy queue for copying transfered data in copy thread
+					m_pMemoryBuffer->m_syncOctBuffering.set_stamp(oct_ptr, m_pDataAcquisition->getOctFrameStamp());
 					m_pMemoryBuffer->m_syncOctBuffering.Queue_sync.push(oct_ptr);
 				}
 			}
@@ -748,17 +767,8 @@ void QStreamTab::setFlimProcessingCallback()
         uint16_t* pulse_data = m_syncFlimProcessing.Queue_sync.pop();
         if (pulse_data != nullptr)
         {
-            // Get buffers from threading queues
-            float* flim_ptr = nullptr;
-            {
-                std::unique_lock<std::mutex> lock(m_syncFlimVisualization.mtx);
-
-                if (!m_syncFlimVisualization.queue_buffer.empty())
-                {
-                    flim_ptr = m_syncFlimVisualization.queue_buffer.front();
-                    m_syncFlimVisualization.queue_buffer.pop();
-                }
-            }
+            // Get buffers from threading queues (a lagging visualization loses its oldest frame, acquisition never waits)
+            float* flim_ptr = m_syncFlimVisualization.acquire_or_drop_oldest();
 
             if (flim_ptr != nullptr)
             {
@@ -788,21 +798,21 @@ void QStreamTab::setFlimProcessingCallback()
 						emit m_pSettingDlg->getFlimCalibTab()->plotRoiPulse(0);
 				}
 				
-                // Push the buffers to sync Queues
+                // Push the buffers to sync Queues (tagged with the frame index: the visualization pairs FLIm & OCT on it)
+				FrameStamp stamp; stamp.sequence = frame_count;
+				m_syncFlimVisualization.set_stamp(flim_ptr, stamp);
                 m_syncFlimVisualization.Queue_sync.push(flim_ptr);
                 ///m_syncVisualization.n_exec++;
+            }
 
-                // Return (push) the buffer to the previous threading queue
-                {
-                    std::unique_lock<std::mutex> lock(m_syncFlimProcessing.mtx);
-                    m_syncFlimProcessing.queue_buffer.push(pulse_data);
-                }
+            // Return (push) the buffer to the previous threading queue
+            {
+                std::unique_lock<std::mutex> lock(m_syncFlimProcessing.mtx);
+                m_syncFlimProcessing.queue_buffer.push(pulse_data);
             }
         }
         else
             m_pThreadFlimProcess->_running = false;
-
-		(void)frame_count;
     };
 
     m_pThreadFlimProcess->DidStopData += [&]() {
@@ -846,17 +856,8 @@ void QStreamTab::setOctProcessingCallback()
 #endif
 		if (oct_data != nullptr)
 		{
-			// Get buffers from threading queues
-			uint8_t* img_ptr = nullptr;
-			{
-				std::unique_lock<std::mutex> lock(m_syncOctVisualization.mtx);
-
-				if (!m_syncOctVisualization.queue_buffer.empty())
-				{
-					img_ptr = m_syncOctVisualization.queue_buffer.front();
-					m_syncOctVisualization.queue_buffer.pop();
-				}
-			}
+			// Get buffers from threading queues (a lagging visualization loses its oldest frame, acquisition never waits)
+			uint8_t* img_ptr = m_syncOctVisualization.acquire_or_drop_oldest();
 
 			if (img_ptr != nullptr)
 			{
@@ -888,21 +889,21 @@ void QStreamTab::setOctProcessingCallback()
 				}
 #endif
 				
-				// Push the buffers to sync Queues
+				// Push the buffers to sync Queues (tagged with the frame index: the visualization pairs FLIm & OCT on it)
+				FrameStamp stamp; stamp.sequence = frame_count;
+				m_syncOctVisualization.set_stamp(img_ptr, stamp);
 				m_syncOctVisualization.Queue_sync.push(img_ptr);
 				///m_syncOctVisualization.n_exec++;
+			}
 
-				// Return (push) the buffer to the previous threading queue
-				{
-					std::unique_lock<std::mutex> lock(m_syncOctProcessing.mtx);
-					m_syncOctProcessing.queue_buffer.push(oct_data);
-				}
+			// Return (push) the buffer to the previous threading queue
+			{
+				std::unique_lock<std::mutex> lock(m_syncOctProcessing.mtx);
+				m_syncOctProcessing.queue_buffer.push(oct_data);
 			}
 		}
 		else
 			m_pThreadOctProcess->_running = false;
-
-		(void)frame_count;
 	};
 
 	m_pThreadOctProcess->DidStopData += [&]() {
@@ -948,34 +949,61 @@ void QStreamTab::setVisualizationCallback()
         // Get the buffers from the previous sync Queues
         float* flim_data = m_syncFlimVisualization.Queue_sync.pop();
         uint8_t* oct_data = m_syncOctVisualization.Queue_sync.pop();
+
+		// FLIm & OCT frames of the same index go together: each stream drops its own oldest frames, so the one ahead waits for the other
+		while ((flim_data != nullptr) && (oct_data != nullptr))
+		{
+			uint32_t flim_index = m_syncFlimVisualization.get_stamp(flim_data).sequence;
+			uint32_t oct_index = m_syncOctVisualization.get_stamp(oct_data).sequence;
+			if (flim_index < oct_index)
+			{
+				{
+					std::unique_lock<std::mutex> lock(m_syncFlimVisualization.mtx);
+					m_syncFlimVisualization.queue_buffer.push(flim_data);
+				}
+				m_syncFlimVisualization.n_dropped++;
+				flim_data = m_syncFlimVisualization.Queue_sync.pop();
+			}
+			else if (oct_index < flim_index)
+			{
+				{
+					std::unique_lock<std::mutex> lock(m_syncOctVisualization.mtx);
+					m_syncOctVisualization.queue_buffer.push(oct_data);
+				}
+				m_syncOctVisualization.n_dropped++;
+				oct_data = m_syncOctVisualization.Queue_sync.pop();
+			}
+			else
+				break;
+		}
+
         if ((flim_data != nullptr) && (oct_data != nullptr)) 
         {
             // Body
             if (m_pDataAcquisition->getAcquisitionState()) // Only valid if acquisition is running
             {
-				// Mirroring
-				if (m_pConfig->verticalMirroring)
+				// One frame at a time for the GUI: frames arriving while it is still drawing are dropped here instead of piling up as events
+				if (!m_pViewTab->m_bStreamingDrawing.exchange(true))
 				{
+					// Copy to the visualization buffers of the view (the sync buffers are reused as soon as they are returned)
 #ifndef NEXT_GEN_SYSTEM
 					IppiSize roi_oct = { m_pViewTab->m_visImage.size(0), m_pViewTab->m_visImage.size(1) };
 #else
 					IppiSize roi_oct = { m_pConfig->octScansFFT / 2, m_pConfig->octAlines };
 #endif
-					ippiMirror_8u_C1IR(oct_data, roi_oct.width, roi_oct, ippAxsVertical);
-				}
+					if (m_pConfig->verticalMirroring)
+						ippiMirror_8u_C1R(oct_data, roi_oct.width, m_pViewTab->m_visImage.raw_ptr(), roi_oct.width, roi_oct, ippAxsVertical);
+					else
+						memcpy(m_pViewTab->m_visImage.raw_ptr(), oct_data, sizeof(uint8_t) * m_pViewTab->m_visImage.length());
+					memcpy(m_pViewTab->m_visIntensity.raw_ptr(), flim_data + 0 * m_pConfig->flimAlines, sizeof(float) * m_pViewTab->m_visIntensity.length());
+					memcpy(m_pViewTab->m_visLifetime.raw_ptr(), flim_data + 8 * m_pConfig->flimAlines, sizeof(float) * m_pViewTab->m_visLifetime.length());
 
-                // Draw A-lines
-#ifndef NEXT_GEN_SYSTEM
-				m_pViewTab->m_visImage = np::Uint8Array2(oct_data, m_pConfig->octScans, m_pConfig->octAlines);	
-#else
-				m_pViewTab->m_visImage = np::Uint8Array2(oct_data, m_pConfig->octScansFFT / 2, m_pConfig->octAlines);
-#endif
-				m_pViewTab->m_visIntensity = np::FloatArray2(flim_data + 0 * m_pConfig->flimAlines, m_pConfig->flimAlines, 4);
-				m_pViewTab->m_visLifetime = np::FloatArray2(flim_data + 8 * m_pConfig->flimAlines, m_pConfig->flimAlines, 3);
-				
-                // Draw Images	
-				emit m_pViewTab->drawImage(m_pViewTab->m_visImage.raw_ptr(),
-					m_pViewTab->m_visIntensity.raw_ptr(), m_pViewTab->m_visLifetime.raw_ptr());
+					// Draw Images (the view clears m_bStreamingDrawing when done)
+					emit m_pViewTab->drawImage(m_pViewTab->m_visImage.raw_ptr(),
+						m_pViewTab->m_visIntensity.raw_ptr(), m_pViewTab->m_visLifetime.raw_ptr());
+				}
+				else
+					m_syncOctVisualization.n_dropped++;
             }
 
 			// Return (push) the buffer to the previous threading queue
@@ -1300,24 +1328,28 @@ void QStreamTab::onTimerSyncMonitor()
 	size_t op_bfn = getOctProcessingBufferQueueSize();
 	size_t fv_bfn = getFlimVisualizationBufferQueueSize();
 	size_t ov_bfn = getOctVisualizationBufferQueueSize();
+	int vis_drop = m_syncFlimVisualization.n_dropped + m_syncOctVisualization.n_dropped;
+	int mem = (int)(np::memory::live_bytes() >> 20);
 #ifndef NEXT_GEN_SYSTEM
 #ifdef AXSUN_ENABLE
 	double oct_fps = m_pDataAcquisition->getAxsunCapture()->frameRate;	
 	uint32_t dropped_packets = m_pDataAcquisition->getAxsunCapture()->dropped_packets;
+	uint32_t dropped_images = m_pDataAcquisition->getAxsunCapture()->dropped_images;
 #else
 	double oct_fps = 0.0;
 	uint32_t dropped_packets = 0;
+	uint32_t dropped_images = 0;
 #endif
 	double flim_fps = m_pDataAcquisition->getDigitizer()->frameRate;
 
-	m_pLabel_StreamingSyncStatus->setText(QString("\n[Sync]\nFP#: %1\nOP#: %2\nFV#: %3\nOV#: %4\nOCT: %5 fps\nFLIM: %6 fps\ndrop ptks: %7")
-		.arg(fp_bfn, 3).arg(op_bfn, 3).arg(fv_bfn, 3).arg(ov_bfn, 3).arg(oct_fps, 3, 'f', 2).arg(flim_fps, 3, 'f', 2).arg(dropped_packets));
+	m_pLabel_StreamingSyncStatus->setText(QString("\n[Sync]\nFP#: %1\nOP#: %2\nFV#: %3\nOV#: %4\nOCT: %5 fps\nFLIM: %6 fps\ndrop ptks: %7\ndrop imgs: %8\nvis drop: %9\nmem: %10 MB")
+		.arg(fp_bfn, 3).arg(op_bfn, 3).arg(fv_bfn, 3).arg(ov_bfn, 3).arg(oct_fps, 3, 'f', 2).arg(flim_fps, 3, 'f', 2).arg(dropped_packets).arg(dropped_images).arg(vis_drop).arg(mem));
 #else
 	double oct_fps = m_pDataAcquisition->getOctDigitizer()->frameRate;
 	double flim_fps = m_pDataAcquisition->getFlimDigitizer()->frameRate;
 
-	m_pLabel_StreamingSyncStatus->setText(QString("\n[Sync]\nFP#: %1\nOP#: %2\nFV#: %3\nOV#: %4\nOCT: %5 fps\nFLIM: %6 fps")
-		.arg(fp_bfn, 3).arg(op_bfn, 3).arg(fv_bfn, 3).arg(ov_bfn, 3).arg(oct_fps, 3, 'f', 2).arg(flim_fps, 3, 'f', 2));
+	m_pLabel_StreamingSyncStatus->setText(QString("\n[Sync]\nFP#: %1\nOP#: %2\nFV#: %3\nOV#: %4\nOCT: %5 fps\nFLIM: %6 fps\nvis drop: %7\nmem: %8 MB")
+		.arg(fp_bfn, 3).arg(op_bfn, 3).arg(fv_bfn, 3).arg(ov_bfn, 3).arg(oct_fps, 3, 'f', 2).arg(flim_fps, 3, 'f', 2).arg(vis_drop).arg(mem));
 #endif
 }
 
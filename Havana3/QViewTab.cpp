@@ -12,12 +12,15 @@
 
 #include <DataAcquisition/DataProcessing.h>
 #include <DataAcquisition/DataProcessingDotter.h>
+#include <DataAcquisition/FlimMapCache.h>
 
 #include <ipps.h>
 
 #include <tbb/parallel_for.h>
 #include <tbb/blocked_range.h>
 
+#include <algorithm>
+
 #include <mkl_service.h>
 #include <mkl_df.h>
 
@@ -29,7 +32,8 @@ QViewTab::QViewTab(bool is_streaming, QWidget *parent) :
 	m_pImgObjIntensityPropMap(nullptr), m_pImgObjIntensityRatioMap(nullptr), m_pImgObjLongiImage(nullptr), m_pImgObjPlaqueCompositionMap(nullptr), 
 	m_pCirc(nullptr), m_pMedfiltRect(nullptr), m_pMedfiltIntensityMap(nullptr), m_pMedfiltLifetimeMap(nullptr), m_pMedfiltLongi(nullptr),
 	m_pLumenDetection(nullptr), m_pForest(nullptr), m_pSVM(nullptr), 
-	m_pDialog_SetRange(nullptr), m_bRePrediction(true), _running(false)
+	m_pDialog_SetRange(nullptr), m_bRePrediction(true), _running(false), m_nLongiAline(-1),
+	m_nProgressive(_PROGRESSIVE_OFF_), m_nPendingFrame(-1), m_bStreamingDrawing(false)
 {
 	// Set configuration objects
 	if (is_streaming)
@@ -364,7 +368,7 @@ void QViewTab::createViewTabWidgets(bool is_streaming)
 					int ivus_frame = matches.at(1).toInt() - 1;
 					if (ivus_frame != -1)
 					{
-						int ivus_total_frame = (int)pIvusViewerDlg->m_vectorIvusImages.size();
+						int ivus_total_frame = pIvusViewerDlg->getIvusFrameCount();
 						int ivus_rotation = matches.at(2).toInt();
 
 						QString label = QString("[%1] %2 (%3 %4 / %5) CCW %6 deg\n(%7)").arg(pt_name).arg(acq_date)
@@ -840,7 +844,11 @@ void QViewTab::invalidate()
 					// Make prediction		
 					m_plaqueCompositionProbMap.at(0) = np::FloatArray2(ML_N_CATS * m_pConfigTemp->flimAlines, m_pConfigTemp->frames);
 					m_plaqueCompositionMap.at(0) = np::FloatArray2(3 * m_pConfigTemp->flimAlines, m_pConfigTemp->frames);
-					m_pForest->predict(m_featVectors, m_plaqueCompositionProbMap.at(0)); // RF prediction for plaque composition classification		
+					if (!cacheComposition(_RF_COMPO_, false)) // Predicted ahead by the batch reprocessing or a previous review
+					{
+						m_pForest->predict(m_featVectors, m_plaqueCompositionProbMap.at(0)); // RF prediction for plaque composition classification		
+						cacheComposition(_RF_COMPO_, true);
+					}
 
 					m_bRePrediction = false;
 				}
@@ -904,7 +912,11 @@ void QViewTab::invalidate()
 						m_plaqueCompositionProbMap.at(c) = np::FloatArray2(ML_N_CATS * m_pConfigTemp->flimAlines, m_pConfigTemp->frames);
 						m_plaqueCompositionMap.at(c) = np::FloatArray2(3 * m_pConfigTemp->flimAlines, m_pConfigTemp->frames);
 					}
-					m_pSVM->predict(m_featVectors, m_plaqueCompositionProbMap.at(1), m_plaqueCompositionProbMap.at(2)); // SVM prediction for plaque composition classification	
+					if (!cacheComposition(_SVM_SOFTMAX_, false))
+					{
+						m_pSVM->predict(m_featVectors, m_plaqueCompositionProbMap.at(1), m_plaqueCompositionProbMap.at(2)); // SVM prediction for plaque composition classification	
+						cacheComposition(_SVM_SOFTMAX_, true);
+					}
 					
 					m_bRePrediction = false;
 				}
@@ -1036,10 +1048,6 @@ void QViewTab::invalidate()
 	}
 	m_pImageView_ColorBar->update();
 	
-	// Statistcs initialization
-	m_peakLifetime = np::FloatArray2();
-	m_avgLifetime = np::FloatArray2();
-
 	// Visualization
 	visualizeEnFaceMap(true);
 	visualizeImage(getCurrentFrame());
@@ -1242,9 +1250,9 @@ void QViewTab::setObjects(Configuration* pConfig)
 	if (m_pMedfiltRect) delete m_pMedfiltRect;
 	m_pMedfiltRect = new medfilt(diameter / 2, pConfig->octAlines, 3, 3);
 	if (m_pMedfiltIntensityMap) delete m_pMedfiltIntensityMap;
-	m_pMedfiltIntensityMap = new medfilt(3 * pConfig->flimAlines, pConfig->frames, 5, 3);
+	m_pMedfiltIntensityMap = new medfilt(pConfig->flimAlines, pConfig->frames, 5, 3, true);
 	if (m_pMedfiltLifetimeMap) delete m_pMedfiltLifetimeMap;
-	m_pMedfiltLifetimeMap = new medfilt(3 * pConfig->flimAlines, pConfig->frames, 7, 5);
+	m_pMedfiltLifetimeMap = new medfilt(pConfig->flimAlines, pConfig->frames, 7, 5, true);
 	if (m_pMedfiltLongi) delete m_pMedfiltLongi;
 	m_pMedfiltLongi = new medfilt(frames4, diameter, 3, 3);
 
@@ -1501,10 +1509,19 @@ void QViewTab::visualizeImage(uint8_t* oct_im, float* intensity, float* lifetime
 	
 	// Make circularzing
 	emit makeCirc();
+
+	// The visualization buffers can be refilled
+	m_bStreamingDrawing = false;
 }
 
 void QViewTab::visualizeImage(int frame) // Post-processing mode
 {
+	if (isPreviewOnly())
+	{
+		visualizePreview(frame);
+		return;
+	}
+
     if (m_vectorOctImage.size() != 0)
     {
 		// Measure state uncheck
@@ -1650,7 +1667,7 @@ void QViewTab::visualizeImage(int frame) // Post-processing mode
 					pIvusViewerDlg->getIvusImage(ivus_frame, ivus_rotation, ivusImage);
 
 					m_pImageView_Ivus->setEnterCallback([&, pIvusViewerDlg, ivus_frame, ivus_rotation]() { m_pImageView_Ivus->setText(QPoint(8, 230),
-						QString("%1 / %2 (CCW %3 deg)").arg(ivus_frame + 1).arg((int)pIvusViewerDlg->m_vectorIvusImages.size()).arg(ivus_rotation)); });
+						QString("%1 / %2 (CCW %3 deg)").arg(ivus_frame + 1).arg(pIvusViewerDlg->getIvusFrameCount()).arg(ivus_rotation)); });
 					m_pImageView_Ivus->setLeaveCallback([&]() { m_pImageView_Ivus->setText(QPoint(8, 230), ""); });
 				}
 				else
@@ -1696,6 +1713,11 @@ void QViewTab::visualizeImage(int frame) // Post-processing mode
 
 void QViewTab::visualizeLongiImage(int aline)
 {
+	if (isPreviewOnly())
+		return;
+
+	m_nLongiAline = aline;
+
 	// Pre-determined values
 	int frames = (int)m_vectorOctImage.size();
 	int octScans = m_pConfigTemp->octRadius;
@@ -1904,14 +1926,81 @@ void QViewTab::visualizeLongiImage(int aline)
 }
 
 
+void QViewTab::setProgressiveState(int state)
+{
+	std::unique_lock<std::mutex> lock(m_mtxProgressive);
+	m_nProgressive = state;
+	m_nPendingFrame = -1;
+}
+
+void QViewTab::publishFrames(int first, int last)
+{
+	// The frame asked for is shown as soon as it is processed
+	int frame = m_nPendingFrame;
+	if ((m_nProgressive == _PROGRESSIVE_PREVIEW_) && (frame >= first) && (frame <= last) && (frame == getCurrentFrame()))
+		visualizePreview(frame);
+}
+
+bool QViewTab::isPreviewOnly()
+{
+	// Only the OCT cross-sections can be shown before the processing is over; the finalizing thread itself goes through
+	int state = m_nProgressive;
+	return (state == _PROGRESSIVE_PREVIEW_) || ((state == _PROGRESSIVE_FINALIZING_) && (QThread::currentThread() == thread()));
+}
+
+void QViewTab::visualizePreview(int frame)
+{
+	std::unique_lock<std::mutex> lock(m_mtxProgressive);
+	if (m_nProgressive != _PROGRESSIVE_PREVIEW_)
+		return;
+
+	DataProcessing* pDataProc = m_pResultTab->getDataProcessing();
+	if (!m_pConfigTemp)
+		m_pConfigTemp = pDataProc->getConfigTemp();
+
+	QString str;
+	if (!pDataProc->isFrameReady(frame))
+	{
+		// Read next and shown when published
+		pDataProc->requestFrame(frame);
+		m_nPendingFrame = frame;
+
+		str.sprintf("Frame : %3d / %3d (processing...)", frame + 1, (int)m_vectorOctImage.size());
+		m_pImageView_CircImage->setText(QPoint(15, 590), str, false, Qt::white);
+		return;
+	}
+	m_nPendingFrame = -1;
+
+	// OCT Visualization
+	scaleOctImage(m_vectorOctImage.at(frame), m_pImgObjRectImage->arr, m_pConfigTemp->reflectionRemoval);
+	circShift(m_pImgObjRectImage->arr, (m_pConfigTemp->rotatedAlines) % m_pConfigTemp->octAlines);
+	(*m_pMedfiltRect)(m_pImgObjRectImage->arr.raw_ptr());
+
+	// Convert RGB
+	m_pImgObjRectImage->convertRgb();
+
+	// Make circularzing
+	emit makeCirc();
+
+	// Status Update
+	str.sprintf("Frame : %3d / %3d", frame + 1, (int)m_vectorOctImage.size());
+	m_pImageView_CircImage->setText(QPoint(15, 590), str, false, Qt::white);
+}
+
+
 void QViewTab::constructCircImage()
 {
     // Circularizing
     np::Uint8Array2 rect_temp(m_pImgObjRectImage->qrgbimg.bits(), 3 * m_pImgObjRectImage->arr.size(0), m_pImgObjRectImage->arr.size(1));
-    (*m_pCirc)(rect_temp, m_pImgObjCircImage->qrgbimg.bits(), false, true); // depth-aline domain, rgb coordinate
+
+	// Circularize straight into the back buffer of the view when the sizes agree (no copy on the UI side)
+	uint8_t* pCircImage = m_pImgObjCircImage->qrgbimg.bits();
+	if ((m_pImageView_CircImage->getWidth() == m_pImgObjCircImage->getWidth()) && (m_pImageView_CircImage->getHeight() == m_pImgObjCircImage->getHeight()))
+		pCircImage = m_pImageView_CircImage->getBackBuffer();
+    (*m_pCirc)(rect_temp, pCircImage, false, true); // depth-aline domain, rgb coordinate
 	
     // Draw image
-    emit paintCircImage(m_pImgObjCircImage->qrgbimg.bits());
+    emit paintCircImage(pCircImage);
 } 
 
 
@@ -2290,78 +2379,111 @@ void QViewTab::lumenContourDetection()
 	invalidate();
 }
 
-void QViewTab::calculateStatistics(bool toggled)
+void QViewTab::calculateLifetimeStatistics()
 {
-	if (toggled)
-	{
-		if (m_peakLifetime.length() == 0)
-		{
-			m_peakLifetime = np::FloatArray2(m_pConfigTemp->frames, 3);
-			m_avgLifetime = np::FloatArray2(m_pConfigTemp->frames, 3);
+	if (m_lifetimeMap.size() < 3)
+		return;
 
-			for (int ch = 0; ch < 3; ch++)
-			{
-				// intensity & lifetime map at certain channel
-				np::FloatArray2& intensity = m_intensityMap.at(ch);
-				np::FloatArray2& lifetime = m_lifetimeMap.at(ch);
+	int alines = m_lifetimeMap.at(0).size(0);
+	int frames = m_lifetimeMap.at(0).size(1);
+	if (alines == 0 || frames == 0)
+		return;
 
-				// norm intensity to calculate weighted average lifetime
-				np::Uint8Array2 norm_intensity0(intensity.size(0), intensity.size(1));
-				np::FloatArray2 norm_intensity(intensity.size(0), intensity.size(1));
+	const int top_k = (alines < 10) ? alines : 10;
+	const float mask_thres = 0.5f;
 
-				ippiScale_32f8u_C1R(intensity, sizeof(float) * intensity.size(0), norm_intensity0, sizeof(uint8_t) * norm_intensity0.size(0),
-				{ intensity.size(0), intensity.size(1) }, m_pConfig->flimIntensityRange[ch].min, m_pConfig->flimIntensityRange[ch].max);
-				ippsConvert_8u32f(norm_intensity0, norm_intensity, norm_intensity.length());
-				ippsDivC_32f_I(255.0f, norm_intensity, norm_intensity.length());
+	if ((m_peakLifetime.size(0) != frames) || (m_peakLifetimeSum.size(0) != frames + 1))
+	{
+		m_peakLifetime = np::FloatArray2(frames, 3);
+		m_avgLifetime = np::FloatArray2(frames, 3);
+		m_peakLifetimeSum = np::DoubleArray2(frames + 1, 3);
+	}
 
-				np::FloatArray2 weighted_lifetime(lifetime.size(0), lifetime.size(1));
-				ippsMul_32f(norm_intensity, lifetime, weighted_lifetime, lifetime.length());
+	for (int ch = 0; ch < 3; ch++)
+	{
+		// intensity & lifetime map at certain channel
+		np::FloatArray2& intensity = m_intensityMap.at(ch);
+		np::FloatArray2& lifetime = m_lifetimeMap.at(ch);
+
+		float int_min = m_pConfig->flimIntensityRange[ch].min;
+		float int_max = m_pConfig->flimIntensityRange[ch].max;
+		float int_scale = (int_max > int_min) ? 255.0f / (int_max - int_min) : 0.0f;
+		m_statIntensityRange[ch].min = int_min;
+		m_statIntensityRange[ch].max = int_max;
+
+		// Single pass per frame: 8-bit normalized intensity weights, weighted average lifetime,
+		// and the mean of the top-k lifetimes among alines of sufficient intensity (top-k selection, no sort)
+		tbb::parallel_for(tbb::blocked_range<size_t>(0, (size_t)frames),
+			[&](const tbb::blocked_range<size_t>& r) {
+			std::vector<float> masked(alines);
+			for (size_t i = r.begin(); i != r.end(); ++i)
+			{
+				const float* pIntensity = &intensity(0, (int)i);
+				const float* pLifetime = &lifetime(0, (int)i);
 
-				// sort lifetime to calculate peak lifetime
-				np::FloatArray2 sort_lifetime(lifetime.size(0), lifetime.size(1));
-				memcpy(sort_lifetime, lifetime, sizeof(float) * lifetime.length());
-				
-				float mask_thres = 0.5f;
-				np::Uint8Array2 weight_mask0(intensity.size(0), intensity.size(1));
-				np::FloatArray2 weight_mask(intensity.size(0), intensity.size(1));				
-				ippiCompareC_32f_C1R(norm_intensity, sizeof(float) * norm_intensity.size(0), mask_thres,
-					weight_mask0, sizeof(uint8_t) * weight_mask0.size(0), { norm_intensity.size(0), norm_intensity.size(1) }, ippCmpGreaterEq);
-				ippsConvert_8u32f(weight_mask0, weight_mask, weight_mask.length());
-				ippsDivC_32f_I(255.0f, weight_mask, weight_mask.length());
-				ippsMul_32f_I(weight_mask, sort_lifetime, sort_lifetime.length());
-
-				for (int i = 0; i < lifetime.size(1); i++)
+				float weighted_sum = 0.0f, weight_sum = 0.0f;
+				for (int j = 0; j < alines; j++)
 				{
-					// Find peak lifetime at certain frame
-					ippsSortDescend_32f_I(&sort_lifetime(0, i), sort_lifetime.size(0));
-					ippsMean_32f(&sort_lifetime(0, i), 10, &m_peakLifetime(i, ch), ippAlgHintAccurate);
-
-					// Find average lifetime at certain frame
-					float sum_temp;
-					ippsSum_32f(&weighted_lifetime(0, i), lifetime.size(0), &m_avgLifetime(i, ch), ippAlgHintAccurate);
-					ippsSum_32f(&norm_intensity(0, i), intensity.size(0), &sum_temp, ippAlgHintAccurate);
-					m_avgLifetime(i, ch) /= sum_temp;
+					float norm = (pIntensity[j] - int_min) * int_scale;
+					norm = (norm < 0.0f) ? 0.0f : ((norm > 255.0f) ? 255.0f : norm);
+					norm = roundf(norm) / 255.0f;
+
+					weighted_sum += norm * pLifetime[j];
+					weight_sum += norm;
+					masked[j] = (norm >= mask_thres) ? pLifetime[j] : 0.0f;
 				}
+
+				// Find average lifetime at certain frame
+				m_avgLifetime((int)i, ch) = (weight_sum > 0.0f) ? weighted_sum / weight_sum : 0.0f;
+
+				// Find peak lifetime at certain frame
+				std::nth_element(masked.begin(), masked.begin() + (top_k - 1), masked.end(), std::greater<float>());
+				float peak_sum = 0.0f;
+				for (int k = 0; k < top_k; k++)
+					peak_sum += masked[k];
+				m_peakLifetime((int)i, ch) = peak_sum / top_k;
 			}
-		}
+		});
+
+		// Prefix sums for range queries over quantitationRange
+		m_peakLifetimeSum(0, ch) = 0.0;
+		for (int i = 0; i < frames; i++)
+			m_peakLifetimeSum(i + 1, ch) = m_peakLifetimeSum(i, ch) + m_peakLifetime(i, ch);
+	}
+}
+
+void QViewTab::calculateStatistics(bool toggled)
+{
+	if (toggled)
+	{
+		// Computed along with the FLIm parameters, again only if the intensity range has been changed since
+		bool is_stale = m_peakLifetime.length() == 0;
+		for (int ch = 0; ch < 3; ch++)
+			if ((m_statIntensityRange[ch].min != m_pConfig->flimIntensityRange[ch].min)
+				|| (m_statIntensityRange[ch].max != m_pConfig->flimIntensityRange[ch].max))
+				is_stale = true;
+		if (is_stale)
+			calculateLifetimeStatistics();
+		if (m_peakLifetime.length() == 0)
+			return;
 
 		int range_start = m_pConfigTemp->quantitationRange.min;
 		int range_length = m_pConfigTemp->quantitationRange.max - m_pConfigTemp->quantitationRange.min + 1;
+		int top_k = (range_length < 10) ? range_length : 10;
 
 		QString str = QString("[Statistics] - %1 (%2, %3)\n\tpeak\tavg\tpeakavg\tavgpeak\n")
 			.arg(getCurrentFrame() + 1)
 			.arg(m_pConfigTemp->quantitationRange.min + 1).arg(m_pConfigTemp->quantitationRange.max + 1);
 		for (int ch = 0; ch < 3; ch++)
 		{
-			float peak_avg;
-			np::FloatArray avg_lifetime(range_length);
-			memcpy(avg_lifetime, &m_avgLifetime(range_start, ch), sizeof(float) * range_length);
-			ippsSortDescend_32f_I(avg_lifetime, avg_lifetime.length());
-			ippsMean_32f(avg_lifetime, 10, &peak_avg, ippAlgHintAccurate);
+			std::vector<float> avg_lifetime(&m_avgLifetime(range_start, ch), &m_avgLifetime(range_start, ch) + range_length);
+			std::nth_element(avg_lifetime.begin(), avg_lifetime.begin() + (top_k - 1), avg_lifetime.end(), std::greater<float>());
+			float peak_avg = 0.0f;
+			for (int k = 0; k < top_k; k++)
+				peak_avg += avg_lifetime[k];
+			peak_avg /= top_k;
 
-			float avg_peak;
-			ippsMean_32f(&m_peakLifetime(m_pConfigTemp->quantitationRange.min, ch),
-				range_length, &avg_peak, ippAlgHintAccurate);
+			float avg_peak = (float)((m_peakLifetimeSum(range_start + range_length, ch) - m_peakLifetimeSum(range_start, ch)) / range_length);
 
 			str += QString("ch%1 lt :\t%2\t%3\t%4\t%5\tns\n").arg(ch + 1)
 				.arg(m_peakLifetime(getCurrentFrame(), ch), 4, 'f', 3)
@@ -2444,6 +2566,30 @@ void QViewTab::changeEmissionChannel(int index)
 		invalidate();
 }
 
+bool QViewTab::cacheComposition(int ml_mode, bool write)
+{
+	// Only valid for the FLIm maps of the cache key and the current vibration correction state
+	if (!m_pResultTab || m_pConfigTemp->is_dotter)
+		return false;
+
+	FlimMapCache* pFlimMapCache = m_pResultTab->getDataProcessing()->getFlimMapCache();
+	if (!pFlimMapCache)
+		return false;
+
+	std::vector<np::FloatArray2*> maps;
+	if (ml_mode == _RF_COMPO_)
+		maps.push_back(&m_plaqueCompositionProbMap.at(0));
+	else
+	{
+		maps.push_back(&m_plaqueCompositionProbMap.at(1));
+		maps.push_back(&m_plaqueCompositionProbMap.at(2));
+	}
+
+	int32_t tag = FlimMapCache::compositionTag(ml_mode, m_pResultTab->getVibCorrectionButton()->isChecked(), m_pConfigTemp->flimDelaySync);
+	QByteArray model = FlimMapCache::modelFingerprint(ml_mode == _RF_COMPO_);
+	return write ? pFlimMapCache->writeComposition(maps, tag, model) : pFlimMapCache->readComposition(maps, tag, model);
+}
+
 void QViewTab::changeMLPrediction(int mode)
 {
 	m_pConfig->writeToLog(QString("Changed ML prediction: [%1 ==> %2].").arg(m_pConfig->mlPredictionMode).arg(mode));
@@ -2469,45 +2615,52 @@ void QViewTab::changeMLPrediction(int mode)
 
 
 void QViewTab::scaleOctImage(np::Uint8Array2& oct_input, np::Uint8Array2& oct_output, bool reflection_removal)
+{
+#ifndef NEXT_GEN_SYSTEM
+	scaleOctImage(m_pConfigTemp, oct_input, oct_output, reflection_removal);
+#else
+	// OCT Visualization
+	IppiSize roi_oct = { oct_input.size(0), oct_input.size(1) };
+	ippiScale_32f8u_C1R(m_vectorOctImage.at(frame).raw_ptr(), roi_oct.width * sizeof(float),
+		m_pImgObjRectImage->arr.raw_ptr(), roi_oct.width * sizeof(uint8_t), roi_oct, (float)m_pConfig->axsunDbRange.min, (float)m_pConfig->axsunDbRange.max);
+#endif
+}
+
+void QViewTab::scaleOctImage(Configuration* pConfig, np::Uint8Array2& oct_input, np::Uint8Array2& oct_output, bool reflection_removal)
 {
 	// OCT Visualization
 	IppiSize roi_oct = { oct_input.size(0), oct_input.size(1) };
 	np::Uint8Array2 oct_otemp(roi_oct.width, roi_oct.height);
 	memset(oct_otemp, 0, sizeof(uint8_t) * oct_otemp.length());
 
-#ifndef NEXT_GEN_SYSTEM
 	np::FloatArray2 scale_temp(roi_oct.width, roi_oct.height);
 	ippsConvert_8u32f(oct_input.raw_ptr(), scale_temp.raw_ptr(), scale_temp.length());
 	if (reflection_removal)
 	{
 		np::FloatArray2 reflection_temp(roi_oct.width, roi_oct.height);
-		ippiCopy_32f_C1R(&scale_temp(m_pConfigTemp->reflectionDistance, 0), sizeof(float) * scale_temp.size(0),
+		ippiCopy_32f_C1R(&scale_temp(pConfig->reflectionDistance, 0), sizeof(float) * scale_temp.size(0),
 			&reflection_temp(0, 0), sizeof(float) * reflection_temp.size(0),
-			{ roi_oct.width - m_pConfigTemp->reflectionDistance, roi_oct.height });
-		ippsMulC_32f_I(m_pConfigTemp->reflectionLevel, reflection_temp, reflection_temp.length());
+			{ roi_oct.width - pConfig->reflectionDistance, roi_oct.height });
+		ippsMulC_32f_I(pConfig->reflectionLevel, reflection_temp, reflection_temp.length());
 		ippsSub_32f_I(reflection_temp, scale_temp, scale_temp.length());
 		ippiScale_32f8u_C1R(scale_temp.raw_ptr(), roi_oct.width * sizeof(float),
 			oct_otemp.raw_ptr(), roi_oct.width * sizeof(uint8_t), roi_oct,
-			(float)m_pConfigTemp->octGrayRange.min, (float)m_pConfigTemp->octGrayRange.max * 0.9f);
+			(float)pConfig->octGrayRange.min, (float)pConfig->octGrayRange.max * 0.9f);
 	}
 	else
 		ippiScale_32f8u_C1R(scale_temp.raw_ptr(), roi_oct.width * sizeof(float),
 			oct_otemp.raw_ptr(), roi_oct.width * sizeof(uint8_t), roi_oct,
-			(float)m_pConfigTemp->octGrayRange.min, (float)m_pConfigTemp->octGrayRange.max);
+			(float)pConfig->octGrayRange.min, (float)pConfig->octGrayRange.max);
 
 	// Circ shifting
-	if (m_pConfigTemp->circOffset > 0)
+	if (pConfig->circOffset > 0)
 		ippiCopy_8u_C1R(&oct_otemp(0, 0), sizeof(uint8_t) * oct_otemp.size(0),
-			&oct_output(m_pConfigTemp->circOffset, 0), sizeof(uint8_t) * oct_output.size(0),
-			{ oct_output.size(0) - m_pConfigTemp->circOffset, oct_output.size(1) });
+			&oct_output(pConfig->circOffset, 0), sizeof(uint8_t) * oct_output.size(0),
+			{ oct_output.size(0) - pConfig->circOffset, oct_output.size(1) });
 	else
-		ippiCopy_8u_C1R(&oct_otemp(-m_pConfigTemp->circOffset, 0), sizeof(uint8_t) * oct_otemp.size(0),
+		ippiCopy_8u_C1R(&oct_otemp(-pConfig->circOffset, 0), sizeof(uint8_t) * oct_otemp.size(0),
 			&oct_output(0, 0), sizeof(uint8_t) * oct_output.size(0),
-			{ oct_output.size(0) + m_pConfigTemp->circOffset, oct_output.size(1) });
-#else
-	ippiScale_32f8u_C1R(m_vectorOctImage.at(frame).raw_ptr(), roi_oct.width * sizeof(float),
-		m_pImgObjRectImage->arr.raw_ptr(), roi_oct.width * sizeof(uint8_t), roi_oct, (float)m_pConfig->axsunDbRange.min, (float)m_pConfig->axsunDbRange.max);
-#endif
+			{ oct_output.size(0) + pConfig->circOffset, oct_output.size(1) });
 }
 
 void QViewTab::scaleFLImEnFaceMap(ImageObject* pImgObjIntensityMap, ImageObject* pImgObjLifetimeMap, 
@@ -2694,13 +2847,12 @@ void QViewTab::getCapture(QByteArray & arr)
 	// Capture preview
 	if (m_pImgObjCircImage)
 	{
-		QImage capture = m_pImgObjCircImage->qrgbimg.scaled(144, 144, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-
-		QPixmap inPixmap = QPixmap::fromImage(capture);
+		// The displayed circular image (the circularized frame is written into the view buffers)
+		QImage capture = m_pImageView_CircImage->getRender()->m_pImage->scaled(PREVIEW_SIZE, PREVIEW_SIZE, Qt::KeepAspectRatio, Qt::SmoothTransformation);
 
 		QBuffer inBuffer(&arr);
 		inBuffer.open(QIODevice::WriteOnly);
-		inPixmap.save(&inBuffer, "BMP");
+		capture.save(&inBuffer, PREVIEW_FORMAT, PREVIEW_QUALITY);
 
 		m_pConfig->writeToLog("Preview image is captured.");
 	}
@@ -2738,79 +2890,11 @@ void QViewTab::vibrationCorrection()
 	{
 		int d_smp_factor = !m_pConfigTemp->is_dotter ? 16 : 13;
 
-		// Data size specification
-		IppiSize img_size = { m_vectorOctImage.at(0).size(0), m_vectorOctImage.at(0).size(1) };
-		IppiSize img_size16 = { m_vectorOctImage.at(0).size(0) / d_smp_factor, m_vectorOctImage.at(0).size(1) };
-
-		// Spline parameters		
-		MKL_INT dorder = 1;
-		MKL_INT nx = (int)m_vectorOctImage.at(0).size(1) / d_smp_factor + 1; // original data length
-		MKL_INT nsite = (int)m_vectorOctImage.at(0).size(1) + 1; // interpolated data length		
-		float x[2] = { 0.0f, (float)nx - 1.0f }; // data range
-		float* scoeff = new float[(nx - 1) * DF_PP_CUBIC];
-
 		// Find vibration correction index
 		memset(m_vibCorrIdx, 0, sizeof(uint16_t) * m_vibCorrIdx.length());
 		for (int i = 0; i < (int)m_vectorOctImage.size() - 1; i++)
 		{
-			// Fixed
-			np::Uint8Array2 fixed_8u(img_size16.width, img_size16.height);
-			np::FloatArray2 fixed_32f(img_size16.width, img_size16.height);
-			ippiCopy_8u_C1R(m_vectorOctImage.at(i).raw_ptr(), sizeof(uint8_t) * d_smp_factor,
-				fixed_8u.raw_ptr(), sizeof(uint8_t) * 1, { 1, img_size16.width * img_size16.height });
-			ippsConvert_8u32f(fixed_8u, fixed_32f, fixed_8u.length());
-
-			Ipp32f x_mean, x_std;
-			ippsMeanStdDev_32f(fixed_32f, fixed_32f.length(), &x_mean, &x_std, ippAlgHintFast);
-
-			np::FloatArray fixed_vector(fixed_32f.length());
-			ippsSubC_32f(fixed_32f, x_mean, fixed_vector, fixed_vector.length());
-
-			// Moving
-			np::Uint8Array2 moving_8u(img_size16.width, img_size16.height);
-			ippiCopy_8u_C1R(m_vectorOctImage.at(i + 1).raw_ptr(), sizeof(uint8_t) * d_smp_factor,
-				moving_8u.raw_ptr(), sizeof(uint8_t) * 1, { 1, img_size16.width * img_size16.height });
-
-			// Correlation buffers
-			np::FloatArray corr_coefs0(nx);
-			np::FloatArray corr_coefs(nsite);
-
-			// Shifting along A-line dimension
-			for (int j = 0; j < corr_coefs0.length(); j++)
-			{
-				circShift(moving_8u, d_smp_factor);
-				np::FloatArray2 moving_32f(img_size16.width, img_size16.height);
-				ippsConvert_8u32f(moving_8u, moving_32f, moving_8u.length());
-
-				Ipp32f y_mean, y_std;
-				ippsMeanStdDev_32f(moving_32f, moving_32f.length(), &y_mean, &y_std, ippAlgHintFast);
-
-				// Correlation coefficient
-				np::FloatArray moving_vector(moving_32f.length());
-				ippsSubC_32f(moving_32f, y_mean, moving_vector, moving_vector.length());
-				ippsMul_32f_I(fixed_vector, moving_vector, moving_vector.length());
-
-				Ipp32f cov;
-				ippsSum_32f(moving_vector, moving_vector.length(), &cov, ippAlgHintFast);
-				cov = cov / (moving_vector.length() - 1);
-
-				int j1 = (j + 1) % corr_coefs0.length();
-				corr_coefs0(j1) = cov / x_std / y_std;
-			}
-
-			// Spline interpolation		
-			DFTaskPtr task1;
-			dfsNewTask1D(&task1, nx, x, DF_UNIFORM_PARTITION, 1, corr_coefs0.raw_ptr(), DF_MATRIX_STORAGE_ROWS);
-			dfsEditPPSpline1D(task1, DF_PP_CUBIC, DF_PP_NATURAL, DF_BC_NOT_A_KNOT, 0, DF_NO_IC, 0, scoeff, DF_NO_HINT);
-			dfsConstruct1D(task1, DF_PP_SPLINE, DF_METHOD_STD);
-			dfsInterpolate1D(task1, DF_INTERP, DF_METHOD_PP, nsite, x, DF_UNIFORM_PARTITION, 1, &dorder,
-				DF_NO_APRIORI_INFO, corr_coefs.raw_ptr(), DF_MATRIX_STORAGE_ROWS, NULL);
-			dfDeleteTask(&task1);
-			mkl_free_buffers();
-
-			// Find correction index
-			Ipp32f cmax; int cidx;
-			ippsMaxIndx_32f(corr_coefs.raw_ptr(), corr_coefs.length() - 1, &cmax, &cidx);
+			int cidx = findVibCorrIdx(m_vectorOctImage.at(i), m_vectorOctImage.at(i + 1), d_smp_factor);
 
 			// OCT correction
 			circShift(m_vectorOctImage.at(i + 1), cidx);
@@ -2819,35 +2903,15 @@ void QViewTab::vibrationCorrection()
 			// FLIm correction
 			///int i1 = i + 1 - m_pConfigTemp->interFrameSync;
 			///if ((i1 > 0) && (i1 < (int)m_vectorOctImage.size()))
-			int shift = cidx / 4;
-			float weight = (float)cidx / 4.0f - (float)shift;
-
-			np::FloatArray2 intensity_temp(syncIntensityMap.at(0).size(0), 2);
-			np::FloatArray2 lifetime_temp(syncLifetimeMap.at(0).size(0), 2);
 			for (int ch = 0; ch < 3; ch++)
 			{
-				memcpy(&intensity_temp(0, 0), &syncIntensityMap.at(ch)(0, i + 1), sizeof(float) * syncIntensityMap.at(ch).size(0));
-				memcpy(&intensity_temp(0, 1), &syncIntensityMap.at(ch)(0, i + 1), sizeof(float) * syncIntensityMap.at(ch).size(0));
-				std::rotate(&intensity_temp(0, 0), &intensity_temp(shift, 0), &intensity_temp(intensity_temp.size(0), 0));
-				std::rotate(&intensity_temp(0, 1), &intensity_temp((shift + 1) % intensity_temp.size(0), 1), &intensity_temp(intensity_temp.size(0), 1));
-				ippsMulC_32f_I(1.0f - weight, &intensity_temp(0, 0), intensity_temp.size(0));
-				ippsMulC_32f_I(weight, &intensity_temp(0, 1), intensity_temp.size(0));
-				ippsAdd_32f(&intensity_temp(0, 1), &intensity_temp(0, 0), &m_intensityMap.at(ch)(0, i + 1), intensity_temp.size(0));
-
-				memcpy(&lifetime_temp(0, 0), &syncLifetimeMap.at(ch)(0, i + 1), sizeof(float) * syncLifetimeMap.at(ch).size(0));
-				memcpy(&lifetime_temp(0, 1), &syncLifetimeMap.at(ch)(0, i + 1), sizeof(float) * syncLifetimeMap.at(ch).size(0));
-				std::rotate(&lifetime_temp(0, 0), &lifetime_temp(shift, 0), &lifetime_temp(lifetime_temp.size(0), 0));
-				std::rotate(&lifetime_temp(0, 1), &lifetime_temp((shift + 1) % lifetime_temp.size(0), 1), &lifetime_temp(lifetime_temp.size(0), 1));
-				ippsMulC_32f_I(1.0f - weight, &lifetime_temp(0, 0), lifetime_temp.size(0));
-				ippsMulC_32f_I(weight, &lifetime_temp(0, 1), lifetime_temp.size(0));
-				ippsAdd_32f(&lifetime_temp(0, 1), &lifetime_temp(0, 0), &m_lifetimeMap.at(ch)(0, i + 1), lifetime_temp.size(0));
+				shiftFlimLine(syncIntensityMap.at(ch), m_intensityMap.at(ch), i + 1, cidx);
+				shiftFlimLine(syncLifetimeMap.at(ch), m_lifetimeMap.at(ch), i + 1, cidx);
 			}
 
 			m_vibCorrIdx(i + 1) = cidx;
 		}
 
-		delete[] scoeff;
-
 		// Recording
 		QFile file(vib_corr_path);
 		file.open(QIODevice::WriteOnly);
@@ -2870,33 +2934,105 @@ void QViewTab::vibrationCorrection()
 			std::rotate(&m_octProjection(0, i), &m_octProjection(m_vibCorrIdx(i), i), &m_octProjection(m_octProjection.size(0), i));
 
 			// FLIm correction
-			int shift = m_vibCorrIdx(i) / 4;
-			float weight = (float)m_vibCorrIdx(i) / 4.0f - (float)shift;
-
-			np::FloatArray2 intensity_temp(syncIntensityMap.at(0).size(0), 2);
-			np::FloatArray2 lifetime_temp(syncLifetimeMap.at(0).size(0), 2);
 			for (int ch = 0; ch < 3; ch++)
 			{
-				memcpy(&intensity_temp(0, 0), &syncIntensityMap.at(ch)(0, i), sizeof(float) * syncIntensityMap.at(ch).size(0));
-				memcpy(&intensity_temp(0, 1), &syncIntensityMap.at(ch)(0, i), sizeof(float) * syncIntensityMap.at(ch).size(0));
-				std::rotate(&intensity_temp(0, 0), &intensity_temp(shift, 0), &intensity_temp(intensity_temp.size(0), 0));
-				std::rotate(&intensity_temp(0, 1), &intensity_temp((shift + 1) % intensity_temp.size(0), 1), &intensity_temp(intensity_temp.size(0), 1));
-				ippsMulC_32f_I(1.0f - weight, &intensity_temp(0, 0), intensity_temp.size(0));
-				ippsMulC_32f_I(weight, &intensity_temp(0, 1), intensity_temp.size(0));
-				ippsAdd_32f(&intensity_temp(0, 1), &intensity_temp(0, 0), &m_intensityMap.at(ch)(0, i), intensity_temp.size(0));
-
-				memcpy(&lifetime_temp(0, 0), &syncLifetimeMap.at(ch)(0, i), sizeof(float) * syncLifetimeMap.at(ch).size(0));
-				memcpy(&lifetime_temp(0, 1), &syncLifetimeMap.at(ch)(0, i), sizeof(float) * syncLifetimeMap.at(ch).size(0));
-				std::rotate(&lifetime_temp(0, 0), &lifetime_temp(shift, 0), &lifetime_temp(lifetime_temp.size(0), 0));
-				std::rotate(&lifetime_temp(0, 1), &lifetime_temp((shift + 1) % lifetime_temp.size(0), 1), &lifetime_temp(lifetime_temp.size(0), 1));
-				ippsMulC_32f_I(1.0f - weight, &lifetime_temp(0, 0), lifetime_temp.size(0));
-				ippsMulC_32f_I(weight, &lifetime_temp(0, 1), lifetime_temp.size(0));
-				ippsAdd_32f(&lifetime_temp(0, 1), &lifetime_temp(0, 0), &m_lifetimeMap.at(ch)(0, i), lifetime_temp.size(0));
+				shiftFlimLine(syncIntensityMap.at(ch), m_intensityMap.at(ch), i, m_vibCorrIdx(i));
+				shiftFlimLine(syncLifetimeMap.at(ch), m_lifetimeMap.at(ch), i, m_vibCorrIdx(i));
 			}
 		}
 	}
 }
 
+int QViewTab::findVibCorrIdx(np::Uint8Array2& fixed, np::Uint8Array2& moving, int d_smp_factor)
+{
+	// Data size specification
+	IppiSize img_size16 = { fixed.size(0) / d_smp_factor, fixed.size(1) };
+
+	// Spline parameters		
+	MKL_INT dorder = 1;
+	MKL_INT nx = (int)fixed.size(1) / d_smp_factor + 1; // original data length
+	MKL_INT nsite = (int)fixed.size(1) + 1; // interpolated data length		
+	float x[2] = { 0.0f, (float)nx - 1.0f }; // data range
+	np::FloatArray scoeff((nx - 1) * DF_PP_CUBIC);
+
+	// Fixed
+	np::Uint8Array2 fixed_8u(img_size16.width, img_size16.height);
+	np::FloatArray2 fixed_32f(img_size16.width, img_size16.height);
+	ippiCopy_8u_C1R(fixed.raw_ptr(), sizeof(uint8_t) * d_smp_factor,
+		fixed_8u.raw_ptr(), sizeof(uint8_t) * 1, { 1, img_size16.width * img_size16.height });
+	ippsConvert_8u32f(fixed_8u, fixed_32f, fixed_8u.length());
+
+	Ipp32f x_mean, x_std;
+	ippsMeanStdDev_32f(fixed_32f, fixed_32f.length(), &x_mean, &x_std, ippAlgHintFast);
+
+	np::FloatArray fixed_vector(fixed_32f.length());
+	ippsSubC_32f(fixed_32f, x_mean, fixed_vector, fixed_vector.length());
+
+	// Moving
+	np::Uint8Array2 moving_8u(img_size16.width, img_size16.height);
+	ippiCopy_8u_C1R(moving.raw_ptr(), sizeof(uint8_t) * d_smp_factor,
+		moving_8u.raw_ptr(), sizeof(uint8_t) * 1, { 1, img_size16.width * img_size16.height });
+
+	// Correlation buffers
+	np::FloatArray corr_coefs0(nx);
+	np::FloatArray corr_coefs(nsite);
+
+	// Shifting along A-line dimension
+	for (int j = 0; j < corr_coefs0.length(); j++)
+	{
+		circShift(moving_8u, d_smp_factor);
+		np::FloatArray2 moving_32f(img_size16.width, img_size16.height);
+		ippsConvert_8u32f(moving_8u, moving_32f, moving_8u.length());
+
+		Ipp32f y_mean, y_std;
+		ippsMeanStdDev_32f(moving_32f, moving_32f.length(), &y_mean, &y_std, ippAlgHintFast);
+
+		// Correlation coefficient
+		np::FloatArray moving_vector(moving_32f.length());
+		ippsSubC_32f(moving_32f, y_mean, moving_vector, moving_vector.length());
+		ippsMul_32f_I(fixed_vector, moving_vector, moving_vector.length());
+
+		Ipp32f cov;
+		ippsSum_32f(moving_vector, moving_vector.length(), &cov, ippAlgHintFast);
+		cov = cov / (moving_vector.length() - 1);
+
+		int j1 = (j + 1) % corr_coefs0.length();
+		corr_coefs0(j1) = cov / x_std / y_std;
+	}
+
+	// Spline interpolation		
+	DFTaskPtr task1;
+	dfsNewTask1D(&task1, nx, x, DF_UNIFORM_PARTITION, 1, corr_coefs0.raw_ptr(), DF_MATRIX_STORAGE_ROWS);
+	dfsEditPPSpline1D(task1, DF_PP_CUBIC, DF_PP_NATURAL, DF_BC_NOT_A_KNOT, 0, DF_NO_IC, 0, scoeff.raw_ptr(), DF_NO_HINT);
+	dfsConstruct1D(task1, DF_PP_SPLINE, DF_METHOD_STD);
+	dfsInterpolate1D(task1, DF_INTERP, DF_METHOD_PP, nsite, x, DF_UNIFORM_PARTITION, 1, &dorder,
+		DF_NO_APRIORI_INFO, corr_coefs.raw_ptr(), DF_MATRIX_STORAGE_ROWS, NULL);
+	dfDeleteTask(&task1);
+	mkl_thread_free_buffers(); // only those of the calling thread: batch workers run this concurrently with other MKL calls
+
+	// Find correction index
+	Ipp32f cmax; int cidx;
+	ippsMaxIndx_32f(corr_coefs.raw_ptr(), corr_coefs.length() - 1, &cmax, &cidx);
+
+	return cidx;
+}
+
+void QViewTab::shiftFlimLine(np::FloatArray2& sync_map, np::FloatArray2& map, int frame, int idx)
+{
+	// 4 OCT A-lines per FLIm A-line: the FLIm line is shifted by the interpolation of the two nearest lines
+	int shift = idx / 4;
+	float weight = (float)idx / 4.0f - (float)shift;
+
+	np::FloatArray2 temp(sync_map.size(0), 2);
+	memcpy(&temp(0, 0), &sync_map(0, frame), sizeof(float) * sync_map.size(0));
+	memcpy(&temp(0, 1), &sync_map(0, frame), sizeof(float) * sync_map.size(0));
+	std::rotate(&temp(0, 0), &temp(shift, 0), &temp(temp.size(0), 0));
+	std::rotate(&temp(0, 1), &temp((shift + 1) % temp.size(0), 1), &temp(temp.size(0), 1));
+	ippsMulC_32f_I(1.0f - weight, &temp(0, 0), temp.size(0));
+	ippsMulC_32f_I(weight, &temp(0, 1), temp.size(0));
+	ippsAdd_32f(&temp(0, 1), &temp(0, 0), &map(0, frame), temp.size(0));
+}
+
 
 void QViewTab::pickFrame(std::vector<QStringList>& _vector, int oct_frame, int ivus_frame, int rotation, bool allow_delete)
 {
@@ -20,8 +20,18 @@
 #include <iostream>
 #include <vector>
 #include <thread>
+#include <mutex>
+#include <atomic>
 
 
+// Progressive review: cross-sections are previewed while the record is still being processed
+enum ProgressiveState
+{
+	_PROGRESSIVE_OFF_ = 0,
+	_PROGRESSIVE_PREVIEW_,
+	_PROGRESSIVE_FINALIZING_
+};
+
 class QStreamTab;
 class QResultTab;
 class QImageView;
@@ -54,6 +64,8 @@ public:
 	inline SupportVectorMachine* getSVM() const { return m_pSVM; }
 	inline QPushButton* getPlayButton() const { return m_pToggleButton_Play; }
 	inline QPushButton* getPickButton() const { return m_pPushButton_Pick; }
+	inline QPushButton* getIncrementButton() const { return m_pPushButton_Increment; }
+	inline QPushButton* getDecrementButton() const { return m_pPushButton_Decrement; }
     inline QSlider* getSliderSelectFrame() const { return m_pSlider_SelectFrame; }
 	inline QDialog* getSetRangeDialog() const { return m_pDialog_SetRange; }
 	inline void setVisualizationMode(int mode) { if (!mode) m_pRadioButton_FLImParameters->setChecked(true); 
@@ -66,6 +78,7 @@ public:
 	inline void setCurrentFrame(int frame) { m_pSlider_SelectFrame->setValue(frame); }
     inline int getCurrentFrame() { return m_pSlider_SelectFrame->value(); }
 	inline int getCurrentAline() { return m_pImageView_CircImage->getRender()->m_pVLineInd[0]; }
+	inline int getLongiAline() const { return m_nLongiAline; }
 	inline void lumenDetection() { lumenContourDetection(); }
 	
 private:
@@ -74,6 +87,13 @@ private:
 public:
 	void invalidate();
 
+	void setProgressiveState(int state);
+	void publishFrames(int first, int last);
+
+private:
+	bool isPreviewOnly();
+	void visualizePreview(int frame);
+
 private:
     void setStreamingBuffersObjects();
 
@@ -82,6 +102,7 @@ public:
 	void setObjects(Configuration* pConfig);
     void setWidgets(Configuration* pConfig);
 	void resetImgObjLifetime(Configuration* pConfig);
+	void calculateLifetimeStatistics();
 	void setCircImageViewClickedMouseCallback(const std::function<void(void)> &slot);
 	void setEnFaceImageViewClickedMouseCallback(const std::function<void(void)> &slot);
 	void setLongiImageViewClickedMouseCallback(const std::function<void(void)> &slot);
@@ -105,16 +126,22 @@ private slots:
 	void changeEmissionChannel(int);
 	void changeMLPrediction(int);
 
+private:
+	bool cacheComposition(int ml_mode, bool write);
+
 public:
 	void scaleOctImage(np::Uint8Array2& oct_input, np::Uint8Array2& oct_output, bool reflection_removal);
+	static void scaleOctImage(Configuration* pConfig, np::Uint8Array2& oct_input, np::Uint8Array2& oct_output, bool reflection_removal);
 	void scaleFLImEnFaceMap(ImageObject* pImgObjIntensityMap, ImageObject* pImgObjLifetimeMap,
 		ImageObject* pImgObjIntensityPropMap, ImageObject* pImgObjIntensityRatioMap,
 		ImageObject* pImgObjPlaqueCompositionMap, 
 		int vis_mode, int ch, int flim_mode, int ml_mode);
-	void circShift(np::Uint8Array2& image, int shift);
+	static void circShift(np::Uint8Array2& image, int shift);
 	void setAxialOffset(np::Uint8Array2& image, int offset);
-	void makeDelay(np::FloatArray2& input, np::FloatArray2& output, int delay);
+	static void makeDelay(np::FloatArray2& input, np::FloatArray2& output, int delay);
 	void vibrationCorrection();
+	static int findVibCorrIdx(np::Uint8Array2& fixed, np::Uint8Array2& moving, int d_smp_factor);
+	static void shiftFlimLine(np::FloatArray2& sync_map, np::FloatArray2& map, int frame, int idx);
 	void pickFrame(std::vector<QStringList>& _vector, int oct_frame, int ivus_frame = 0, int rotation = 0, bool allow_delete = false);
 	void loadPickFrames(std::vector<QStringList>& _vector);
 	void seekPickFrame(bool is_right);
@@ -143,6 +170,7 @@ public:
 	np::FloatArray2 m_visIntensity;
 	np::FloatArray2 m_visMeanDelay;
 	np::FloatArray2 m_visLifetime;
+	std::atomic<bool> m_bStreamingDrawing; // set when a frame is handed to the GUI, cleared once it is drawn
 
 public: // for post processing
 #ifndef NEXT_GEN_SYSTEM
@@ -169,8 +197,10 @@ public: // for post processing
 	std::vector<int> m_gwVecDiff;
 	bool m_bRePrediction;
 
-	np::FloatArray2 m_peakLifetime;
-	np::FloatArray2 m_avgLifetime;
+	np::FloatArray2 m_peakLifetime; // frames x 3
+	np::FloatArray2 m_avgLifetime; // frames x 3
+	np::DoubleArray2 m_peakLifetimeSum; // (frames + 1) x 3, prefix sums of m_peakLifetime
+	ContrastRange<float> m_statIntensityRange[3]; // intensity range the statistics were weighted with
 
 	std::vector<np::FloatArray2> m_vectorPulseCrop;
 	std::vector<np::FloatArray2> m_vectorPulseBgSub;
@@ -214,6 +244,12 @@ private:
 	std::thread playing;
 	bool _running;
 
+	int m_nLongiAline; // A-line of the longitudinal image currently shown
+
+	std::mutex m_mtxProgressive;
+	std::atomic<int> m_nProgressive;
+	int m_nPendingFrame; // frame asked for before it was processed
+
 private:
     // Layout
     QWidget *m_pViewWidget;
@@ -0,0 +1,223 @@
+#include "RawDataExporter.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QCryptographicHash>
+
+
+RawDataExporter::RawDataExporter(const QString & export_path, QObject *parent) :
+	QObject(parent), m_exportPath(export_path), m_nTotalFiles(0), m_nNextFile(0), m_nRunningThreads(0), m_nCopiedFiles(0),
+	m_nTotalBytes(0), m_nCopiedBytes(0), m_bCanceled(false)
+{
+	// Files completed by a previous (interrupted) export into the same path
+	loadManifest();
+}
+
+RawDataExporter::~RawDataExporter()
+{
+	cancel();
+	for (auto& thread : m_vectorThreads)
+		if (thread.joinable())
+			thread.join();
+}
+
+
+void RawDataExporter::addFile(const QString & src_path, const QString & rel_path, bool resumable)
+{
+	ExportFile file;
+	file.src_path = src_path;
+	file.rel_path = rel_path;
+	file.size = QFileInfo(src_path).size();
+	file.resumable = resumable;
+
+	m_nTotalFiles++;
+	m_nTotalBytes += file.size;
+
+	// Skip files verified by a previous export as long as the copy is still there
+	if (resumable && m_hashManifest.contains(rel_path))
+	{
+		QFileInfo dst_file(m_exportPath + "/" + rel_path);
+		if (dst_file.exists() && (dst_file.size() == file.size)
+			&& (m_hashManifest.value(rel_path).section('\t', 0, 0).toLongLong() == file.size))
+		{
+			m_nCopiedBytes += file.size;
+			m_nCopiedFiles++;
+			return;
+		}
+	}
+
+	m_vectorFiles.push_back(file);
+}
+
+void RawDataExporter::start()
+{
+	m_bCanceled = false;
+	m_nNextFile = 0;
+
+	m_manifest.setFileName(m_exportPath + "/" + EXPORT_MANIFEST_NAME);
+	m_manifest.open(QIODevice::Append | QIODevice::Text);
+
+	int n_threads = qMin(EXPORT_COPY_THREADS, (int)m_vectorFiles.size());
+	if (n_threads == 0)
+	{
+		m_manifest.close();
+		QMetaObject::invokeMethod(this, "finished", Qt::QueuedConnection, Q_ARG(bool, false));
+		return;
+	}
+
+	m_nRunningThreads = n_threads;
+	for (int i = 0; i < n_threads; i++)
+		m_vectorThreads.push_back(std::thread(&RawDataExporter::copyThread, this));
+}
+
+void RawDataExporter::cancel()
+{
+	// Partial copies are kept as *.part and resumed by the next export
+	m_bCanceled = true;
+}
+
+
+void RawDataExporter::copyThread()
+{
+	while (!m_bCanceled)
+	{
+		int i = m_nNextFile++;
+		if (i >= (int)m_vectorFiles.size())
+			break;
+
+		const ExportFile& file = m_vectorFiles.at(i);
+
+		QByteArray checksum;
+		if (copyFile(file, checksum))
+		{
+			if (file.resumable)
+				appendManifest(file, checksum);
+			m_nCopiedFiles++;
+		}
+		else if (!m_bCanceled)
+		{
+			std::unique_lock<std::mutex> lock(m_mtxManifest);
+			m_listFailed.append(file.rel_path);
+		}
+	}
+
+	// The last thread out closes the manifest and reports
+	if (--m_nRunningThreads == 0)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mtxManifest);
+			m_manifest.close();
+		}
+		emit finished(m_bCanceled);
+	}
+}
+
+bool RawDataExporter::copyFile(const ExportFile & file, QByteArray & checksum)
+{
+	QString dst_path = m_exportPath + "/" + file.rel_path;
+	QString part_path = dst_path + ".part";
+	QDir().mkpath(QFileInfo(dst_path).absolutePath());
+
+	QFile src(file.src_path);
+	if (!src.open(QIODevice::ReadOnly))
+		return false;
+
+	// Resume a partial copy: its prefix is only read back from the source for the checksum
+	qint64 offset = 0;
+	if (file.resumable && QFile::exists(part_path) && (QFileInfo(part_path).size() <= file.size))
+		offset = QFileInfo(part_path).size();
+
+	QFile part(part_path);
+	if (!part.open((offset > 0) ? QIODevice::Append : (QIODevice::WriteOnly | QIODevice::Truncate)))
+		return false;
+
+	QCryptographicHash src_hash(QCryptographicHash::Md5);
+	QByteArray buffer(EXPORT_COPY_BUFFER_SIZE, 0);
+	qint64 counted = 0, done = 0;
+	bool ok = true;
+
+	while (ok && !m_bCanceled)
+	{
+		qint64 n_read = src.read(buffer.data(), (done < offset) ? qMin((qint64)buffer.size(), offset - done) : buffer.size());
+		if (n_read <= 0)
+		{
+			ok = (n_read == 0) && (done >= offset);
+			break;
+		}
+
+		if ((done >= offset) && (part.write(buffer.constData(), n_read) != n_read))
+			ok = false;
+
+		src_hash.addData(buffer.constData(), (int)n_read);
+		done += n_read;
+		counted += n_read;
+		m_nCopiedBytes += n_read;
+	}
+	part.close();
+	src.close();
+
+	if (!ok || m_bCanceled)
+	{
+		if (!m_bCanceled)
+			m_nCopiedBytes -= counted;
+		return false;
+	}
+
+	// Verify the written file against the source checksum
+	QByteArray dst_checksum;
+	checksum = src_hash.result().toHex();
+	if (!hashFile(part_path, dst_checksum) || (dst_checksum != checksum))
+	{
+		QFile::remove(part_path);
+		m_nCopiedBytes -= counted;
+		return false;
+	}
+
+	if (QFile::exists(dst_path))
+		QFile::remove(dst_path);
+
+	return QFile::rename(part_path, dst_path);
+}
+
+bool RawDataExporter::hashFile(const QString & path, QByteArray & checksum)
+{
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+
+	QCryptographicHash hash(QCryptographicHash::Md5);
+	if (!hash.addData(&file))
+		return false;
+	checksum = hash.result().toHex();
+
+	return true;
+}
+
+
+void RawDataExporter::loadManifest()
+{
+	QFile manifest(m_exportPath + "/" + EXPORT_MANIFEST_NAME);
+	if (manifest.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		QTextStream stream(&manifest);
+		while (!stream.atEnd())
+		{
+			QStringList entry = stream.readLine().split('\t');
+			if (entry.size() == 3)
+				m_hashManifest.insert(entry.at(0), entry.at(1) + "\t" + entry.at(2));
+		}
+		manifest.close();
+	}
+}
+
+void RawDataExporter::appendManifest(const ExportFile & file, const QByteArray & checksum)
+{
+	std::unique_lock<std::mutex> lock(m_mtxManifest);
+	if (m_manifest.isOpen())
+	{
+		QTextStream stream(&m_manifest);
+		stream << file.rel_path << "\t" << file.size << "\t" << checksum << "\n";
+		stream.flush();
+	}
+}
@@ -0,0 +1,81 @@
+#ifndef RAWDATAEXPORTER_H
+#define RAWDATAEXPORTER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QFile>
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+#include <Havana3/Configuration.h>
+
+
+struct ExportFile
+{
+	QString src_path;
+	QString rel_path; // relative to the export root
+	qint64 size = 0;
+	bool resumable = true;
+};
+
+class RawDataExporter : public QObject
+{
+	Q_OBJECT
+
+// Constructer & Destructer /////////////////////////////
+public:
+	explicit RawDataExporter(const QString & export_path, QObject *parent = nullptr);
+	virtual ~RawDataExporter();
+
+// Methods //////////////////////////////////////////////
+public:
+	// Files already listed in the manifest of a previous export are skipped unless not resumable
+	void addFile(const QString & src_path, const QString & rel_path, bool resumable = true);
+	void start();
+	void cancel();
+
+public:
+	inline qint64 getTotalBytes() const { return m_nTotalBytes; }
+	inline qint64 getCopiedBytes() const { return m_nCopiedBytes; }
+	inline int getTotalFiles() const { return m_nTotalFiles; }
+	inline int getCopiedFiles() const { return m_nCopiedFiles; }
+	inline QStringList getFailedFiles() { std::unique_lock<std::mutex> lock(m_mtxManifest); return m_listFailed; }
+	inline QString getExportPath() const { return m_exportPath; }
+
+private:
+	void copyThread();
+	bool copyFile(const ExportFile & file, QByteArray & checksum);
+	bool hashFile(const QString & path, QByteArray & checksum);
+	void loadManifest();
+	void appendManifest(const ExportFile & file, const QByteArray & checksum);
+
+signals:
+	void finished(bool);
+
+// Variables ////////////////////////////////////////////
+private:
+	QString m_exportPath;
+	QFile m_manifest;
+	QHash<QString, QString> m_hashManifest; // rel_path -> "size\tmd5" of completed files
+	std::mutex m_mtxManifest;
+	QStringList m_listFailed;
+
+	std::vector<ExportFile> m_vectorFiles;
+	std::vector<std::thread> m_vectorThreads;
+
+	int m_nTotalFiles;
+	std::atomic<int> m_nNextFile;
+	std::atomic<int> m_nRunningThreads;
+	std::atomic<int> m_nCopiedFiles;
+	std::atomic<qint64> m_nTotalBytes;
+	std::atomic<qint64> m_nCopiedBytes;
+	std::atomic<bool> m_bCanceled;
+};
+
+#endif // RAWDATAEXPORTER_H
@@ -73,20 +73,16 @@ QImageView::QImageView(ColorTable::colortable ctable, int width, int height, boo
 	m_pRenderImage->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Ignored);
 	m_pHBoxLayout->addWidget(m_pRenderImage);	
 
-    // Create QImage object  
+    // Create QImage objects (front & back buffers)
+	createRenderImages();
 	if (!m_bRgbUsed)
 	{
-		m_pRenderImage->m_pImage = new QImage(m_width, m_height, QImage::Format_Indexed8);
-		m_pRenderImage->m_pImage->setColorCount(256);
 		m_pRenderImage->m_pImage->setColorTable(m_colorTable.m_colorTableVector.at(ctable));
+		m_pRenderImage->m_pBackImage->setColorTable(m_colorTable.m_colorTableVector.at(ctable));
 	}
-	else
-        m_pRenderImage->m_pImage = new QImage(m_width, m_height, QImage::Format_RGB888);
 
 	m_pRenderImage->m_rectMagnified = QRect(0, 0, m_width, m_height);
 
-	memset(m_pRenderImage->m_pImage->bits(), 0, m_pRenderImage->m_pImage->byteCount());
-
 	// Set layout
 	setLayout(m_pHBoxLayout);
 
@@ -124,35 +120,45 @@ void QImageView::resetSize(int width, int height)
     m_width4 = ((width + 3) >> 2) << 2;
 	m_height = height;	
 
-	// Create QImage object
-	QRgb rgb[256];
+	// Create QImage objects (keeping the current color table)
+	QVector<QRgb> rgb;
+	if (!m_bRgbUsed)
+		rgb = m_pRenderImage->m_pImage->colorTable();
+
+	createRenderImages();
 	if (!m_bRgbUsed)
 	{
-		for (int i = 0; i < 256; i++)
-			rgb[i] = m_pRenderImage->m_pImage->color(i);
+		m_pRenderImage->m_pImage->setColorTable(rgb);
+		m_pRenderImage->m_pBackImage->setColorTable(rgb);
 	}
 
+	m_pRenderImage->m_rectMagnified = QRect(0, 0, m_width, m_height);
+}
+
+void QImageView::createRenderImages()
+{
 	if (m_pRenderImage->m_pImage)
 		delete m_pRenderImage->m_pImage;
+	if (m_pRenderImage->m_pBackImage)
+		delete m_pRenderImage->m_pBackImage;
 
+	QImage::Format format = !m_bRgbUsed ? QImage::Format_Indexed8 : QImage::Format_RGB888;
+	m_pRenderImage->m_pImage = new QImage(m_width, m_height, format);
+	m_pRenderImage->m_pBackImage = new QImage(m_width, m_height, format);
 	if (!m_bRgbUsed)
 	{
-		m_pRenderImage->m_pImage = new QImage(m_width, m_height, QImage::Format_Indexed8);
 		m_pRenderImage->m_pImage->setColorCount(256);
-		for (int i = 0; i < 256; i++)
-			m_pRenderImage->m_pImage->setColor(i, rgb[i]);
+		m_pRenderImage->m_pBackImage->setColorCount(256);
 	}
-	else
-        m_pRenderImage->m_pImage = new QImage(m_width, m_height, QImage::Format_RGB888);
-
-	m_pRenderImage->m_rectMagnified = QRect(0, 0, m_width, m_height);
 
 	memset(m_pRenderImage->m_pImage->bits(), 0, m_pRenderImage->m_pImage->byteCount());
+	memset(m_pRenderImage->m_pBackImage->bits(), 0, m_pRenderImage->m_pBackImage->byteCount());
 }
 
 void QImageView::resetColormap(ColorTable::colortable ctable)
 {
 	m_pRenderImage->m_pImage->setColorTable(m_colorTable.m_colorTableVector.at(ctable));
+	m_pRenderImage->m_pBackImage->setColorTable(m_colorTable.m_colorTableVector.at(ctable));
 	
 	m_pRenderImage->update();
 }
@@ -299,20 +305,37 @@ void QImageView::setWheelMouseCallback(const std::function<void(void)>& slot)
 
 void QImageView::drawImage(uint8_t* pImage)
 {
-	memcpy(m_pRenderImage->m_pImage->bits(), pImage, m_pRenderImage->m_pImage->byteCount());	
-	m_pRenderImage->update();
+	// Source rows are laid out like the render image (4-byte aligned)
+	if (pImage != m_pRenderImage->m_pBackImage->bits())
+		copyToBackBuffer(pImage, m_pRenderImage->m_pBackImage->bytesPerLine());
+	swapBuffers();
 }
 
 void QImageView::drawRgbImage(uint8_t* pImage)
-{		
-    QImage *pImg = new QImage(pImage, m_width4, m_height, QImage::Format_RGB888);
-    if (m_width4 == m_width)
-		memcpy(m_pRenderImage->m_pImage->bits(), pImg->bits(), m_pRenderImage->m_pImage->byteCount());
-	else
-		memcpy(m_pRenderImage->m_pImage->bits(), pImg->copy(0, 0, m_width, m_height).bits(), m_pRenderImage->m_pImage->byteCount());
-	
+{
+	// Source rows are m_width4 pixels wide; only the visible m_width pixels are taken
+	if (pImage != m_pRenderImage->m_pBackImage->bits())
+		copyToBackBuffer(pImage, m_pRenderImage->m_pBackImage->depth() / 8 * m_width4);
+	swapBuffers();
+}
+
+void QImageView::swapBuffers()
+{
+	std::swap(m_pRenderImage->m_pImage, m_pRenderImage->m_pBackImage);
 	m_pRenderImage->update();
-	delete pImg;
+}
+
+void QImageView::copyToBackBuffer(const uint8_t* pImage, int src_stride)
+{
+	QImage *pBackImage = m_pRenderImage->m_pBackImage;
+	if (src_stride == pBackImage->bytesPerLine())
+		memcpy(pBackImage->bits(), pImage, pBackImage->byteCount());
+	else
+	{
+		int row_bytes = pBackImage->width() * pBackImage->depth() / 8;
+		for (int i = 0; i < pBackImage->height(); i++)
+			memcpy(pBackImage->scanLine(i), pImage + i * src_stride, row_bytes);
+	}
 }
 
 void QImageView::showContextMenu(const QPoint &p)
@@ -354,7 +377,7 @@ void QImageView::setCustomContextMenu(QString& menu_name, const std::function<vo
 
 
 QRenderImage::QRenderImage(QWidget *parent) :
-	QWidget(parent), m_pImage(nullptr), 
+	QWidget(parent), m_pImage(nullptr), m_pBackImage(nullptr), m_nScaledCacheKey(0),
 	m_colorVLine1(0x00ffff), m_colorVLine2(0xffff00), 
 	m_colorHLine(0x00ffff),
 	m_colorRLine1(0x00ffff), m_colorRLine2(0xffff00), m_colorCLine(0x00ffff), m_colorALine(0xffffff),
@@ -378,6 +401,7 @@ QRenderImage::QRenderImage(QWidget *parent) :
 QRenderImage::~QRenderImage()
 {
 	if (m_pImage) delete m_pImage;
+	if (m_pBackImage) delete m_pBackImage;
 
 	delete m_pHLineInd;
     delete m_pVLineInd;
@@ -392,9 +416,25 @@ void QRenderImage::paintEvent(QPaintEvent *)
     int w = this->width();
     int h = this->height();
 
-    // Draw image
+    // Draw image (rescaled only when the image, the widget size or the magnification changes)
 	if (m_pImage)
-		painter.drawImage(QRect(0, 0, w, h), *m_pImage, m_rectMagnified);
+	{
+		qreal dpr = devicePixelRatioF();
+		QSize size_scaled(qRound(w * dpr), qRound(h * dpr));
+		if ((m_pixmapScaled.size() != size_scaled) || (m_nScaledCacheKey != m_pImage->cacheKey()) || (m_rectScaled != m_rectMagnified))
+		{
+			m_pixmapScaled = QPixmap(size_scaled);
+			m_pixmapScaled.setDevicePixelRatio(dpr);
+
+			QPainter painter_scaled(&m_pixmapScaled);
+			painter_scaled.setRenderHint(QPainter::SmoothPixmapTransform, true);
+			painter_scaled.drawImage(QRect(0, 0, w, h), *m_pImage, m_rectMagnified);
+
+			m_nScaledCacheKey = m_pImage->cacheKey();
+			m_rectScaled = m_rectMagnified;
+		}
+		painter.drawPixmap(0, 0, m_pixmapScaled);
+	}
 	
 	// Draw assitive lines
 	for (int i = 0; i < m_hLineLen; i++)
@@ -47,6 +47,11 @@ public:
 	inline int getWidth() { return m_width; }
 	inline int getHeight() { return m_height; }
 
+	// Double-buffered render images: producers write into the back buffer (stride: getBackBufferStride())
+	// and then call swapBuffers() on the GUI thread, which costs no copy on the UI side.
+	inline uint8_t* getBackBuffer() { return m_pRenderImage->m_pBackImage->bits(); }
+	inline int getBackBufferStride() { return m_pRenderImage->m_pBackImage->bytesPerLine(); }
+
 protected:
     void resizeEvent(QResizeEvent *);
 
@@ -83,8 +88,13 @@ public:
 public slots:
 	void drawImage(uint8_t* pImage);
 	void drawRgbImage(uint8_t* pImage);
+	void swapBuffers();
 	void showContextMenu(const QPoint &);
 
+private:
+	void createRenderImages();
+	void copyToBackBuffer(const uint8_t* pImage, int src_stride);
+
 public:
 	void setCustomContextMenu(QString& menu_name, const std::function<void(void)> &slot);
 
@@ -128,7 +138,16 @@ protected:
 	void wheelEvent(QWheelEvent *);
 	
 public:
-    QImage *m_pImage;
+    QImage *m_pImage; // front buffer (displayed)
+	QImage *m_pBackImage; // back buffer (being written)
+
+private:
+	// Image scaled to the widget & magnification, regenerated only when either changes; overlays are painted on top
+	QPixmap m_pixmapScaled;
+	qint64 m_nScaledCacheKey;
+	QRect m_rectScaled;
+
+public:
 
     int *m_pHLineInd, *m_pVLineInd;
 	int m_hLineLen, m_vLineLen, m_circLen;
@@ -194,6 +194,7 @@ void QScope::drawData(const float* pData)
 	if (m_pRenderArea->m_pData != nullptr)
 		memcpy(m_pRenderArea->m_pData, pData, sizeof(float) * (int)m_pRenderArea->m_buff_len);
 
+	m_pRenderArea->invalidateTrace();
 	m_pRenderArea->update();
 }
 
@@ -204,6 +205,7 @@ void QScope::drawData(const float* pData, const float* pDataX, bool foo)
 	if (m_pRenderArea->m_pDataX != nullptr)
 		memcpy(m_pRenderArea->m_pDataX, pDataX, sizeof(float) * (int)m_pRenderArea->m_buff_len);
 
+	m_pRenderArea->invalidateTrace();
 	m_pRenderArea->update();
 }
 
@@ -216,6 +218,7 @@ void QScope::drawData(const float* pData, const float* pMask)
 	if (m_pRenderArea->m_pMask != nullptr)
 		memcpy(m_pRenderArea->m_pMask, pMask, sizeof(float) * (int)m_pRenderArea->m_buff_len);
 
+	m_pRenderArea->invalidateTrace();
 	m_pRenderArea->update();
 }
 
@@ -224,6 +227,7 @@ void QScope::drawData(const double* pData64)
 	if (m_pRenderArea->m_pData64 != nullptr)
 		memcpy(m_pRenderArea->m_pData64, pData64, sizeof(double) * (int)m_pRenderArea->m_buff_len);
 
+	m_pRenderArea->invalidateTrace();
 	m_pRenderArea->update();
 }
 
@@ -232,7 +236,7 @@ void QScope::drawData(const double* pData64)
 QRenderArea::QRenderArea(QWidget *parent) :
     QWidget(parent), m_pData(nullptr), m_pDataX(nullptr), m_pMask(nullptr), m_pData64(nullptr), m_pSelectedRegion(nullptr),
 	m_bSelectionAvailable(false), m_bMaskUse(false), m_b64Use(false), m_buff_len(0), m_winLineLen(0), m_mdLineLen(0), m_dcLine(0),
-	m_nHMajorGrid(8), m_nHMinorGrid(64), m_nVMajorGrid(4), m_bZeroLine(false), m_bScattered(false)
+	m_nHMajorGrid(8), m_nHMinorGrid(64), m_nVMajorGrid(4), m_bZeroLine(false), m_bScattered(false), m_bTraceValid(false)
 {
     QPalette pal = this->palette();
     pal.setColor(QPalette::Background, QColor(0x282d30));
@@ -292,6 +296,7 @@ void QRenderArea::setSize(QRange xRange, QRange yRange, int len)
 		memset(m_pMask, 0, sizeof(float) * m_buff_len);
 	}
 
+	invalidateTrace();
 	this->update();
 }
 
@@ -339,49 +344,16 @@ void QRenderArea::paintEvent(QPaintEvent *)
 	}
 
     // Draw graph
-    if (m_pData != nullptr) // single case
-    {        
-		painter.setPen(QColor(0xfff65d)); // data graph (yellow)
-		for (int i = 0; i < m_buff_len - 1; i++)
-		{			
-			QPointF x0, x1;		
-			if (!m_bScattered)
-			{
-				x0.setX((float)(i) / (float)(m_sizeGraph.width() - 1) * w);
-				x0.setY((float)(m_yRange.max - m_pData[i]) * (float)h / (float)(m_yRange.max - m_yRange.min));
-				x1.setX((float)(i + 1) / (float)(m_sizeGraph.width() - 1) * w);
-				x1.setY((float)(m_yRange.max - m_pData[i + 1]) * (float)h / (float)(m_yRange.max - m_yRange.min));
-
-				painter.drawLine(x0, x1);
-			}
-			else
-			{
-				if (m_pDataX != nullptr)
-				{
-					x0.setX((float)(m_pDataX[i]) * (float)w / (float)(m_xRange.max - m_xRange.min));
-					x0.setY((float)(m_yRange.max - m_pData[i]) * (float)h / (float)(m_yRange.max - m_yRange.min));
-
-					painter.drawPoint(x0);
-				}
-			}
-        }
-    }
-	if (m_pData64 != nullptr) // double case
+	if ((m_pData != nullptr) || (m_pData64 != nullptr))
 	{
-		painter.setPen(QColor(0xfff65d)); // data graph (yellow)
-		for (int i = 0; i < m_buff_len - 1; i++)
-		{
-			QPointF x0, x1;
-			x0.setX((double)(i) / (double)(m_sizeGraph.width() - 1) * w);
-			x0.setY((double)(m_yRange.max - m_pData64[i]) * (double)h / (double)(m_yRange.max - m_yRange.min));
-			x1.setX((double)(i + 1) / (double)(m_sizeGraph.width() - 1) * w);
-			x1.setY((double)(m_yRange.max - m_pData64[i + 1]) * (double)h / (double)(m_yRange.max - m_yRange.min));
+		if (!m_bTraceValid)
+			buildTrace(w, h);
 
-			if (!m_bScattered)
-				painter.drawLine(x0, x1);
-			else
-				painter.drawPoint(x0);
-		}
+		painter.setPen(QColor(0xfff65d)); // data graph (yellow)
+		if (!m_bScattered)
+			painter.drawPolyline(m_polyTrace);
+		else
+			painter.drawPoints(m_polyTrace);
 	}
 	
 	if (m_bMaskUse && (m_pMask != nullptr))
@@ -460,6 +432,70 @@ void QRenderArea::paintEvent(QPaintEvent *)
 	}
 }
 
+void QRenderArea::resizeEvent(QResizeEvent *)
+{
+	invalidateTrace();
+}
+
+template <typename T>
+static void decimateTrace(const T* pData, int len, double x_scale, double y_max, double y_scale, int w, QPolygonF& trace)
+{
+	// Few enough samples: keep every point
+	if (len <= 2 * w)
+	{
+		for (int i = 0; i < len; i++)
+			trace.append(QPointF(i * x_scale, (y_max - pData[i]) * y_scale));
+		return;
+	}
+
+	// Min/max per pixel column, emitted in sample order so that the envelope is preserved
+	int i = 0;
+	while (i < len)
+	{
+		int col = (int)(i * x_scale);
+		int i_min = i, i_max = i;
+		for (; (i < len) && ((int)(i * x_scale) == col); i++)
+		{
+			if (pData[i] < pData[i_min]) i_min = i;
+			if (pData[i] > pData[i_max]) i_max = i;
+		}
+
+		int i0 = qMin(i_min, i_max), i1 = qMax(i_min, i_max);
+		trace.append(QPointF(i0 * x_scale, (y_max - pData[i0]) * y_scale));
+		if (i1 != i0)
+			trace.append(QPointF(i1 * x_scale, (y_max - pData[i1]) * y_scale));
+	}
+}
+
+void QRenderArea::buildTrace(int w, int h)
+{
+	m_polyTrace.clear();
+
+	double x_scale = (double)w / (double)(m_sizeGraph.width() - 1);
+	double y_scale = (double)h / (double)(m_yRange.max - m_yRange.min);
+
+	if (!m_bScattered)
+	{
+		if (m_pData != nullptr) // single case
+			decimateTrace(m_pData, m_buff_len, x_scale, m_yRange.max, y_scale, w, m_polyTrace);
+		if (m_pData64 != nullptr) // double case
+			decimateTrace(m_pData64, m_buff_len, x_scale, m_yRange.max, y_scale, w, m_polyTrace);
+	}
+	else
+	{
+		m_polyTrace.reserve(m_buff_len);
+		for (int i = 0; i < m_buff_len - 1; i++)
+		{
+			if ((m_pData != nullptr) && (m_pDataX != nullptr))
+				m_polyTrace.append(QPointF(m_pDataX[i] * (double)w / (double)(m_xRange.max - m_xRange.min), (m_yRange.max - m_pData[i]) * y_scale));
+			else if (m_pData64 != nullptr)
+				m_polyTrace.append(QPointF(i * x_scale, (m_yRange.max - m_pData64[i]) * y_scale));
+		}
+	}
+
+	m_bTraceValid = true;
+}
+
 void QRenderArea::mousePressEvent(QMouseEvent *e)
 {
 	if (m_bSelectionAvailable)
@@ -75,6 +75,7 @@ public:
 
 protected:
     void paintEvent(QPaintEvent *);
+	void resizeEvent(QResizeEvent *);
 
 	void mousePressEvent(QMouseEvent *);
 	void mouseMoveEvent(QMouseEvent *);
@@ -83,6 +84,10 @@ protected:
 public:
 	void setSize(QRange xRange, QRange yRange, int len = 0);
 	void setGrid(int nHMajorGrid, int nHMinorGrid, int nVMajorGrid, bool zeroLine = false);
+	inline void invalidateTrace() { m_bTraceValid = false; }
+
+private:
+	void buildTrace(int w, int h);
 
 public: // callback
 	callback<void> DidMouseEvent;
@@ -120,6 +125,11 @@ public:
 	uint8_t *m_pSelectedRegion;
 
 	bool m_bScattered;
+
+private:
+	// Decimated trace (at most ~2 points per pixel column), rebuilt only when data, axes or size change
+	QPolygonF m_polyTrace;
+	bool m_bTraceValid;
 };
 
 
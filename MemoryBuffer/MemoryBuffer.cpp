@@ -3,6 +3,7 @@
 
 #include <QSqlQuery>
 #include <QProgressDialog>
+#include <QTextStream>
 
 #include <Havana3/HvnSqlDataBase.h>
 #include <Havana3/MainWindow.h>
@@ -136,6 +137,10 @@ bool MemoryBuffer::startRecording()
 	// Start Recording
 	SendStatusMessage("Data recording is started.", false);
 	m_nRecordedFrames = 0;
+	m_vectorFlimStamps.clear();
+	m_vectorOctStamps.clear();
+	m_vectorFlimStamps.reserve(WRITING_BUFFER_SIZE);
+	m_vectorOctStamps.reserve(WRITING_BUFFER_SIZE);
 
     // Pullback
 	DidPullback();
@@ -177,6 +182,8 @@ bool MemoryBuffer::startRecording()
 #endif
 					m_queueWritingOctBuffer.push(buffer_oct);
 
+					m_vectorFlimStamps.push_back(m_syncFlimBuffering.get_stamp(pulse));
+					m_vectorOctStamps.push_back(m_syncOctBuffering.get_stamp(oct_im));
 					m_nRecordedFrames++;
 					///printf("ing: %zd %zd\n", m_syncFlimBuffering.Queue_sync.size(), m_syncOctBuffering.Queue_sync.size());
 					
@@ -265,15 +272,12 @@ void MemoryBuffer::startSaving(RecordInfo& record_info)
 	//_thread.detach();
 	
 	// Add to database
-	QString command = QString("INSERT INTO records(patient_id, datetime_taken, preview, title, filename, procedure_id, vessel_id) "
-		"VALUES('%1', '%2', :preview, '%3', '%4', %5, %6)").arg(record_info.patientId).arg(record_info.date)
-													   .arg(record_info.title).arg(record_info.filename).arg(record_info.procedure).arg(record_info.vessel);
-	m_pHvnSqlDataBase->queryDatabase(command, [&](QSqlQuery &) {}, false, record_info.preview);
-
-	m_pHvnSqlDataBase->queryDatabase(QString("SELECT * FROM records WHERE datetime_taken='%1'").arg(record_info.date), [&](QSqlQuery& _sqlQuery) {
-		while (_sqlQuery.next())
-			record_info.recordId = _sqlQuery.value(0).toString();
+	QString command = "INSERT INTO records(patient_id, datetime_taken, title, filename, procedure_id, vessel_id) VALUES(?, ?, ?, ?, ?, ?)";
+	m_pHvnSqlDataBase->queryPrepared(command, { record_info.patientId, record_info.date, record_info.title, 
+		record_info.filename, record_info.procedure, record_info.vessel }, [&](QSqlQuery& _sqlQuery) {
+		record_info.recordId = _sqlQuery.lastInsertId().toString();
 	});
+	m_pHvnSqlDataBase->updateRecordPreview(record_info.recordId, record_info.preview);
 }
 
 ///void MemoryBuffer::circulation(int nFramesToCirc)
@@ -437,6 +441,9 @@ void MemoryBuffer::write()
 
 	if (false == QFile::copy("Havana3.m", fileTitle + ".m"))
 		SendStatusMessage("Error occurred while copying MATLAB processing data.\n", false);
+
+	if (!writeFrameStamps(fileTitle + ".timestamps"))
+		SendStatusMessage("Error occurred while writing frame timestamps.", false);
 	
 	/// Send a signal to notify this thread is finished
 	///emit finishedWritingThread();
@@ -451,3 +458,32 @@ void MemoryBuffer::write()
 	sprintf(msg, "[%s]", filename);
 	SendStatusMessage(msg, false);
 }
+
+bool MemoryBuffer::writeFrameStamps(const QString& path)
+{
+	// One row per frame of pullback.data: DAQ sequence numbers & steady_clock arrival times of both streams
+	QFile file(path);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+		return false;
+
+	QTextStream stream(&file);
+	stream << "Frame" << "\t"
+		<< "FLIm Seq" << "\t"
+		<< "FLIm Time (us)" << "\t"
+		<< "OCT Seq" << "\t"
+		<< "OCT Time (us)" << "\n";
+
+	int n_frames = qMin((int)m_vectorFlimStamps.size(), (int)m_vectorOctStamps.size());
+	for (int i = 0; i < n_frames; i++)
+	{
+		const FrameStamp& flim = m_vectorFlimStamps.at(i);
+		const FrameStamp& oct = m_vectorOctStamps.at(i);
+		stream << i << "\t"
+			<< flim.sequence << "\t" << (qint64)flim.timestamp_us << "\t"
+			<< oct.sequence << "\t" << (qint64)oct.timestamp_us << "\n";
+	}
+	stream.flush();
+	file.close();
+
+	return true;
+}
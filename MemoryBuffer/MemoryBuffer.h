@@ -9,8 +9,10 @@
 
 #include <iostream>
 #include <queue>
+#include <vector>
 
 #include <Common/SyncObject.h>
+#include <Common/FrameStamp.h>
 #include <Common/callback.h>
 
 class MainWindow;
@@ -47,6 +49,7 @@ public:
 
 private: // writing threading operation
 	void write();
+	bool writeFrameStamps(const QString& path);
 
 signals:
 	void wroteSingleFrame(int);
@@ -84,6 +87,8 @@ private:
 #else
 	std::queue<float*> m_queueWritingOctBuffer; // writing buffer
 #endif
+	std::vector<FrameStamp> m_vectorFlimStamps; // per recorded frame
+	std::vector<FrameStamp> m_vectorOctStamps;
 	QString m_fileName;
 };
 
@@ -75,3 +75,4 @@ INSERT INTO "vessel" VALUES (13,'LCX Mid');
 INSERT INTO "vessel" VALUES (14,'LCX OM2');
 INSERT INTO "vessel" VALUES (15,'LCX Distal');
 INSERT INTO "vessel" VALUES (16,'Other');
+COMMIT;